@@ -0,0 +1,176 @@
+/**
+ * \file dedup.cpp
+ * \brief Suppression of duplicate packets of mirrored traffic
+ * \date 2026
+ */
+/*
+ * Copyright (C) 2026 CESNET
+ *
+ * LICENSE TERMS
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name of the Company nor the names of its contributors
+ *    may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ *
+ *
+ */
+
+#include <cstring>
+#include <sstream>
+#include <netinet/in.h>
+
+#include <ipfixprobe/utils.hpp>
+
+#include "dedup.hpp"
+#include "storage/xxhash.h"
+
+namespace ipxp {
+
+PacketDedup::PacketDedup(uint64_t window_usec, uint32_t fields) :
+   m_window(window_usec * NSEC_IN_USEC), m_fields(fields), m_table(DEDUP_TABLE_SIZE, {0, 0})
+{
+}
+
+/**
+ * \brief Parse comma separated list of digest fields.
+ * \param [in] str List of ipid, addr, ports, seq, csum, len or all.
+ * \param [out] fields Mask of DedupField values.
+ * \return False when unknown field is found.
+ */
+bool PacketDedup::parse_fields(const std::string &str, uint32_t &fields)
+{
+   std::istringstream in(str);
+   std::string name;
+
+   fields = 0;
+   while (std::getline(in, name, ',')) {
+      trim_str(name);
+      if (name == "ipid") {
+         fields |= DEDUP_IPID;
+      } else if (name == "addr") {
+         fields |= DEDUP_ADDR;
+      } else if (name == "ports") {
+         fields |= DEDUP_PORTS;
+      } else if (name == "seq") {
+         fields |= DEDUP_SEQ;
+      } else if (name == "csum") {
+         fields |= DEDUP_CSUM;
+      } else if (name == "len") {
+         fields |= DEDUP_LEN;
+      } else if (name == "all") {
+         fields |= DEDUP_ALL;
+      } else {
+         return false;
+      }
+   }
+   return fields != 0;
+}
+
+uint64_t PacketDedup::digest(const Packet &pkt) const
+{
+   struct {
+      uint8_t src_ip[16];
+      uint8_t dst_ip[16];
+      uint32_t tcp_seq;
+      uint32_t tcp_ack;
+      uint16_t ip_id;
+      uint16_t ip_len;
+      uint16_t src_port;
+      uint16_t dst_port;
+      uint16_t checksum;
+      uint8_t ip_version;
+      uint8_t ip_proto;
+   } key;
+
+   memset(&key, 0, sizeof(key));
+   if (m_fields & DEDUP_IPID && pkt.ip_version == IP::v4) {
+      key.ip_id = pkt.frag_id;
+   }
+   if (m_fields & DEDUP_ADDR) {
+      size_t ip_len = pkt.ip_version == IP::v6 ? 16 : 4;
+      memcpy(key.src_ip, &pkt.src_ip, ip_len);
+      memcpy(key.dst_ip, &pkt.dst_ip, ip_len);
+      key.ip_version = pkt.ip_version;
+      key.ip_proto = pkt.ip_proto;
+   }
+   if (m_fields & DEDUP_PORTS) {
+      key.src_port = pkt.src_port;
+      key.dst_port = pkt.dst_port;
+   }
+   if (m_fields & DEDUP_SEQ && pkt.ip_proto == IPPROTO_TCP) {
+      key.tcp_seq = pkt.tcp_seq;
+      key.tcp_ack = pkt.tcp_ack;
+   }
+   if (m_fields & DEDUP_CSUM) {
+      key.checksum = pkt.l4_checksum;
+   }
+   if (m_fields & DEDUP_LEN) {
+      key.ip_len = pkt.ip_len;
+   }
+   return XXH64(&key, sizeof(key), 0);
+}
+
+/**
+ * \brief Look the packet up in the table and remember it when it was not seen.
+ */
+bool PacketDedup::is_duplicate(const Packet &pkt)
+{
+   uint64_t hash = digest(pkt);
+   Entry *bucket = &m_table[hash & (DEDUP_TABLE_SIZE - DEDUP_WAYS)];
+   Entry *oldest = bucket;
+
+   for (unsigned i = 0; i < DEDUP_WAYS; i++) {
+      Entry &entry = bucket[i];
+      if (entry.digest == hash && entry.ts) {
+         timestamp_t diff = pkt.ts > entry.ts ? pkt.ts - entry.ts : entry.ts - pkt.ts;
+         if (diff <= m_window) {
+            return true;
+         }
+      }
+      if (entry.ts < oldest->ts) {
+         oldest = &entry;
+      }
+   }
+
+   oldest->digest = hash;
+   oldest->ts = pkt.ts;
+   return false;
+}
+
+/**
+ * \brief Remove duplicate packets from the block, order of remaining packets is kept.
+ * \return Number of removed packets.
+ */
+size_t PacketDedup::filter(PacketBlock &block)
+{
+   size_t kept = 0;
+
+   for (size_t i = 0; i < block.cnt; i++) {
+      Packet &pkt = block.pkts[i];
+      if (is_duplicate(pkt)) {
+         block.bytes -= pkt.packet_len_wire;
+         continue;
+      }
+      if (kept != i) {
+         // Swap keeps extensions of packets owned by one slot each
+         std::swap(block.pkts[kept], pkt);
+      }
+      kept++;
+   }
+
+   size_t removed = block.cnt - kept;
+   block.cnt = kept;
+   return removed;
+}
+
+}
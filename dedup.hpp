@@ -0,0 +1,87 @@
+/**
+ * \file dedup.hpp
+ * \brief Suppression of duplicate packets of mirrored traffic
+ * \date 2026
+ */
+/*
+ * Copyright (C) 2026 CESNET
+ *
+ * LICENSE TERMS
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name of the Company nor the names of its contributors
+ *    may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ *
+ *
+ */
+
+#ifndef IPXP_DEDUP_HPP
+#define IPXP_DEDUP_HPP
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <ipfixprobe/packet.hpp>
+#include <ipfixprobe/timestamp.hpp>
+
+namespace ipxp {
+
+#define DEDUP_TABLE_SIZE 65536 /**< Number of remembered packet digests, power of two */
+#define DEDUP_WAYS 4 /**< Number of digests compared in one bucket of the table */
+
+/**
+ * \brief Packet fields hashed into the packet digest.
+ */
+enum DedupField : uint32_t {
+   DEDUP_IPID = 1 << 0, /**< IPv4 identification */
+   DEDUP_ADDR = 1 << 1, /**< IP version, protocol and addresses */
+   DEDUP_PORTS = 1 << 2, /**< Transport ports */
+   DEDUP_SEQ = 1 << 3, /**< TCP sequence and acknowledgement numbers */
+   DEDUP_CSUM = 1 << 4, /**< TCP or UDP checksum */
+   DEDUP_LEN = 1 << 5, /**< IP length */
+   DEDUP_ALL = (1 << 6) - 1
+};
+
+/**
+ * \brief Drops packets whose digest was seen within a time window.
+ *
+ * Copies of a mirrored packet differ in link layer headers, VLAN and TTL,
+ * so only fields that stay the same along the path can be part of the digest.
+ * Digests are kept in a fixed size table, the oldest digest of a bucket is replaced.
+ */
+class PacketDedup
+{
+public:
+   PacketDedup(uint64_t window_usec, uint32_t fields);
+
+   size_t filter(PacketBlock &block);
+
+   static bool parse_fields(const std::string &str, uint32_t &fields);
+
+private:
+   struct Entry {
+      uint64_t digest;
+      timestamp_t ts;
+   };
+
+   timestamp_t m_window;
+   uint32_t m_fields;
+   std::vector<Entry> m_table;
+
+   uint64_t digest(const Packet &pkt) const;
+   bool is_duplicate(const Packet &pkt);
+};
+
+}
+#endif /* IPXP_DEDUP_HPP */
@@ -48,6 +48,7 @@
 
 #include <arpa/inet.h>
 #include "ipaddr.hpp"
+#include "timestamp.hpp"
 #include <string>
 
 namespace ipxp {
@@ -121,6 +122,18 @@ struct RecordExt {
       return "";
    }
 
+   /**
+    * \brief Append text representation of exported elements to buffer
+    *
+    * Extensions printed at high rates should override this to format directly
+    * into the buffer instead of building a temporary string.
+    * \param [out] out Buffer to append the text to.
+    */
+   virtual void append_text(std::string &out) const
+   {
+      out += get_text();
+   }
+
    /**
     * \brief Add extension at the end of linked list.
     * \param [in] ext Extension to add.
@@ -249,8 +262,8 @@ struct Record {
 struct Flow : public Record {
    uint64_t flow_hash;
 
-   struct timeval time_first;
-   struct timeval time_last;
+   timestamp_t time_first;
+   timestamp_t time_last;
    uint64_t src_bytes;
    uint64_t dst_bytes;
    uint32_t src_packets;
@@ -269,6 +282,12 @@ struct Flow : public Record {
    uint8_t src_mac[6];
    uint8_t dst_mac[6];
    uint8_t end_reason;
+
+   /**
+    * Number of outputs not done with exported flow, storage reuses the record when it drops to 0.
+    * Accessed by __atomic builtins, so that flows can still be copied.
+    */
+   uint32_t refs;
 };
 
 }
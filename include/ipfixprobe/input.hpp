@@ -37,6 +37,11 @@
 
 namespace ipxp {
 
+/**
+ * \brief Number of bytes captured for link, network and transport headers on top of payload needed by process plugins.
+ */
+#define CAPTURE_HEADERS_LEN 256
+
 /**
  * \brief Base class for packet receivers.
  */
@@ -55,10 +60,46 @@ public:
    uint64_t m_parsed;
    uint64_t m_dropped;
 
-   InputPlugin() : m_seen(0), m_parsed(0), m_dropped(0) {}
+   InputPlugin() : m_seen(0), m_parsed(0), m_dropped(0), m_capture_len(0) {}
    virtual ~InputPlugin() {}
 
+   /**
+    * \brief Set number of bytes of each packet needed by process plugins.
+    * Called before init(), inputs capable of truncating packets use it as default snapshot length.
+    * \param [in] len Capture length in bytes, 0 for whole packets.
+    */
+   void set_capture_len(uint32_t len)
+   {
+      m_capture_len = len;
+   }
+
    virtual Result get(PacketBlock &packets) = 0;
+
+   /**
+    * \brief Wait until new packets may be available.
+    * Called by idle input worker when blocking idle policy is used.
+    * \param [in] timeout Maximal time to wait in milliseconds.
+    * \return False when the plugin is not able to wait, true otherwise.
+    */
+   virtual bool wait(uint32_t timeout)
+   {
+      return false;
+   }
+
+   /**
+    * \brief Get current time of the input in the time base of packet timestamps.
+    * Called by idle input worker to expire flows. Inputs replaying packets at their own pace override it,
+    * others follow wall clock elapsed since the last packet.
+    * \param [out] ts Current time.
+    * \return False when the input follows wall clock, true otherwise.
+    */
+   virtual bool now(timestamp_t &ts) const
+   {
+      return false;
+   }
+
+protected:
+   uint32_t m_capture_len;
 };
 
 }
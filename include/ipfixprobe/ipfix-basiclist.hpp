@@ -33,6 +33,7 @@
 #include <sys/time.h>
 #include <cstring>
 #include <ipfixprobe/byte-utils.hpp>
+#include <ipfixprobe/timestamp.hpp>
 
 namespace ipxp {
 
@@ -50,16 +51,14 @@ public:
    ePEMNumber hdrEnterpriseNum;
 
 
-   static uint64_t Tv2Ts(timeval input);
-
    int32_t HeaderSize();
    int32_t FillBuffer(uint8_t *buffer, uint16_t *values, uint16_t len, uint16_t fieldID);
    int32_t FillBuffer(uint8_t *buffer, int16_t *values, uint16_t len, uint16_t fieldID);
    int32_t FillBuffer(uint8_t *buffer, uint32_t *values, uint16_t len, uint16_t fieldID);
    int32_t FillBuffer(uint8_t *buffer, int32_t *values, uint16_t len, uint16_t fieldID);
-   int32_t FillBuffer(uint8_t *buffer, struct timeval *values, uint16_t len, uint16_t fieldID);
    int32_t FillBuffer(uint8_t *buffer, uint8_t *values, uint16_t len, uint16_t fieldID);
    int32_t FillBuffer(uint8_t *buffer, int8_t *values, uint16_t len, uint16_t fieldID);
+   int32_t FillBufferTs(uint8_t *buffer, timestamp_t *values, uint16_t len, uint16_t fieldID);
 
 private:
    int32_t FillBufferHdr(uint8_t *buffer, uint16_t length, uint16_t elementLength, uint16_t fieldID);
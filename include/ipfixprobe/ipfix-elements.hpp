@@ -55,10 +55,16 @@ namespace ipxp {
  */
 #define NTP_USEC_TO_FRAC(usec) (uint32_t)(((uint64_t) usec << 32) / 999999)
 
+/**
+ * Conversion from nanoseconds to NTP fraction, 999999999 is used for the same reason as above.
+ */
+#define NTP_NSEC_TO_FRAC(nsec) (uint32_t)(((uint64_t) nsec << 32) / 999999999)
+
 /**
  * Create 64 bit NTP timestamp which consist of 32 bit seconds part and 32 bit fraction part.
  */
-#define MK_NTP_TS(ts) (((uint64_t) (ts.tv_sec + EPOCH_DIFF) << 32) | (uint64_t) NTP_USEC_TO_FRAC(ts.tv_usec))
+#define MK_NTP_TS(ts) (((uint64_t) (ts_sec(ts) + EPOCH_DIFF) << 32) | (uint64_t) NTP_USEC_TO_FRAC(ts_usec(ts)))
+#define MK_NTP_TS_NSEC(ts) (((uint64_t) (ts_sec(ts) + EPOCH_DIFF) << 32) | (uint64_t) NTP_NSEC_TO_FRAC(ts_nsec(ts)))
 
 /**
  * Convert FIELD to its "attributes", i.e. BYTES(FIELD) used in the source code produces
@@ -72,10 +78,12 @@ namespace ipxp {
 #define BYTES_REV(F)                  F(29305,    1,    8,   &flow.dst_bytes)
 #define PACKETS(F)                    F(0,        2,    8,   (temp = (uint64_t) flow.src_packets, &temp))
 #define PACKETS_REV(F)                F(29305,    2,    8,   (temp = (uint64_t) flow.dst_packets, &temp))
-#define FLOW_START_MSEC(F)            F(0,      152,    8,   (temp = ((uint64_t) flow.time_first.tv_sec) * 1000 + (flow.time_first.tv_usec / 1000), &temp))
-#define FLOW_END_MSEC(F)              F(0,      153,    8,   (temp = ((uint64_t) flow.time_last.tv_sec) * 1000 + (flow.time_last.tv_usec / 1000), &temp))
+#define FLOW_START_MSEC(F)            F(0,      152,    8,   (temp = ts_to_msec(flow.time_first), &temp))
+#define FLOW_END_MSEC(F)              F(0,      153,    8,   (temp = ts_to_msec(flow.time_last), &temp))
 #define FLOW_START_USEC(F)            F(0,      154,    8,   (temp = MK_NTP_TS(flow.time_first), &temp))
 #define FLOW_END_USEC(F)              F(0,      155,    8,   (temp = MK_NTP_TS(flow.time_last), &temp))
+#define FLOW_START_NSEC(F)            F(0,      156,    8,   (temp = MK_NTP_TS_NSEC(flow.time_first), &temp))
+#define FLOW_END_NSEC(F)              F(0,      157,    8,   (temp = MK_NTP_TS_NSEC(flow.time_last), &temp))
 #define OBSERVATION_MSEC(F)           F(0,      323,    8,   nullptr)
 #define INPUT_INTERFACE(F)            F(0,       10,    4,   &this->dir_bit_field)
 #define OUTPUT_INTERFACE(F)           F(0,       14,    2,   nullptr)
@@ -85,6 +93,7 @@ namespace ipxp {
 #define ETHERTYPE(F)                  F(0,      256,    2,   nullptr)
 
 #define VLAN_ID(F)                    F(0,       58,    2,   nullptr)
+#define SAMPLING_INTERVAL(F)          F(0,       34,    4,   nullptr)
 
 #define L2_SRC_MAC(F)                 F(0,       56,    6,   flow.src_mac)
 #define L2_DST_MAC(F)                 F(0,       80,    6,   flow.dst_mac)
@@ -294,6 +303,9 @@ namespace ipxp {
 #ifdef IPXP_TS_MSEC
 #define FLOW_START   FLOW_START_MSEC
 #define FLOW_END     FLOW_END_MSEC
+#elif defined(IPXP_TS_NSEC)
+#define FLOW_START   FLOW_START_NSEC
+#define FLOW_END     FLOW_END_NSEC
 #else
 #define FLOW_START   FLOW_START_USEC
 #define FLOW_END     FLOW_END_USEC
@@ -517,6 +529,9 @@ namespace ipxp {
 #define IPFIX_VLAN_TEMPLATE(F) \
    F(VLAN_ID)
 
+#define IPFIX_SAMPLING_TEMPLATE(F) \
+   F(SAMPLING_INTERVAL)
+
 #define IPFIX_NETTISA_TEMPLATE(F) \
   F(NTS_MEAN) \
   F(NTS_MIN) \
@@ -584,6 +599,7 @@ namespace ipxp {
    IPFIX_SSADETECTOR_TEMPLATE(F) \
    IPFIX_ICMP_TEMPLATE(F) \
    IPFIX_VLAN_TEMPLATE(F) \
+   IPFIX_SAMPLING_TEMPLATE(F) \
    IPFIX_NETTISA_TEMPLATE(F) \
    IPFIX_FLOW_HASH_TEMPLATE(F)
 
@@ -48,9 +48,17 @@ public:
    uint64_t m_flows_seen; /**< Number of flows received to export. */
    uint64_t m_flows_dropped; /**< Number of flows that could not be exported. */
 
-   OutputPlugin() : m_flows_seen(0), m_flows_dropped(0) {}
+   OutputPlugin() : m_flows_seen(0), m_flows_dropped(0), m_worker_id(0) {}
    virtual ~OutputPlugin() {}
 
+   /**
+    * \brief Set index of output worker running the plugin, called before init.
+    */
+   void set_worker(uint32_t id)
+   {
+      m_worker_id = id;
+   }
+
    virtual void init(const char *params, Plugins &plugins) = 0;
 
    enum class Result {
@@ -70,6 +78,30 @@ public:
    virtual void flush()
    {
    }
+
+protected:
+   uint32_t m_worker_id; /**< Index of output worker running the plugin. */
+
+   /**
+    * \brief Get path of output file of the worker running the plugin.
+    * Worker index is inserted before extension of the file name, e.g. flows-w1.ipfix.
+    * The first worker uses the path as is.
+    * \param [in] path Configured path, may be a pattern.
+    * \return Path of the worker.
+    */
+   std::string worker_path(const std::string &path) const
+   {
+      if (!m_worker_id) {
+         return path;
+      }
+      size_t name = path.find_last_of('/');
+      name = name == std::string::npos ? 0 : name + 1;
+      size_t ext = path.find_last_of('.');
+      if (ext == std::string::npos || ext <= name) {
+         ext = path.size();
+      }
+      return path.substr(0, ext) + "-w" + std::to_string(m_worker_id) + path.substr(ext);
+   }
 };
 
 }
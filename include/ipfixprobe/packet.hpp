@@ -37,6 +37,7 @@
 #include <sys/time.h>
 
 #include <ipfixprobe/ipaddr.hpp>
+#include <ipfixprobe/timestamp.hpp>
 #include <ipfixprobe/flowifc.hpp>
 
 namespace ipxp {
@@ -45,7 +46,7 @@ namespace ipxp {
  * \brief Structure for storing parsed packet fields
  */
 struct Packet : public Record {
-   struct timeval ts;
+   timestamp_t ts;
 
    uint8_t     dst_mac[6];
    uint8_t     src_mac[6];
@@ -73,6 +74,7 @@ struct Packet : public Record {
    uint32_t    tcp_mss;
    uint32_t    tcp_seq;
    uint32_t    tcp_ack;
+   uint16_t    l4_checksum; /**< TCP or UDP checksum */
 
    /**
     * @brief The top level mpls
@@ -101,23 +103,24 @@ struct Packet : public Record {
    uint16_t    buffer_size; /**< Size of buffer */
 
    bool        source_pkt; /**< Direction of packet from flow point of view */
+   uint32_t    sampling; /**< Flow sampling interval the packet was selected with, 1 when not sampled */
 
    /**
     * \brief Constructor.
     */
    Packet() :
-      ts({0}),
+      ts(0),
       dst_mac(), src_mac(), ethertype(0),
       ip_len(0), ip_payload_len(0), ip_version(0), ip_ttl(0),
       ip_proto(0), ip_tos(0), ip_flags(0), src_ip({0}), dst_ip({0}), vlan_id(0),
       frag_id(0), frag_off(0), more_fragments(false),
       src_port(0), dst_port(0), tcp_flags(0), tcp_window(0),
-      tcp_options(0), tcp_mss(0), tcp_seq(0), tcp_ack(0), mplsTop(0),
+      tcp_options(0), tcp_mss(0), tcp_seq(0), tcp_ack(0), l4_checksum(0), mplsTop(0),
       packet(nullptr), packet_len(0), packet_len_wire(0),
       payload(nullptr), payload_len(0), payload_len_wire(0),
       custom(nullptr), custom_len(0),
       buffer(nullptr), buffer_size(0),
-      source_pkt(true)
+      source_pkt(true), sampling(1)
    {
    }
 };
@@ -52,6 +52,11 @@ namespace ipxp {
  */
 #define FLOW_FLUSH_WITH_REINSERT    0x3
 
+/**
+ * \brief Plugin needs whole packet payload, see ProcessPlugin::get_payload_len.
+ */
+#define PAYLOAD_LEN_ALL             UINT32_MAX
+
 /**
  * \brief Class template for flow cache plugins.
  */
@@ -67,6 +72,16 @@ public:
       return nullptr;
    }
 
+   /**
+    * \brief Get number of payload bytes the plugin needs to see.
+    * Inputs capture only as much of each packet as the enabled plugins need.
+    * \return Number of bytes or PAYLOAD_LEN_ALL.
+    */
+   virtual uint32_t get_payload_len() const
+   {
+      return PAYLOAD_LEN_ALL;
+   }
+
    /**
     * \brief Called before a new flow record is created.
     * \param [in] pkt Parsed packet.
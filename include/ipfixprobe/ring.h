@@ -99,6 +99,48 @@ ipx_ring_push(ipx_ring_t *ring, ipx_msg_t *msg);
 IPX_API ipx_msg_t *
 ipx_ring_pop(ipx_ring_t *ring);
 
+/**
+ * \brief Add multiple messages into the ring buffer
+ *
+ * Same as ipx_ring_push() called for each message, but the writer lock (in multi-writer mode)
+ * is taken only once and the reader is synchronized once per block of messages that fits into
+ * the buffer.
+ * \note The function blocks until all messages are added.
+ * \param[in] ring Ring buffer
+ * \param[in] msgs Array of messages to be added into the ring buffer
+ * \param[in] cnt  Number of messages in the array
+ */
+IPX_API void
+ipx_ring_push_bulk(ipx_ring_t *ring, ipx_msg_t **msgs, uint32_t cnt);
+
+/**
+ * \brief Add as many messages as fit into the ring buffer without waiting
+ *
+ * Space released by the reader is taken into account once the reader synchronized it, so the
+ * buffer may be reported full up to one synchronization block earlier.
+ * \param[in] ring Ring buffer
+ * \param[in] msgs Array of messages to be added into the ring buffer
+ * \param[in] cnt  Number of messages in the array
+ * \return Number of added messages from the beginning of the array
+ */
+IPX_API uint32_t
+ipx_ring_try_push_bulk(ipx_ring_t *ring, ipx_msg_t **msgs, uint32_t cnt);
+
+/**
+ * \brief Get multiple messages from the ring buffer
+ *
+ * All messages returned by the previous call of this function or ipx_ring_pop() are considered
+ * processed and their space is returned to writers.
+ * \note The function waits for a short time when the buffer is empty.
+ * \warning Cannot be used concurrently by multiple threads at the same time.
+ * \param[in]  ring Ring buffer
+ * \param[out] msgs Array to be filled with messages
+ * \param[in]  max  Size of the array
+ * \return Number of messages in the array (0 if the buffer is empty)
+ */
+IPX_API uint32_t
+ipx_ring_pop_bulk(ipx_ring_t *ring, ipx_msg_t **msgs, uint32_t max);
+
 /**
  * \brief Change (i.e. disable/enable) multi-writer mode
  *
@@ -73,8 +73,10 @@ public:
 
    /**
     * \brief Set export queue
+    * \param [in] queue Queue of exported flows.
+    * \param [in] held Maximal number of flows popped from the queue and not yet released by outputs.
     */
-   virtual void set_queue(ipx_ring_t *queue)
+   virtual void set_queue(ipx_ring_t *queue, uint32_t held = 0)
    {
       m_export_queue = queue;
    }
@@ -0,0 +1,193 @@
+/**
+ * \file text-format.hpp
+ * \brief Fast formatting of numbers and addresses into text buffer
+ * \date 2026
+ */
+/*
+ * Copyright (C) 2026 CESNET
+ *
+ * LICENSE TERMS
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name of the Company nor the names of its contributors
+ *    may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ *
+ *
+ */
+
+#ifndef IPXP_TEXT_FORMAT_HPP
+#define IPXP_TEXT_FORMAT_HPP
+
+#include <string>
+#include <cstdint>
+#include <cstring>
+
+namespace ipxp {
+
+/**
+ * \brief Append decimal representation of unsigned number
+ */
+inline void append_uint(std::string &out, uint64_t value)
+{
+   char buf[20];
+   char *p = buf + sizeof(buf);
+
+   do {
+      *--p = '0' + value % 10;
+      value /= 10;
+   } while (value);
+   out.append(p, buf + sizeof(buf) - p);
+}
+
+/**
+ * \brief Append decimal representation of signed number
+ */
+inline void append_int(std::string &out, int64_t value)
+{
+   if (value < 0) {
+      out += '-';
+      append_uint(out, -static_cast<uint64_t>(value));
+   } else {
+      append_uint(out, value);
+   }
+}
+
+/**
+ * \brief Append unsigned number padded with zeroes to given width
+ */
+inline void append_uint_padded(std::string &out, uint64_t value, unsigned width)
+{
+   char buf[20];
+   char *p = buf + sizeof(buf);
+
+   do {
+      *--p = '0' + value % 10;
+      value /= 10;
+   } while (value);
+   while (buf + sizeof(buf) - p < width && p > buf) {
+      *--p = '0';
+   }
+   out.append(p, buf + sizeof(buf) - p);
+}
+
+/**
+ * \brief Append dotted decimal representation of IPv4 address stored in network byte order
+ */
+inline void append_ipv4(std::string &out, uint32_t addr)
+{
+   const uint8_t *p = reinterpret_cast<const uint8_t *>(&addr);
+
+   for (int i = 0; i < 4; i++) {
+      if (i) {
+         out += '.';
+      }
+      append_uint(out, p[i]);
+   }
+}
+
+/**
+ * \brief Append MAC address in xx:xx:xx:xx:xx:xx form
+ */
+inline void append_mac(std::string &out, const uint8_t *mac)
+{
+   static const char hex[] = "0123456789abcdef";
+   char buf[17];
+
+   for (int i = 0; i < 6; i++) {
+      buf[i * 3] = hex[mac[i] >> 4];
+      buf[i * 3 + 1] = hex[mac[i] & 0xf];
+      if (i < 5) {
+         buf[i * 3 + 2] = ':';
+      }
+   }
+   out.append(buf, sizeof(buf));
+}
+
+/**
+ * \brief Get length of valid UTF-8 multibyte sequence at the start of data
+ * \return Length of the sequence, 0 when the data does not start with one
+ */
+inline size_t utf8_sequence_len(const unsigned char *data, size_t len)
+{
+   unsigned char c = data[0];
+   size_t seq;
+   unsigned char min = 0x80;
+   unsigned char max = 0xbf;
+
+   if (c >= 0xc2 && c <= 0xdf) {
+      seq = 2;
+   } else if (c >= 0xe0 && c <= 0xef) {
+      seq = 3;
+      if (c == 0xe0) {
+         min = 0xa0; // Overlong encoding
+      } else if (c == 0xed) {
+         max = 0x9f; // Surrogates
+      }
+   } else if (c >= 0xf0 && c <= 0xf4) {
+      seq = 4;
+      if (c == 0xf0) {
+         min = 0x90; // Overlong encoding
+      } else if (c == 0xf4) {
+         max = 0x8f; // Above U+10FFFF
+      }
+   } else {
+      return 0;
+   }
+   if (len < seq || data[1] < min || data[1] > max) {
+      return 0;
+   }
+   for (size_t i = 2; i < seq; i++) {
+      if (data[i] < 0x80 || data[i] > 0xbf) {
+         return 0;
+      }
+   }
+   return seq;
+}
+
+/**
+ * \brief Append string escaped for JSON, without quotes
+ *
+ * Valid UTF-8 sequences are kept, other bytes above 0x7f are escaped
+ * as the code points of the same value, i.e. read as Latin-1.
+ */
+inline void append_json_escaped(std::string &out, const char *str, size_t len)
+{
+   static const char hex[] = "0123456789abcdef";
+
+   for (size_t i = 0; i < len; i++) {
+      unsigned char c = str[i];
+      if (c == '"' || c == '\\') {
+         out += '\\';
+         out += c;
+      } else if (c < 0x20) {
+         out += "\\u00";
+         out += hex[c >> 4];
+         out += hex[c & 0xf];
+      } else if (c < 0x80) {
+         out += c;
+      } else {
+         size_t seq = utf8_sequence_len(reinterpret_cast<const unsigned char *>(str + i), len - i);
+         if (seq) {
+            out.append(str + i, seq);
+            i += seq - 1;
+         } else {
+            out += "\\u00";
+            out += hex[c >> 4];
+            out += hex[c & 0xf];
+         }
+      }
+   }
+}
+
+}
+#endif /* IPXP_TEXT_FORMAT_HPP */
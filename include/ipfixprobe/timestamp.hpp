@@ -0,0 +1,110 @@
+/**
+ * \file timestamp.hpp
+ * \brief Compact timestamp with nanosecond precision
+ * \date 2026
+ */
+/*
+ * Copyright (C) 2026 CESNET
+ *
+ * LICENSE TERMS
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name of the Company nor the names of its contributors
+ *    may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ *
+ *
+ */
+
+#ifndef IPXP_TIMESTAMP_HPP
+#define IPXP_TIMESTAMP_HPP
+
+#include <cstdint>
+#include <ctime>
+#include <sys/time.h>
+
+namespace ipxp {
+
+#define NSEC_IN_SEC 1000000000ULL
+#define NSEC_IN_MSEC 1000000ULL
+#define NSEC_IN_USEC 1000ULL
+
+/**
+ * \brief Number of nanoseconds since the Unix epoch, also used for time differences.
+ */
+typedef uint64_t timestamp_t;
+
+inline timestamp_t ts_from_sec_nsec(uint64_t sec, uint64_t nsec)
+{
+   return sec * NSEC_IN_SEC + nsec;
+}
+
+inline timestamp_t ts_from_sec_usec(uint64_t sec, uint64_t usec)
+{
+   return sec * NSEC_IN_SEC + usec * NSEC_IN_USEC;
+}
+
+inline timestamp_t ts_from_timeval(const struct timeval &tv)
+{
+   return ts_from_sec_usec(tv.tv_sec, tv.tv_usec);
+}
+
+/**
+ * \brief Get whole seconds of the timestamp.
+ */
+inline time_t ts_sec(timestamp_t ts)
+{
+   return ts / NSEC_IN_SEC;
+}
+
+/**
+ * \brief Get microseconds part of the timestamp, i.e. 0 to 999999.
+ */
+inline uint32_t ts_usec(timestamp_t ts)
+{
+   return (ts % NSEC_IN_SEC) / NSEC_IN_USEC;
+}
+
+/**
+ * \brief Get nanoseconds part of the timestamp, i.e. 0 to 999999999.
+ */
+inline uint32_t ts_nsec(timestamp_t ts)
+{
+   return ts % NSEC_IN_SEC;
+}
+
+/**
+ * \brief Convert timestamp to milliseconds since the epoch.
+ */
+inline uint64_t ts_to_msec(timestamp_t ts)
+{
+   return ts / NSEC_IN_MSEC;
+}
+
+/**
+ * \brief Convert timestamp to microseconds since the epoch.
+ */
+inline uint64_t ts_to_usec(timestamp_t ts)
+{
+   return ts / NSEC_IN_USEC;
+}
+
+inline struct timeval ts_to_timeval(timestamp_t ts)
+{
+   struct timeval tv;
+   tv.tv_sec = ts_sec(ts);
+   tv.tv_usec = ts_usec(ts);
+   return tv;
+}
+
+}
+#endif /* IPXP_TIMESTAMP_HPP */
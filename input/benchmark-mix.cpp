@@ -0,0 +1,545 @@
+/**
+ * \file benchmark-mix.cpp
+ * \brief Generator of realistic traffic mix for benchmark input plugin
+ * \date 2026
+ */
+/*
+ * Copyright (C) 2026 CESNET
+ *
+ * LICENSE TERMS
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name of the Company nor the names of its contributors
+ *    may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ *
+ *
+ */
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+#include <netinet/in.h>
+
+#include "benchmark-mix.hpp"
+#include "headers.hpp"
+
+namespace ipxp {
+
+#define MIX_ETH_SIZE 14
+#define MIX_IPV4_SIZE 20
+#define MIX_IPV6_SIZE 40
+#define MIX_TCP_SIZE 20
+#define MIX_TCP_MSS_SIZE 4
+#define MIX_UDP_SIZE 8
+#define MIX_MIN_FRAME 64
+#define MIX_HOST_NAMES 10000
+
+static const uint8_t client_mac[ETH_ALEN] = {0x02, 0x00, 0x00, 0x00, 0x00, 0x01};
+static const uint8_t server_mac[ETH_ALEN] = {0x02, 0x00, 0x00, 0x00, 0x00, 0x02};
+
+static inline uint8_t *put8(uint8_t *p, uint8_t val)
+{
+   *p = val;
+   return p + 1;
+}
+
+static inline uint8_t *put16(uint8_t *p, uint16_t val)
+{
+   p[0] = val >> 8;
+   p[1] = val;
+   return p + 2;
+}
+
+static inline uint8_t *put24(uint8_t *p, uint32_t val)
+{
+   p[0] = val >> 16;
+   p[1] = val >> 8;
+   p[2] = val;
+   return p + 3;
+}
+
+static inline uint8_t *put32(uint8_t *p, uint32_t val)
+{
+   p[0] = val >> 24;
+   p[1] = val >> 16;
+   p[2] = val >> 8;
+   p[3] = val;
+   return p + 4;
+}
+
+static inline uint8_t *put_bytes(uint8_t *p, const void *data, size_t len)
+{
+   memcpy(p, data, len);
+   return p + len;
+}
+
+static uint16_t ipv4_checksum(const uint8_t *hdr)
+{
+   uint32_t sum = 0;
+   for (int i = 0; i < MIX_IPV4_SIZE; i += 2) {
+      sum += (hdr[i] << 8) | hdr[i + 1];
+   }
+   while (sum >> 16) {
+      sum = (sum & 0xffff) + (sum >> 16);
+   }
+   return ~sum;
+}
+
+TrafficMix::TrafficMix(const TrafficMixConfig &config, std::mt19937 &rnd) :
+   m_config(config), m_rnd(rnd), m_flows(config.flows), m_filler(BENCHMARK_MIX_FRAME_SIZE), m_ip_id(0)
+{
+   m_config.max_size = std::min<uint16_t>(std::max<uint16_t>(m_config.max_size, MIX_MIN_FRAME), BENCHMARK_MIX_FRAME_SIZE);
+   for (auto &it : m_filler) {
+      it = random();
+   }
+   for (auto &it : m_flows) {
+      new_flow(it);
+   }
+}
+
+uint32_t TrafficMix::random()
+{
+   return m_rnd();
+}
+
+/**
+ * \brief Get number of data packets of a new flow from bounded Zipf distribution.
+ */
+uint32_t TrafficMix::flow_size()
+{
+   double u = (random() + 1.0) / 4294967296.0;
+   double size = std::pow(u, -1.0 / (m_config.zipf - 1.0));
+   if (size >= BENCHMARK_MIX_MAX_FLOW_PKTS) {
+      return BENCHMARK_MIX_MAX_FLOW_PKTS;
+   }
+   return static_cast<uint32_t>(size);
+}
+
+void TrafficMix::new_flow(Flow &flow)
+{
+   uint32_t kind = random() % 100;
+   uint32_t app = random() % 3;
+
+   if (kind < 15 && m_config.dns) {
+      flow.type = FlowType::DNS;
+   } else if (kind < 30) {
+      flow.type = FlowType::UDP;
+   } else if (app == 0 && m_config.http) {
+      flow.type = FlowType::HTTP;
+   } else if (app == 1 && m_config.tls) {
+      flow.type = FlowType::TLS;
+   } else {
+      flow.type = FlowType::TCP;
+   }
+
+   flow.ipv6 = random() % 100 < m_config.ipv6;
+   if (flow.ipv6) {
+      static const uint8_t prefix[4] = {0x20, 0x01, 0x0d, 0xb8};
+      memcpy(flow.client_ip, prefix, sizeof(prefix));
+      memcpy(flow.server_ip, prefix, sizeof(prefix));
+      for (int i = 4; i < 16; i += 4) {
+         put32(flow.client_ip + i, random());
+         put32(flow.server_ip + i, random());
+      }
+   } else {
+      put32(flow.client_ip, (10U << 24) | (random() & 0xffffff));
+      put32(flow.server_ip, random());
+   }
+
+   flow.client_port = 1024 + random() % (65536 - 1024);
+   switch (flow.type) {
+   case FlowType::HTTP:
+      flow.server_port = 80;
+      break;
+   case FlowType::TLS:
+      flow.server_port = 443;
+      break;
+   case FlowType::DNS:
+      flow.server_port = 53;
+      break;
+   default:
+      flow.server_port = random() % 4 ? 1 + random() % 1023 : 1024 + random() % (65536 - 1024);
+      break;
+   }
+
+   flow.client_seq = random();
+   flow.server_seq = random();
+   flow.pkts = flow.type == FlowType::DNS ? 2 : flow_size();
+   flow.idx = 0;
+   flow.name = random() % MIX_HOST_NAMES;
+}
+
+/**
+ * \brief Generate next packet of a randomly chosen active flow.
+ * \param [out] frame Buffer of at least BENCHMARK_MIX_FRAME_SIZE bytes.
+ * \return Length of ethernet frame.
+ */
+size_t TrafficMix::generate(uint8_t *frame)
+{
+   Flow &flow = m_flows[random() % m_flows.size()];
+   size_t len;
+
+   if (flow.type == FlowType::DNS || flow.type == FlowType::UDP) {
+      len = udp_packet(flow, frame);
+   } else {
+      len = tcp_packet(flow, frame);
+   }
+   return len;
+}
+
+size_t TrafficMix::header_len(const Flow &flow, uint8_t tcp_flags) const
+{
+   size_t len = MIX_ETH_SIZE + (flow.ipv6 ? MIX_IPV6_SIZE : MIX_IPV4_SIZE);
+   if (flow.type == FlowType::DNS || flow.type == FlowType::UDP) {
+      return len + MIX_UDP_SIZE;
+   }
+   return len + MIX_TCP_SIZE + (tcp_flags & TH_SYN ? MIX_TCP_MSS_SIZE : 0);
+}
+
+/**
+ * \brief Write headers in front of payload already stored in the frame.
+ */
+size_t TrafficMix::build(Flow &flow, bool from_client, uint8_t tcp_flags, size_t payload_len, uint8_t *frame)
+{
+   bool udp = flow.type == FlowType::DNS || flow.type == FlowType::UDP;
+   size_t l4_len = header_len(flow, tcp_flags) - MIX_ETH_SIZE - (flow.ipv6 ? MIX_IPV6_SIZE : MIX_IPV4_SIZE) + payload_len;
+   uint8_t *p = frame;
+
+   p = put_bytes(p, from_client ? server_mac : client_mac, ETH_ALEN);
+   p = put_bytes(p, from_client ? client_mac : server_mac, ETH_ALEN);
+   p = put16(p, flow.ipv6 ? ETH_P_IPV6 : ETH_P_IP);
+
+   const uint8_t *src = from_client ? flow.client_ip : flow.server_ip;
+   const uint8_t *dst = from_client ? flow.server_ip : flow.client_ip;
+   if (flow.ipv6) {
+      p = put32(p, 0x60000000);
+      p = put16(p, l4_len);
+      p = put8(p, udp ? IPPROTO_UDP : IPPROTO_TCP);
+      p = put8(p, 64);
+      p = put_bytes(p, src, 16);
+      p = put_bytes(p, dst, 16);
+   } else {
+      uint8_t *ip = p;
+      p = put16(p, 0x4500);
+      p = put16(p, MIX_IPV4_SIZE + l4_len);
+      p = put16(p, m_ip_id++);
+      p = put16(p, 0x4000);
+      p = put8(p, 64);
+      p = put8(p, udp ? IPPROTO_UDP : IPPROTO_TCP);
+      p = put16(p, 0);
+      p = put_bytes(p, src, 4);
+      p = put_bytes(p, dst, 4);
+      put16(ip + 10, ipv4_checksum(ip));
+   }
+
+   p = put16(p, from_client ? flow.client_port : flow.server_port);
+   p = put16(p, from_client ? flow.server_port : flow.client_port);
+   if (udp) {
+      p = put16(p, l4_len);
+      p = put16(p, 0);
+   } else {
+      uint32_t &seq = from_client ? flow.client_seq : flow.server_seq;
+      uint32_t ack = from_client ? flow.server_seq : flow.client_seq;
+      bool mss = tcp_flags & TH_SYN;
+      p = put32(p, seq);
+      p = put32(p, tcp_flags & TH_ACK ? ack : 0);
+      p = put8(p, (mss ? 6 : 5) << 4);
+      p = put8(p, tcp_flags);
+      p = put16(p, 65535);
+      p = put32(p, 0);
+      if (mss) {
+         p = put32(p, 0x020405b4);
+      }
+      seq += payload_len + (tcp_flags & (TH_SYN | TH_FIN) ? 1 : 0);
+   }
+
+   size_t len = p - frame + payload_len;
+   if (len < MIX_MIN_FRAME) {
+      // Ethernet padding
+      memset(frame + len, 0, MIX_MIN_FRAME - len);
+      len = MIX_MIN_FRAME;
+   }
+   return len;
+}
+
+/**
+ * \brief Get random payload length of data packet.
+ * \param [in] full Prefer full sized packets.
+ */
+size_t TrafficMix::data_len(const Flow &flow, uint8_t tcp_flags, bool full)
+{
+   size_t hdr = header_len(flow, tcp_flags);
+   size_t size = m_config.max_size;
+   if (!full || random() % 10 >= 7) {
+      size = MIX_MIN_FRAME + random() % (m_config.max_size - MIX_MIN_FRAME + 1);
+   }
+   return size > hdr ? size - hdr : 0;
+}
+
+size_t TrafficMix::tcp_packet(Flow &flow, uint8_t *frame)
+{
+   uint32_t idx = flow.idx++;
+   uint32_t data_end = 3 + flow.pkts;
+   bool from_client;
+   uint8_t flags;
+   size_t len = 0;
+
+   if (idx == 0) {
+      return build(flow, true, TH_SYN, 0, frame);
+   } else if (idx == 1) {
+      return build(flow, false, TH_SYN | TH_ACK, 0, frame);
+   } else if (idx == 2) {
+      return build(flow, true, TH_ACK, 0, frame);
+   } else if (idx >= data_end) {
+      if (idx == data_end) {
+         return build(flow, true, TH_FIN | TH_ACK, 0, frame);
+      } else if (idx == data_end + 1) {
+         return build(flow, false, TH_FIN | TH_ACK, 0, frame);
+      }
+      len = build(flow, true, TH_ACK, 0, frame);
+      new_flow(flow);
+      return len;
+   }
+
+   flags = TH_PUSH | TH_ACK;
+   size_t hdr = header_len(flow, flags);
+   size_t room = m_config.max_size > hdr ? m_config.max_size - hdr : 0;
+   if (idx == 3) {
+      from_client = true;
+      uint8_t *payload = frame + hdr;
+      if (flow.type == FlowType::HTTP) {
+         len = http_message(flow, false, payload, room);
+      } else if (flow.type == FlowType::TLS) {
+         len = tls_client_hello(flow, payload, room);
+      } else {
+         len = filler(payload, data_len(flow, flags, false));
+      }
+   } else if (idx == 4) {
+      from_client = false;
+      uint8_t *payload = frame + hdr;
+      if (flow.type == FlowType::HTTP) {
+         len = http_message(flow, true, payload, room);
+      } else if (flow.type == FlowType::TLS) {
+         len = tls_server_hello(payload, room);
+      } else {
+         len = filler(payload, data_len(flow, flags, true));
+      }
+   } else {
+      // Bulk data flow from server, client mostly acknowledges
+      from_client = random() % 4 == 0;
+      if (from_client && random() % 2) {
+         flags = TH_ACK;
+      } else {
+         len = filler(frame + header_len(flow, flags), data_len(flow, flags, !from_client));
+      }
+   }
+   return build(flow, from_client, flags, len, frame);
+}
+
+size_t TrafficMix::udp_packet(Flow &flow, uint8_t *frame)
+{
+   uint32_t idx = flow.idx++;
+   size_t hdr = header_len(flow, 0);
+   size_t room = m_config.max_size > hdr ? m_config.max_size - hdr : 0;
+   uint8_t *payload = frame + hdr;
+   bool from_client;
+   size_t len;
+
+   if (flow.type == FlowType::DNS) {
+      from_client = idx == 0;
+      len = dns_message(flow, !from_client, payload, room);
+   } else {
+      from_client = idx == 0 || random() % 5 < 3;
+      len = filler(payload, data_len(flow, 0, false));
+   }
+
+   len = build(flow, from_client, 0, len, frame);
+   if (flow.idx >= flow.pkts) {
+      new_flow(flow);
+   }
+   return len;
+}
+
+std::string TrafficMix::host_name(uint16_t name) const
+{
+   static const char *prefixes[] = {"www", "api", "cdn", "mail", "static"};
+   static const char *domains[] = {"com", "net", "org"};
+   return std::string(prefixes[name % 5]) + std::to_string(name / 5) + ".example." + domains[name % 3];
+}
+
+size_t TrafficMix::filler(uint8_t *data, size_t len) const
+{
+   memcpy(data, m_filler.data(), len);
+   return len;
+}
+
+size_t TrafficMix::dns_message(const Flow &flow, bool response, uint8_t *data, size_t max_len)
+{
+   std::string name = host_name(flow.name);
+   uint16_t type = flow.ipv6 ? 28 : 1; // AAAA or A record
+   uint8_t *p = data;
+
+   p = put16(p, flow.client_port ^ flow.name);
+   p = put16(p, response ? 0x8180 : 0x0100);
+   p = put16(p, 1);
+   p = put16(p, response ? 1 : 0);
+   p = put32(p, 0);
+
+   size_t begin = 0;
+   while (begin < name.size()) {
+      size_t end = name.find('.', begin);
+      if (end == std::string::npos) {
+         end = name.size();
+      }
+      p = put8(p, end - begin);
+      p = put_bytes(p, name.data() + begin, end - begin);
+      begin = end + 1;
+   }
+   p = put8(p, 0);
+   p = put16(p, type);
+   p = put16(p, 1);
+
+   if (response) {
+      p = put16(p, 0xc00c); // Pointer to question name
+      p = put16(p, type);
+      p = put16(p, 1);
+      p = put32(p, 300);
+      p = put16(p, flow.ipv6 ? 16 : 4);
+      p = put_bytes(p, flow.server_ip, flow.ipv6 ? 16 : 4);
+   }
+   // Message always fits the frame buffer, it is truncated to the configured frame size
+   return std::min<size_t>(p - data, max_len);
+}
+
+size_t TrafficMix::http_message(const Flow &flow, bool response, uint8_t *data, size_t max_len)
+{
+   char buf[BENCHMARK_MIX_FRAME_SIZE];
+   int len;
+
+   if (response) {
+      len = snprintf(buf, sizeof(buf),
+         "HTTP/1.1 200 OK\r\nServer: nginx\r\nContent-Type: text/html\r\nContent-Length: %u\r\n\r\n",
+         flow.pkts * 1400);
+   } else {
+      std::string host = host_name(flow.name);
+      len = snprintf(buf, sizeof(buf),
+         "GET /page%u.html HTTP/1.1\r\nHost: %s\r\nUser-Agent: Mozilla/5.0 (X11; Linux x86_64)\r\n"
+         "Accept: text/html\r\nReferer: http://%s/\r\n\r\n",
+         flow.name, host.c_str(), host.c_str());
+   }
+   size_t size = std::min<size_t>(len, max_len);
+   memcpy(data, buf, size);
+   if (response && size < max_len) {
+      // Start of the body
+      size += filler(data + size, std::min<size_t>(max_len - size, random() % (max_len - size + 1)));
+   }
+   return size;
+}
+
+size_t TrafficMix::tls_client_hello(const Flow &flow, uint8_t *data, size_t max_len)
+{
+   static const uint16_t ciphers[] = {0x1301, 0x1302, 0x1303, 0xc02b, 0xc02f, 0xc02c, 0xc030, 0xcca9, 0xcca8};
+   std::string name = host_name(flow.name);
+   uint8_t *p = data;
+
+   p = put8(p, 0x16); // Handshake record
+   p = put16(p, 0x0301);
+   uint8_t *record_len = p;
+   p += 2;
+   p = put8(p, 0x01); // Client hello
+   uint8_t *hs_len = p;
+   p += 3;
+   p = put16(p, 0x0303);
+   p = put_bytes(p, m_filler.data(), 32); // Random
+   p = put8(p, 32);
+   p = put_bytes(p, m_filler.data() + 32, 32); // Session id
+
+   p = put16(p, sizeof(ciphers));
+   for (auto &it : ciphers) {
+      p = put16(p, it);
+   }
+   p = put16(p, 0x0100); // Null compression only
+
+   uint8_t *ext_len = p;
+   p += 2;
+   p = put16(p, 0x0000); // Server name
+   p = put16(p, name.size() + 5);
+   p = put16(p, name.size() + 3);
+   p = put8(p, 0);
+   p = put16(p, name.size());
+   p = put_bytes(p, name.data(), name.size());
+   p = put16(p, 0x000a); // Supported groups
+   p = put16(p, 8);
+   p = put16(p, 6);
+   p = put16(p, 0x001d);
+   p = put16(p, 0x0017);
+   p = put16(p, 0x0018);
+   p = put16(p, 0x000b); // EC point formats
+   p = put16(p, 2);
+   p = put16(p, 0x0100);
+   p = put16(p, 0x0010); // ALPN
+   p = put16(p, 14);
+   p = put16(p, 12);
+   p = put8(p, 2);
+   p = put_bytes(p, "h2", 2);
+   p = put8(p, 8);
+   p = put_bytes(p, "http/1.1", 8);
+   p = put16(p, 0x002b); // Supported versions
+   p = put16(p, 5);
+   p = put8(p, 4);
+   p = put16(p, 0x0304);
+   p = put16(p, 0x0303);
+
+   put16(ext_len, p - ext_len - 2);
+   put24(hs_len, p - hs_len - 3);
+   put16(record_len, p - record_len - 2);
+   return std::min<size_t>(p - data, max_len);
+}
+
+size_t TrafficMix::tls_server_hello(uint8_t *data, size_t max_len)
+{
+   uint8_t *p = data;
+
+   p = put8(p, 0x16); // Handshake record
+   p = put16(p, 0x0303);
+   uint8_t *record_len = p;
+   p += 2;
+   p = put8(p, 0x02); // Server hello
+   uint8_t *hs_len = p;
+   p += 3;
+   p = put16(p, 0x0303);
+   p = put_bytes(p, m_filler.data() + 64, 32); // Random
+   p = put8(p, 32);
+   p = put_bytes(p, m_filler.data() + 32, 32); // Session id
+   p = put16(p, 0x1301);
+   p = put8(p, 0);
+
+   uint8_t *ext_len = p;
+   p += 2;
+   p = put16(p, 0x002b); // Supported versions
+   p = put16(p, 2);
+   p = put16(p, 0x0304);
+   p = put16(p, 0x0010); // ALPN
+   p = put16(p, 5);
+   p = put16(p, 3);
+   p = put8(p, 2);
+   p = put_bytes(p, "h2", 2);
+
+   put16(ext_len, p - ext_len - 2);
+   put24(hs_len, p - hs_len - 3);
+   put16(record_len, p - record_len - 2);
+   return std::min<size_t>(p - data, max_len);
+}
+
+}
@@ -0,0 +1,119 @@
+/**
+ * \file benchmark-mix.hpp
+ * \brief Generator of realistic traffic mix for benchmark input plugin
+ * \date 2026
+ */
+/*
+ * Copyright (C) 2026 CESNET
+ *
+ * LICENSE TERMS
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name of the Company nor the names of its contributors
+ *    may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ *
+ *
+ */
+
+#ifndef IPXP_INPUT_BENCHMARK_MIX_HPP
+#define IPXP_INPUT_BENCHMARK_MIX_HPP
+
+#include <random>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+namespace ipxp {
+
+#define BENCHMARK_MIX_FRAME_SIZE     1514 /**< Maximal size of generated frame */
+#define BENCHMARK_MIX_MAX_FLOW_PKTS  100000 /**< Maximal number of data packets in a flow */
+
+#define BENCHMARK_MIX_DEFAULT_FLOWS  10000
+#define BENCHMARK_MIX_DEFAULT_ZIPF   1.5
+#define BENCHMARK_MIX_DEFAULT_IPV6   20
+
+/**
+ * \brief Parameters of generated traffic mix.
+ */
+struct TrafficMixConfig {
+   uint32_t flows;      /**< Number of concurrently active flows */
+   double zipf;         /**< Exponent of Zipf distribution of flow sizes in packets */
+   uint8_t ipv6;        /**< Percentage of IPv6 flows */
+   uint16_t max_size;   /**< Maximal size of data packets */
+   bool dns;            /**< Generate DNS queries and responses */
+   bool tls;            /**< Generate TLS handshakes */
+   bool http;           /**< Generate HTTP requests and responses */
+};
+
+/**
+ * \brief Generator of interleaved packets of many concurrent biflows.
+ *
+ * TCP flows start with a handshake and end with FIN sequence, application flows carry
+ * DNS, TLS ClientHello/ServerHello or HTTP payload, so that processing plugins have
+ * real work to do.
+ */
+class TrafficMix
+{
+public:
+   TrafficMix(const TrafficMixConfig &config, std::mt19937 &rnd);
+
+   size_t generate(uint8_t *frame);
+
+private:
+   enum class FlowType : uint8_t {
+      TCP,
+      HTTP,
+      TLS,
+      DNS,
+      UDP
+   };
+
+   struct Flow {
+      FlowType type;
+      bool ipv6;
+      uint8_t client_ip[16];
+      uint8_t server_ip[16];
+      uint16_t client_port;
+      uint16_t server_port;
+      uint32_t client_seq;
+      uint32_t server_seq;
+      uint32_t pkts;       /**< Number of data packets */
+      uint32_t idx;        /**< Index of the next packet */
+      uint16_t name;       /**< Index of host name used by application payload */
+   };
+
+   TrafficMixConfig m_config;
+   std::mt19937 &m_rnd;
+   std::vector<Flow> m_flows;
+   std::vector<uint8_t> m_filler;
+   uint16_t m_ip_id;
+
+   uint32_t random();
+   uint32_t flow_size();
+   void new_flow(Flow &flow);
+   size_t header_len(const Flow &flow, uint8_t tcp_flags) const;
+   size_t build(Flow &flow, bool from_client, uint8_t tcp_flags, size_t payload_len, uint8_t *frame);
+   size_t data_len(const Flow &flow, uint8_t tcp_flags, bool full);
+   size_t tcp_packet(Flow &flow, uint8_t *frame);
+   size_t udp_packet(Flow &flow, uint8_t *frame);
+
+   std::string host_name(uint16_t name) const;
+   size_t filler(uint8_t *data, size_t len) const;
+   size_t dns_message(const Flow &flow, bool response, uint8_t *data, size_t max_len);
+   size_t http_message(const Flow &flow, bool response, uint8_t *data, size_t max_len);
+   size_t tls_client_hello(const Flow &flow, uint8_t *data, size_t max_len);
+   size_t tls_server_hello(uint8_t *data, size_t max_len);
+};
+
+}
+#endif /* IPXP_INPUT_BENCHMARK_MIX_HPP */
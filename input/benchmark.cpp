@@ -32,6 +32,7 @@
 #include <sys/time.h>
 
 #include "benchmark.hpp"
+#include "parser.hpp"
 #include <ipfixprobe/plugin.hpp>
 #include <ipfixprobe/utils.hpp>
 #include <ipfixprobe/packet.hpp>
@@ -46,7 +47,8 @@ __attribute__((constructor)) static void register_this_plugin()
 
 Benchmark::Benchmark()
    : m_generatePacketFunc(nullptr), m_flowMode(BenchmarkMode::FLOW_1), m_maxDuration(BENCHMARK_DEFAULT_DURATION), m_maxPktCnt(BENCHMARK_DEFAULT_PKT_CNT),
-     m_packetSizeFrom(BENCHMARK_DEFAULT_SIZE_FROM), m_packetSizeTo(BENCHMARK_DEFAULT_SIZE_TO), m_firstTs({0}), m_currentTs({0}), m_pktCnt(0)
+     m_packetSizeFrom(BENCHMARK_DEFAULT_SIZE_FROM), m_packetSizeTo(BENCHMARK_DEFAULT_SIZE_TO), m_firstTs({0}), m_currentTs({0}), m_pktCnt(0),
+     m_mix(nullptr)
 {
 }
 
@@ -71,6 +73,8 @@ void Benchmark::init(const char *params)
    } else if (parser.m_mode == "nf") {
       m_flowMode = BenchmarkMode::FLOW_N;
       m_generatePacketFunc = &Benchmark::generatePacketFlowN;
+   } else if (parser.m_mode == "mix") {
+      m_flowMode = BenchmarkMode::FLOW_MIX;
    } else {
       throw PluginError("invalid benchmark mode specified");
    }
@@ -90,11 +94,38 @@ void Benchmark::init(const char *params)
       std::seed_seq seed (parser.m_seed.begin(),parser.m_seed.end());
       m_rndGen = std::mt19937(seed);
    }
+
+   if (m_flowMode == BenchmarkMode::FLOW_MIX) {
+      TrafficMixConfig config = {parser.m_flows, parser.m_zipf, parser.m_ipv6, m_packetSizeTo, false, false, false};
+      std::string templates = parser.m_templates;
+      size_t begin = 0;
+      while (begin <= templates.size()) {
+         size_t end = templates.find(',', begin);
+         if (end == std::string::npos) {
+            end = templates.size();
+         }
+         std::string name = templates.substr(begin, end - begin);
+         trim_str(name);
+         if (name == "dns") {
+            config.dns = true;
+         } else if (name == "tls") {
+            config.tls = true;
+         } else if (name == "http") {
+            config.http = true;
+         } else if (name != "none" && !name.empty()) {
+            throw PluginError("unknown payload template " + name);
+         }
+         begin = end + 1;
+      }
+      m_mix = new TrafficMix(config, m_rndGen);
+   }
    gettimeofday(&m_firstTs, nullptr);
 }
 
 void Benchmark::close()
 {
+   delete m_mix;
+   m_mix = nullptr;
 }
 
 InputPlugin::Result Benchmark::get(PacketBlock &packets)
@@ -105,6 +136,10 @@ InputPlugin::Result Benchmark::get(PacketBlock &packets)
       return res;
    }
 
+   if (m_mix != nullptr) {
+      return getMix(packets);
+   }
+
    packets.cnt = 0;
    packets.bytes = 0;
    for (size_t i = 0; i < packets.size; i++) {
@@ -121,6 +156,31 @@ InputPlugin::Result Benchmark::get(PacketBlock &packets)
    return res;
 }
 
+InputPlugin::Result Benchmark::getMix(PacketBlock &packets)
+{
+   parser_opt_t opt = {&packets, false, false, DLT_EN10MB};
+
+   // Frames are kept until the next call, packets point to them
+   if (m_mixBuffer.size() < packets.size * BENCHMARK_MIX_FRAME_SIZE) {
+      m_mixBuffer.resize(packets.size * BENCHMARK_MIX_FRAME_SIZE);
+   }
+
+   packets.cnt = 0;
+   packets.bytes = 0;
+   for (size_t i = 0; i < packets.size; i++) {
+      uint8_t *frame = m_mixBuffer.data() + packets.cnt * BENCHMARK_MIX_FRAME_SIZE;
+      size_t len = m_mix->generate(frame);
+      parse_packet(&opt, ts_from_timeval(m_currentTs), frame, len, len);
+      m_pktCnt++;
+      m_seen++;
+      if (m_maxPktCnt && m_pktCnt >= m_maxPktCnt) {
+         break;
+      }
+   }
+   m_parsed += packets.cnt;
+   return packets.cnt ? InputPlugin::Result::PARSED : InputPlugin::Result::NOT_PARSED;
+}
+
 InputPlugin::Result Benchmark::check_constraints() const
 {
    int tmp = m_currentTs.tv_usec - m_firstTs.tv_usec ;
@@ -144,7 +204,7 @@ void Benchmark::generatePacket(Packet *pkt)
 {
    std::uniform_int_distribution<uint32_t> distrib;
 
-   pkt->ts = m_currentTs;
+   pkt->ts = ts_from_timeval(m_currentTs);
    pkt->packet_len = std::uniform_int_distribution<uint16_t>(m_packetSizeFrom, m_packetSizeTo)(m_rndGen);
    pkt->packet_len_wire = pkt->packet_len;
    if (distrib(m_rndGen) & 1) {
@@ -199,7 +259,7 @@ void Benchmark::generatePacketFlow1(Packet *pkt)
    m_pkt.packet_len += diff;
    m_pkt.packet_len_wire += diff;
 
-   m_pkt.ts = m_currentTs;
+   m_pkt.ts = ts_from_timeval(m_currentTs);
    swapEndpoints(&m_pkt);
 
    m_pkt.buffer = pkt->buffer;
@@ -32,11 +32,14 @@
 #include <chrono>
 #include <string>
 #include <cstdint>
+#include <vector>
 
 #include <ipfixprobe/input.hpp>
 #include <ipfixprobe/packet.hpp>
 #include <ipfixprobe/utils.hpp>
 
+#include "benchmark-mix.hpp"
+
 namespace ipxp {
 
 #define BENCHMARK_L2_SIZE     14
@@ -64,11 +67,16 @@ public:
    uint64_t m_pkt_cnt;
    uint16_t m_pkt_size;
    uint64_t m_link;
+   uint32_t m_flows;
+   double m_zipf;
+   uint8_t m_ipv6;
+   std::string m_templates;
 
    BenchmarkOptParser() : OptionsParser("benchmark", "Input plugin for various benchmarking purposes"),
-      m_mode("1f"), m_seed(""), m_duration(0), m_pkt_cnt(0), m_pkt_size(BENCHMARK_DEFAULT_SIZE_FROM), m_link(0)
+      m_mode("1f"), m_seed(""), m_duration(0), m_pkt_cnt(0), m_pkt_size(BENCHMARK_DEFAULT_SIZE_FROM), m_link(0),
+      m_flows(BENCHMARK_MIX_DEFAULT_FLOWS), m_zipf(BENCHMARK_MIX_DEFAULT_ZIPF), m_ipv6(BENCHMARK_MIX_DEFAULT_IPV6), m_templates("dns,tls,http")
    {
-      register_option("m", "mode", "STR", "Benchmark mode 1f (1x N-packet flow) or nf (Nx 1-packet flow)", [this](const char *arg){m_mode = arg; return true;}, OptionFlags::RequiredArgument);
+      register_option("m", "mode", "STR", "Benchmark mode 1f (1x N-packet flow), nf (Nx 1-packet flow) or mix (realistic traffic mix)", [this](const char *arg){m_mode = arg; return true;}, OptionFlags::RequiredArgument);
       register_option("S", "seed", "STR", "String seed for random generator", [this](const char *arg){m_seed = arg; return true;}, OptionFlags::RequiredArgument);
       register_option("d", "duration", "TIME", "Duration in seconds",
          [this](const char *arg){try {m_duration = str2num<decltype(m_duration)>(arg);} catch(std::invalid_argument &e) {return false;} return true;},
@@ -82,6 +90,17 @@ public:
       register_option("I", "id", "NUM", "Link identifier number",
          [this](const char *arg){try {m_link = str2num<decltype(m_link)>(arg);} catch(std::invalid_argument &e) {return false;} return true;},
          OptionFlags::RequiredArgument);
+      register_option("F", "flows", "NUM", "Number of concurrent flows in mix mode",
+         [this](const char *arg){try {m_flows = str2num<decltype(m_flows)>(arg);} catch(std::invalid_argument &e) {return false;} return m_flows > 0;},
+         OptionFlags::RequiredArgument);
+      register_option("z", "zipf", "NUM", "Exponent of Zipf distribution of flow sizes in mix mode, greater than 1",
+         [this](const char *arg){try {m_zipf = str2num<decltype(m_zipf)>(arg);} catch(std::invalid_argument &e) {return false;} return m_zipf > 1;},
+         OptionFlags::RequiredArgument);
+      register_option("6", "ipv6", "NUM", "Percentage of IPv6 flows in mix mode",
+         [this](const char *arg){try {m_ipv6 = str2num<decltype(m_ipv6)>(arg);} catch(std::invalid_argument &e) {return false;} return m_ipv6 <= 100;},
+         OptionFlags::RequiredArgument);
+      register_option("t", "templates", "STR", "Comma separated payload templates dns, tls and http used in mix mode or none",
+         [this](const char *arg){m_templates = arg; return true;}, OptionFlags::RequiredArgument);
    }
 };
 
@@ -90,7 +109,8 @@ class Benchmark : public InputPlugin
 public:
    enum class BenchmarkMode {
       FLOW_1, /* 1x N-packet flow */
-      FLOW_N  /* Nx 1-packet flows */
+      FLOW_N, /* Nx 1-packet flows */
+      FLOW_MIX /* Mix of concurrent flows with realistic payload */
    };
    Benchmark();
    ~Benchmark();
@@ -115,7 +135,11 @@ private:
    struct timeval m_currentTs;
    uint64_t m_pktCnt;
 
+   TrafficMix *m_mix;
+   std::vector<uint8_t> m_mixBuffer;
+
    InputPlugin::Result check_constraints() const;
+   InputPlugin::Result getMix(PacketBlock &packets);
    void swapEndpoints(Packet *pkt);
    void generatePacket(Packet *pkt);
    void generatePacketFlow1(Packet *pkt);
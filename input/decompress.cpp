@@ -0,0 +1,383 @@
+/**
+ * \file decompress.cpp
+ * \brief Decompression of compressed files on a helper thread
+ * \date 2026
+ */
+/*
+ * Copyright (C) 2026 CESNET
+ *
+ * LICENSE TERMS
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name of the Company nor the names of its contributors
+ *    may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ *
+ *
+ */
+
+#include <config.h>
+#include <cerrno>
+#include <cstring>
+
+#ifdef WITH_ZLIB
+#include <zlib.h>
+#endif
+#ifdef WITH_ZSTD
+#include <zstd.h>
+#endif
+
+#include <ipfixprobe/plugin.hpp>
+
+#include "decompress.hpp"
+
+namespace ipxp {
+
+/**
+ * \brief State of decompression kept between fills of buffers.
+ */
+struct DecompressState {
+#ifdef WITH_ZLIB
+   z_stream zs;
+   bool in_member; /**< Inside of a gzip member */
+#endif
+#ifdef WITH_ZSTD
+   ZSTD_DStream *ds;
+   ZSTD_inBuffer in;
+   size_t hint; /**< Non-zero when the current zstd frame is not complete */
+#endif
+   bool eof; /**< All compressed data were read from file */
+};
+
+Decompressor::Decompressor(const std::string &file, Codec codec, bool threaded) :
+   m_codec(codec), m_fp(nullptr), m_input(nullptr), m_input_size(threaded ? DECOMPRESS_INPUT_SIZE : DECOMPRESS_SYNC_SIZE),
+   m_state(nullptr), m_thread(nullptr), m_stop(false), m_eof(false), m_error("")
+{
+   if (codec == Codec::NONE) {
+      // Uncompressed files are read by libpcap
+      throw PluginError(file + " is not compressed");
+   }
+#ifndef WITH_ZLIB
+   if (codec == Codec::GZIP) {
+      throw PluginError(file + " is gzip compressed, compile ipfixprobe with --with-zlib to read it");
+   }
+#endif
+#ifndef WITH_ZSTD
+   if (codec == Codec::ZSTD) {
+      throw PluginError(file + " is zstd compressed, compile ipfixprobe with --with-zstd to read it");
+   }
+#endif
+
+   m_fp = fopen(file.c_str(), "rb");
+   if (m_fp == nullptr) {
+      throw PluginError("unable to open file " + file + ": " + strerror(errno));
+   }
+
+   m_state = new DecompressState();
+   m_state->eof = false;
+#ifdef WITH_ZLIB
+   if (codec == Codec::GZIP) {
+      memset(&m_state->zs, 0, sizeof(m_state->zs));
+      m_state->in_member = false;
+      // Detect gzip header automatically
+      if (inflateInit2(&m_state->zs, 15 + 32) != Z_OK) {
+         delete m_state;
+         fclose(m_fp);
+         throw PluginError("unable to initialize zlib");
+      }
+   }
+#endif
+#ifdef WITH_ZSTD
+   if (codec == Codec::ZSTD) {
+      m_state->ds = ZSTD_createDStream();
+      if (m_state->ds == nullptr) {
+         delete m_state;
+         fclose(m_fp);
+         throw PluginError("unable to initialize zstd");
+      }
+      ZSTD_initDStream(m_state->ds);
+      m_state->hint = 0;
+   }
+#endif
+
+   m_input = new uint8_t[m_input_size];
+#ifdef WITH_ZSTD
+   m_state->in = {m_input, 0, 0};
+#endif
+   if (!threaded) {
+      m_buffers.push_back(new DecompressBuffer(DECOMPRESS_SYNC_SIZE));
+      return;
+   }
+   for (int i = 0; i < DECOMPRESS_BUFFERS; i++) {
+      m_buffers.push_back(new DecompressBuffer(DECOMPRESS_BUFFER_SIZE));
+      m_free.push_back(m_buffers.back());
+   }
+}
+
+Decompressor::~Decompressor()
+{
+   if (m_thread != nullptr) {
+      {
+         std::unique_lock<std::mutex> lock(m_mutex);
+         m_stop = true;
+      }
+      m_cond.notify_all();
+      m_thread->join();
+      delete m_thread;
+   }
+#ifdef WITH_ZLIB
+   if (m_codec == Codec::GZIP) {
+      inflateEnd(&m_state->zs);
+   }
+#endif
+#ifdef WITH_ZSTD
+   if (m_codec == Codec::ZSTD) {
+      ZSTD_freeDStream(m_state->ds);
+   }
+#endif
+   delete m_state;
+   for (auto &it : m_buffers) {
+      delete it;
+   }
+   delete[] m_input;
+   fclose(m_fp);
+}
+
+/**
+ * \brief Detect compression of file by its magic number.
+ */
+Decompressor::Codec Decompressor::detect(const std::string &file)
+{
+   uint8_t magic[4];
+   FILE *fp = fopen(file.c_str(), "rb");
+   if (fp == nullptr) {
+      return Codec::NONE;
+   }
+   size_t len = fread(magic, 1, sizeof(magic), fp);
+   fclose(fp);
+
+   if (len >= 2 && magic[0] == 0x1f && magic[1] == 0x8b) {
+      return Codec::GZIP;
+   }
+   if (len == 4 && magic[0] == 0x28 && magic[1] == 0xb5 && magic[2] == 0x2f && magic[3] == 0xfd) {
+      return Codec::ZSTD;
+   }
+   return Codec::NONE;
+}
+
+void Decompressor::start()
+{
+   m_thread = new std::thread(&Decompressor::decompress, this);
+}
+
+/**
+ * \brief Get next buffer of decompressed data, waits for the thread if needed.
+ *
+ * When the thread is not started, the only buffer is filled synchronously and its data
+ * are valid until the next call.
+ * \return Buffer which must be returned by release() or nullptr at the end of file.
+ */
+DecompressBuffer *Decompressor::next()
+{
+   if (m_thread == nullptr) {
+      DecompressBuffer *buf = m_buffers[0];
+      buf->used = 0;
+      if (!m_eof && !fill(buf, m_error)) {
+         m_eof = true;
+      }
+      if (buf->used) {
+         return buf;
+      }
+      if (!m_error.empty()) {
+         throw PluginError(m_error);
+      }
+      return nullptr;
+   }
+
+   std::unique_lock<std::mutex> lock(m_mutex);
+   m_cond.wait(lock, [this]() { return m_eof || !m_ready.empty(); });
+   if (!m_ready.empty()) {
+      DecompressBuffer *buf = m_ready.front();
+      m_ready.pop_front();
+      return buf;
+   }
+   if (!m_error.empty()) {
+      throw PluginError(m_error);
+   }
+   return nullptr;
+}
+
+void Decompressor::release(DecompressBuffer *buf)
+{
+   if (m_thread == nullptr) {
+      return;
+   }
+   {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      m_free.push_back(buf);
+   }
+   m_cond.notify_all();
+}
+
+DecompressBuffer *Decompressor::get_free()
+{
+   std::unique_lock<std::mutex> lock(m_mutex);
+   m_cond.wait(lock, [this]() { return m_stop || !m_free.empty(); });
+   if (m_stop) {
+      return nullptr;
+   }
+   DecompressBuffer *buf = m_free.front();
+   m_free.pop_front();
+   buf->used = 0;
+   return buf;
+}
+
+void Decompressor::push_ready(DecompressBuffer *buf)
+{
+   {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      if (buf->used) {
+         m_ready.push_back(buf);
+      } else {
+         m_free.push_back(buf);
+      }
+   }
+   m_cond.notify_all();
+}
+
+void Decompressor::finish(const std::string &error)
+{
+   {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      m_eof = true;
+      m_error = error;
+   }
+   m_cond.notify_all();
+}
+
+void Decompressor::decompress()
+{
+   std::string error = "";
+   DecompressBuffer *buf;
+   while ((buf = get_free()) != nullptr) {
+      bool more = fill(buf, error);
+      push_ready(buf);
+      if (!more) {
+         finish(error);
+         return;
+      }
+   }
+}
+
+/**
+ * \brief Append decompressed data to the buffer until it is full.
+ * \return False at the end of file or on error, which is stored to error then.
+ */
+bool Decompressor::fill(DecompressBuffer *buf, std::string &error)
+{
+   if (m_codec == Codec::GZIP) {
+      return fill_gzip(buf, error);
+   }
+   return fill_zstd(buf, error);
+}
+
+bool Decompressor::fill_gzip(DecompressBuffer *buf, std::string &error)
+{
+#ifdef WITH_ZLIB
+   z_stream &zs = m_state->zs;
+   while (buf->used < buf->size) {
+      if (zs.avail_in == 0 && !m_state->eof) {
+         size_t len = fread(m_input, 1, m_input_size, m_fp);
+         if (len == 0) {
+            if (ferror(m_fp)) {
+               error = "read error";
+               return false;
+            }
+            m_state->eof = true;
+         }
+         zs.next_in = m_input;
+         zs.avail_in = len;
+      }
+
+      zs.next_out = buf->data + buf->used;
+      zs.avail_out = buf->size - buf->used;
+      int ret = inflate(&zs, Z_NO_FLUSH);
+      buf->used = buf->size - zs.avail_out;
+      if (ret == Z_STREAM_END) {
+         // Concatenated gzip members can follow
+         inflateReset(&zs);
+         m_state->in_member = false;
+      } else if (ret == Z_OK) {
+         m_state->in_member = true;
+      } else if (ret != Z_BUF_ERROR) {
+         error = zs.msg != nullptr ? zs.msg : "invalid compressed data";
+         return false;
+      }
+
+      if (m_state->eof && buf->used < buf->size) {
+         if (m_state->in_member) {
+            error = "unexpected end of compressed data";
+         }
+         return false;
+      }
+   }
+   return true;
+#else
+   return false;
+#endif
+}
+
+bool Decompressor::fill_zstd(DecompressBuffer *buf, std::string &error)
+{
+#ifdef WITH_ZSTD
+   ZSTD_inBuffer &in = m_state->in;
+   while (buf->used < buf->size) {
+      if (in.pos == in.size && !m_state->eof) {
+         size_t len = fread(m_input, 1, m_input_size, m_fp);
+         if (len == 0) {
+            if (ferror(m_fp)) {
+               error = "read error";
+               return false;
+            }
+            m_state->eof = true;
+         }
+         in.size = len;
+         in.pos = 0;
+      }
+
+      ZSTD_outBuffer out = {buf->data, buf->size, buf->used};
+      size_t in_pos = in.pos;
+      size_t ret = ZSTD_decompressStream(m_state->ds, &out, &in);
+      if (ZSTD_isError(ret)) {
+         error = ZSTD_getErrorName(ret);
+         return false;
+      }
+      if (in.pos != in_pos || out.pos != buf->used) {
+         // Non-zero hint means the current frame is not complete
+         m_state->hint = ret;
+      }
+      buf->used = out.pos;
+
+      if (m_state->eof && buf->used < buf->size) {
+         if (m_state->hint != 0) {
+            error = "unexpected end of compressed data";
+         }
+         return false;
+      }
+   }
+   return true;
+#else
+   return false;
+#endif
+}
+
+}
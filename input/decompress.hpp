@@ -0,0 +1,127 @@
+/**
+ * \file decompress.hpp
+ * \brief Decompression of compressed files on a helper thread
+ * \date 2026
+ */
+/*
+ * Copyright (C) 2026 CESNET
+ *
+ * LICENSE TERMS
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name of the Company nor the names of its contributors
+ *    may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ *
+ *
+ */
+
+#ifndef IPXP_INPUT_DECOMPRESS_HPP
+#define IPXP_INPUT_DECOMPRESS_HPP
+
+#include <cstdio>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+namespace ipxp {
+
+/*
+ * \brief Size of one buffer of decompressed data.
+ */
+#define DECOMPRESS_BUFFER_SIZE (4 * 1024 * 1024)
+
+/*
+ * \brief Number of decompressed buffers shared by the thread and the reader.
+ */
+#define DECOMPRESS_BUFFERS 4
+
+/*
+ * \brief Size of compressed data read from file at once.
+ */
+#define DECOMPRESS_INPUT_SIZE (256 * 1024)
+
+/*
+ * \brief Size of input and output buffer when decompressing without the thread.
+ */
+#define DECOMPRESS_SYNC_SIZE (64 * 1024)
+
+/**
+ * \brief Buffer of decompressed data.
+ */
+struct DecompressBuffer {
+   uint8_t *data;
+   size_t size;
+   size_t used;
+
+   DecompressBuffer(size_t size) : data(new uint8_t[size]), size(size), used(0) {}
+   ~DecompressBuffer() { delete[] data; }
+};
+
+struct DecompressState;
+
+/**
+ * \brief Compressed file decompressed by a dedicated thread into a bounded queue of buffers.
+ *
+ * Without the thread, next() decompresses synchronously into a single small buffer, which is
+ * enough to read a file header cheaply.
+ */
+class Decompressor
+{
+public:
+   enum class Codec {
+      NONE, /**< File is not compressed */
+      GZIP,
+      ZSTD
+   };
+
+   Decompressor(const std::string &file, Codec codec, bool threaded = true);
+   ~Decompressor();
+
+   static Codec detect(const std::string &file);
+
+   void start();
+   DecompressBuffer *next();
+   void release(DecompressBuffer *buf);
+
+private:
+   Codec m_codec;
+   FILE *m_fp;
+   uint8_t *m_input;
+   size_t m_input_size;
+   DecompressState *m_state; /**< State of decompression stream */
+   std::thread *m_thread;
+   bool m_stop;
+   bool m_eof;
+   std::string m_error;
+
+   std::mutex m_mutex;
+   std::condition_variable m_cond;
+   std::vector<DecompressBuffer *> m_buffers;
+   std::deque<DecompressBuffer *> m_free; /**< Buffers to be filled by the thread */
+   std::deque<DecompressBuffer *> m_ready; /**< Buffers filled by the thread */
+
+   void decompress();
+   bool fill(DecompressBuffer *buf, std::string &error);
+   bool fill_gzip(DecompressBuffer *buf, std::string &error);
+   bool fill_zstd(DecompressBuffer *buf, std::string &error);
+   DecompressBuffer *get_free();
+   void push_ready(DecompressBuffer *buf);
+   void finish(const std::string &error);
+};
+
+}
+#endif /* IPXP_INPUT_DECOMPRESS_HPP */
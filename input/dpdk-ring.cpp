@@ -143,18 +143,10 @@ void DpdkRingReader::init(const char* params)
     }
 }
 
-struct timeval DpdkRingReader::getTimestamp(rte_mbuf* mbuf)
+timestamp_t DpdkRingReader::getTimestamp(rte_mbuf* mbuf)
 {
-    struct timeval tv;
     auto now = std::chrono::system_clock::now();
-    auto now_t = std::chrono::system_clock::to_time_t(now);
-
-    auto dur = now - std::chrono::system_clock::from_time_t(now_t);
-    auto micros = std::chrono::duration_cast<std::chrono::microseconds>(dur).count();
-
-    tv.tv_sec = now_t;
-    tv.tv_usec = micros;
-    return tv;
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(now.time_since_epoch()).count();
 }
 
 InputPlugin::Result DpdkRingReader::get(PacketBlock& packets) 
@@ -128,7 +128,7 @@ private:
     std::uint16_t pkts_read_;
 
     void createRteMbufs(uint16_t mbufsSize);
-    struct timeval getTimestamp(rte_mbuf *mbuf);
+    timestamp_t getTimestamp(rte_mbuf *mbuf);
     DpdkRingCore &m_dpdkRingCore;
     rte_ring *m_ring;
     bool is_reader_ready = false;
@@ -58,7 +58,7 @@ static bool convert_from_flexprobe(const rte_mbuf* mbuf, Packet& pkt)
 
     auto data_view = reinterpret_cast<const Flexprobe::FlexprobeData*>(rte_pktmbuf_mtod(mbuf, const uint8_t*) + DATA_OFFSET);
 
-    pkt.ts = { data_view->arrival_time.sec, data_view->arrival_time.nsec / 1000 };
+    pkt.ts = ts_from_sec_nsec(data_view->arrival_time.sec, data_view->arrival_time.nsec);
 
     std::memset(pkt.dst_mac, 0, sizeof(pkt.dst_mac));
     std::memset(pkt.src_mac, 0, sizeof(pkt.src_mac));
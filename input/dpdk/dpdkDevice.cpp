@@ -256,29 +256,15 @@ uint16_t DpdkDevice::receive(DpdkMbuf& dpdkMuf, uint16_t rxQueueID)
 	return receivedPackets;
 }
 
-timeval DpdkDevice::getPacketTimestamp(rte_mbuf* mbuf)
+timestamp_t DpdkDevice::getPacketTimestamp(rte_mbuf* mbuf)
 {
-	timeval tv;
 	if (m_isNfbDpdkDriver && (mbuf->ol_flags & m_rxTimestampDynflag)) {
-		static constexpr time_t nanosecInSec = 1000000000;
-		static constexpr time_t nsecInUsec = 1000;
-
 		rte_mbuf_timestamp_t timestamp
 			= *RTE_MBUF_DYNFIELD(mbuf, m_rxTimestampOffset, rte_mbuf_timestamp_t*);
-		tv.tv_sec = timestamp / nanosecInSec;
-		tv.tv_usec = (timestamp - ((tv.tv_sec) * nanosecInSec)) / nsecInUsec;
-
-		return tv;
+		return timestamp;
 	} else {
 		auto now = std::chrono::system_clock::now();
-		auto now_t = std::chrono::system_clock::to_time_t(now);
-
-		auto dur = now - std::chrono::system_clock::from_time_t(now_t);
-		auto micros = std::chrono::duration_cast<std::chrono::microseconds>(dur).count();
-
-		tv.tv_sec = now_t;
-		tv.tv_usec = micros;
-		return tv;
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(now.time_since_epoch()).count();
 	}
 }
 
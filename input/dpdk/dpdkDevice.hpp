@@ -27,6 +27,8 @@
 
 #include "dpdkMbuf.hpp"
 
+#include <ipfixprobe/timestamp.hpp>
+
 #include <rte_ethdev.h>
 #include <rte_mempool.h>
 #include <vector>
@@ -61,7 +63,7 @@ public:
 	 * @param mbuf The rte_mbuf structure representing the received packet.
 	 * @return The timestamp of the packet.
 	 */
-	timeval getPacketTimestamp(rte_mbuf* mbuf);
+	timestamp_t getPacketTimestamp(rte_mbuf* mbuf);
 
 	/**
 	 * @brief Destructs the DpdkDevice object.
@@ -0,0 +1,141 @@
+/**
+ * \file pacer.cpp
+ * \brief Pacing of replayed packets by their timestamps or by fixed rate
+ * \date 2026
+ */
+/*
+ * Copyright (C) 2026 CESNET
+ *
+ * LICENSE TERMS
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name of the Company nor the names of its contributors
+ *    may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ *
+ *
+ */
+
+#include <ctime>
+#include <sstream>
+#include <iomanip>
+
+#include "pacer.hpp"
+
+namespace ipxp {
+
+static uint64_t monotonic_ns()
+{
+   struct timespec now;
+   clock_gettime(CLOCK_MONOTONIC, &now);
+   return now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
+
+static void sleep_ns(uint64_t ns)
+{
+   struct timespec req = {static_cast<time_t>(ns / 1000000000), static_cast<long>(ns % 1000000000)};
+   nanosleep(&req, nullptr);
+}
+
+Pacer::Pacer(double speed, uint64_t pps) :
+   m_speed(speed), m_pps(pps), m_started(false), m_start(0), m_last(0), m_first_ts(0), m_last_ts(0),
+   m_packets(0), m_late(0)
+{
+}
+
+/**
+ * \brief Check whether packet can be sent, optionally wait for its scheduled time.
+ * \param [in] ts Capture timestamp of the packet.
+ * \param [in] sleep Wait at most PACER_MAX_SLEEP for the packet.
+ * \return True when the packet is due, it is accounted as sent then.
+ */
+bool Pacer::ready(timestamp_t ts, bool sleep)
+{
+   uint64_t now = monotonic_ns();
+   uint64_t ts_ns = ts;
+   if (!m_started) {
+      m_started = true;
+      m_start = now;
+      m_first_ts = ts_ns;
+   }
+
+   uint64_t target = m_start;
+   if (m_pps) {
+      target += m_packets * 1000000000ULL / m_pps;
+   } else if (ts_ns > m_first_ts) {
+      target += static_cast<uint64_t>((ts_ns - m_first_ts) / m_speed);
+   }
+
+   if (target > now) {
+      if (!sleep) {
+         return false;
+      }
+      uint64_t diff = target - now;
+      if (diff > PACER_MAX_SLEEP) {
+         sleep_ns(PACER_MAX_SLEEP);
+         return false;
+      }
+      if (diff > PACER_SPIN_TIME) {
+         sleep_ns(diff - PACER_SPIN_TIME);
+      }
+      while ((now = monotonic_ns()) < target) {
+      }
+   } else if (now - target > PACER_SPIN_TIME) {
+      m_late++;
+   }
+
+   m_packets++;
+   m_last = now;
+   m_last_ts = ts_ns;
+   return true;
+}
+
+/**
+ * \brief Get replay time corresponding to current monotonic time.
+ * Time runs scaled by speed from the first packet, it stays at the last packet when pacing by packet rate.
+ * \param [out] ts Current replay time.
+ * \return False when no packet was sent yet.
+ */
+bool Pacer::now(timestamp_t &ts) const
+{
+   if (!m_started) {
+      return false;
+   }
+   if (m_pps) {
+      ts = m_last_ts;
+   } else {
+      ts = m_first_ts + static_cast<uint64_t>((monotonic_ns() - m_start) * m_speed);
+   }
+   return true;
+}
+
+/**
+ * \brief Describe achieved and target replay rate.
+ */
+std::string Pacer::report() const
+{
+   std::ostringstream out;
+   double duration = (m_last - m_start) / 1e9;
+   double pps = duration > 0 ? (m_packets - 1) / duration : 0;
+
+   out << std::fixed << std::setprecision(2) << "replayed " << m_packets << " packets in " << duration << " s, ";
+   if (m_pps) {
+      out << "achieved " << pps << " pps, target " << m_pps << " pps";
+   } else {
+      double speed = duration > 0 && m_last_ts > m_first_ts ? (m_last_ts - m_first_ts) / 1e9 / duration : 0;
+      out << "achieved " << pps << " pps at speed " << speed << "x, target speed " << m_speed << "x";
+   }
+   out << ", " << m_late << " packets late";
+   return out.str();
+}
+
+}
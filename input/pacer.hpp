@@ -0,0 +1,78 @@
+/**
+ * \file pacer.hpp
+ * \brief Pacing of replayed packets by their timestamps or by fixed rate
+ * \date 2026
+ */
+/*
+ * Copyright (C) 2026 CESNET
+ *
+ * LICENSE TERMS
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name of the Company nor the names of its contributors
+ *    may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ *
+ *
+ */
+
+#ifndef IPXP_INPUT_PACER_HPP
+#define IPXP_INPUT_PACER_HPP
+
+#include <cstdint>
+#include <string>
+#include <ipfixprobe/timestamp.hpp>
+
+namespace ipxp {
+
+/*
+ * \brief Minimal and maximal replay speed multiplier.
+ */
+#define PACER_MIN_SPEED 0.1
+#define PACER_MAX_SPEED 100.0
+
+/*
+ * \brief Remaining time in nanoseconds waited by busy loop instead of sleeping.
+ */
+#define PACER_SPIN_TIME 50000
+
+/*
+ * \brief Maximal time in nanoseconds slept at once, input returns timeout after that.
+ */
+#define PACER_MAX_SLEEP 100000000
+
+/**
+ * \brief Schedules packets according to their capture timestamps scaled by speed or at fixed packet rate.
+ */
+class Pacer
+{
+public:
+   Pacer(double speed, uint64_t pps);
+
+   bool ready(timestamp_t ts, bool sleep);
+   bool now(timestamp_t &ts) const;
+   std::string report() const;
+
+private:
+   double m_speed;
+   uint64_t m_pps;
+   bool m_started;
+   uint64_t m_start;      /**< Monotonic time of the first packet in nanoseconds */
+   uint64_t m_last;       /**< Monotonic time of the last packet in nanoseconds */
+   uint64_t m_first_ts;   /**< Timestamp of the first packet in nanoseconds */
+   uint64_t m_last_ts;    /**< Timestamp of the last packet in nanoseconds */
+   uint64_t m_packets;
+   uint64_t m_late;       /**< Packets sent more than PACER_SPIN_TIME after their schedule */
+};
+
+}
+#endif /* IPXP_INPUT_PACER_HPP */
@@ -464,6 +464,7 @@ inline uint16_t parse_tcp_hdr(const u_char *data_ptr, uint16_t data_len, Packet
    pkt->tcp_ack = ntohl(tcp->ack_seq);
    pkt->tcp_flags = (uint8_t) *(data_ptr + 13) & 0xFF;
    pkt->tcp_window = ntohs(tcp->window);
+   pkt->l4_checksum = ntohs(tcp->check);
 
    DEBUG_MSG("TCP header:\n");
    DEBUG_MSG("\tSrc port:\t%u\n",   ntohs(tcp->source));
@@ -532,6 +533,7 @@ inline uint16_t parse_udp_hdr(const u_char *data_ptr, uint16_t data_len, Packet
 
    pkt->src_port = ntohs(udp->source);
    pkt->dst_port = ntohs(udp->dest);
+   pkt->l4_checksum = ntohs(udp->check);
 
    DEBUG_MSG("UDP header:\n");
    DEBUG_MSG("\tSrc port:\t%u\n",   ntohs(udp->source));
@@ -640,7 +642,7 @@ inline uint16_t process_pppoe(const u_char *data_ptr, uint16_t data_len, Packet
    return length;
 }
 
-void parse_packet(parser_opt_t *opt, struct timeval ts, const uint8_t *data, uint16_t len, uint16_t caplen)
+void parse_packet(parser_opt_t *opt, timestamp_t ts, const uint8_t *data, uint16_t len, uint16_t caplen)
 {
    if (opt->pblock->cnt >= opt->pblock->size) {
       return;
@@ -651,10 +653,10 @@ void parse_packet(parser_opt_t *opt, struct timeval ts, const uint8_t *data, uin
    DEBUG_MSG("---------- packet parser  #%u -------------\n", ++s_total_pkts);
    DEBUG_CODE(
       char timestamp[32];
-      time_t time = ts.tv_sec;
+      time_t time = ts_sec(ts);
       strftime(timestamp, sizeof(timestamp), "%FT%T", localtime(&time));
    );
-   DEBUG_MSG("Time:\t\t\t%s.%06lu\n",     timestamp, ts.tv_usec);
+   DEBUG_MSG("Time:\t\t\t%s.%09u\n",     timestamp, ts_nsec(ts));
    DEBUG_MSG("Packet length:\t\tcaplen=%uB len=%uB\n\n", caplen, len);
 
    pkt->packet_len_wire = len;
@@ -670,6 +672,7 @@ void parse_packet(parser_opt_t *opt, struct timeval ts, const uint8_t *data, uin
    pkt->tcp_window = 0;
    pkt->tcp_options = 0;
    pkt->tcp_mss = 0;
+   pkt->l4_checksum = 0;
    pkt->mplsTop = 0;
 
    uint32_t l3_hdr_offset = 0;
@@ -0,0 +1,250 @@
+/**
+ * \file pcap-stream.cpp
+ * \brief Pcap file stream with readahead thread
+ * \date 2026
+ */
+/*
+ * Copyright (C) 2026 CESNET
+ *
+ * LICENSE TERMS
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name of the Company nor the names of its contributors
+ *    may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ *
+ *
+ */
+
+#include <cstring>
+
+#include <ipfixprobe/plugin.hpp>
+
+#include "pcap-stream.hpp"
+
+namespace ipxp {
+
+/*
+ * \brief Maximum length of copied record data, longer records are truncated.
+ */
+#define STREAM_MAX_CAPLEN 65535
+
+PcapChunk::PcapChunk(size_t size) : data(new uint8_t[size]), size(size), used(0), eof(false), error("")
+{
+   records.reserve(STREAM_CHUNK_RECORDS);
+}
+
+PcapChunk::~PcapChunk()
+{
+   delete[] data;
+}
+
+PcapStream::PcapStream(const std::string &file, const std::string &filter, size_t order) :
+   m_file(file), m_order(order), m_handle(nullptr), m_walker(nullptr), m_datalink(0), m_thread(nullptr), m_stop(false), m_chunk(nullptr), m_idx(0)
+{
+   char errbuf[PCAP_ERRBUF_SIZE];
+
+   if (PcapWalker::is_compressed(file)) {
+      m_walker = new PcapWalker(file, filter);
+      m_datalink = m_walker->datalink();
+   } else {
+      m_handle = pcap_open_offline_nsec(file, errbuf);
+      if (m_handle == nullptr) {
+         throw PluginError(std::string("unable to open file: ") + errbuf);
+      }
+      m_datalink = pcap_datalink(m_handle);
+   }
+
+   if (m_handle != nullptr && !filter.empty()) {
+      struct bpf_program prog;
+      if (pcap_compile(m_handle, &prog, filter.c_str(), 0, PCAP_NETMASK_UNKNOWN) == -1) {
+         std::string err = pcap_geterr(m_handle);
+         pcap_close(m_handle);
+         throw PluginError("couldn't parse filter " + filter + ": " + err);
+      }
+      if (pcap_setfilter(m_handle, &prog) == -1) {
+         std::string err = pcap_geterr(m_handle);
+         pcap_freecode(&prog);
+         pcap_close(m_handle);
+         throw PluginError("couldn't parse filter " + filter + ": " + err);
+      }
+      pcap_freecode(&prog);
+   }
+
+   for (int i = 0; i < STREAM_CHUNKS; i++) {
+      m_chunks.push_back(new PcapChunk(STREAM_CHUNK_DATA + STREAM_MAX_CAPLEN));
+      m_free.push_back(m_chunks.back());
+   }
+}
+
+PcapStream::~PcapStream()
+{
+   if (m_thread != nullptr) {
+      {
+         std::unique_lock<std::mutex> lock(m_mutex);
+         m_stop = true;
+      }
+      m_cond.notify_all();
+      m_thread->join();
+      delete m_thread;
+   }
+   for (auto &it : m_chunks) {
+      delete it;
+   }
+   delete m_walker;
+   if (m_handle != nullptr) {
+      pcap_close(m_handle);
+   }
+}
+
+void PcapStream::start()
+{
+   m_thread = new std::thread(&PcapStream::read_ahead, this);
+}
+
+/**
+ * \brief Read next record from libpcap handle or from walker of compressed file.
+ * \return 1 on success, PCAP_ERROR_BREAK at the end of file or PCAP_ERROR.
+ */
+int PcapStream::read_record(PcapRecord &rec)
+{
+   if (m_walker != nullptr) {
+      // Record is copied to chunk before the next call
+      m_walker->release();
+      return m_walker->next(rec) ? 1 : PCAP_ERROR_BREAK;
+   }
+
+   struct pcap_pkthdr *hdr;
+   const u_char *data;
+   int ret = pcap_next_ex(m_handle, &hdr, &data);
+   if (ret == 1) {
+      rec = {ts_from_sec_nsec(hdr->ts.tv_sec, hdr->ts.tv_usec), hdr->caplen, hdr->len, data};
+   }
+   return ret;
+}
+
+void PcapStream::read_ahead()
+{
+   PcapRecord rec;
+   bool eof = false;
+
+   while (!eof) {
+      PcapChunk *chunk;
+      {
+         std::unique_lock<std::mutex> lock(m_mutex);
+         m_cond.wait(lock, [this]() { return m_stop || !m_free.empty(); });
+         if (m_stop) {
+            return;
+         }
+         chunk = m_free.front();
+         m_free.pop_front();
+      }
+
+      chunk->records.clear();
+      chunk->used = 0;
+      while (chunk->records.size() < STREAM_CHUNK_RECORDS && chunk->used < STREAM_CHUNK_DATA) {
+         int ret;
+         try {
+            ret = read_record(rec);
+         } catch (PluginError &e) {
+            chunk->eof = true;
+            chunk->error = e.what();
+            break;
+         }
+         if (ret == 1) {
+            uint32_t caplen = rec.caplen < STREAM_MAX_CAPLEN ? rec.caplen : STREAM_MAX_CAPLEN;
+            memcpy(chunk->data + chunk->used, rec.data, caplen);
+            chunk->records.push_back({rec.ts, caplen, rec.len, chunk->data + chunk->used});
+            chunk->used += caplen;
+         } else if (ret == PCAP_ERROR_BREAK) {
+            chunk->eof = true;
+            break;
+         } else {
+            chunk->eof = true;
+            chunk->error = pcap_geterr(m_handle);
+            break;
+         }
+      }
+      eof = chunk->eof;
+
+      {
+         std::unique_lock<std::mutex> lock(m_mutex);
+         m_ready.push_back(chunk);
+      }
+      m_cond.notify_all();
+   }
+}
+
+/**
+ * \brief Move to the next record, waits for readahead thread if needed.
+ * \return False at the end of file.
+ */
+bool PcapStream::next()
+{
+   if (m_chunk != nullptr && m_idx + 1 < m_chunk->records.size()) {
+      m_idx++;
+      return true;
+   }
+
+   while (1) {
+      if (m_chunk != nullptr) {
+         if (!m_chunk->error.empty()) {
+            throw PluginError(m_file + ": " + m_chunk->error);
+         }
+         if (m_chunk->eof) {
+            return false;
+         }
+         m_used.push_back(m_chunk);
+         m_chunk = nullptr;
+      }
+
+      {
+         std::unique_lock<std::mutex> lock(m_mutex);
+         m_cond.wait(lock, [this]() { return !m_ready.empty(); });
+         m_chunk = m_ready.front();
+         m_ready.pop_front();
+      }
+      m_idx = 0;
+      if (!m_chunk->records.empty()) {
+         return true;
+      }
+   }
+}
+
+/**
+ * \brief Check whether next() could wait for a chunk which is not released yet.
+ */
+bool PcapStream::must_release() const
+{
+   return m_chunk != nullptr && m_idx + 1 >= m_chunk->records.size() && !m_chunk->eof &&
+      m_used.size() + 2 > STREAM_CHUNKS;
+}
+
+/**
+ * \brief Return chunks of already consumed records to the readahead thread.
+ */
+void PcapStream::release()
+{
+   if (m_used.empty()) {
+      return;
+   }
+   {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      for (auto &it : m_used) {
+         m_free.push_back(it);
+      }
+   }
+   m_used.clear();
+   m_cond.notify_all();
+}
+
+}
@@ -0,0 +1,118 @@
+/**
+ * \file pcap-stream.hpp
+ * \brief Pcap file stream with readahead thread
+ * \date 2026
+ */
+/*
+ * Copyright (C) 2026 CESNET
+ *
+ * LICENSE TERMS
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name of the Company nor the names of its contributors
+ *    may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ *
+ *
+ */
+
+#ifndef IPXP_INPUT_PCAP_STREAM_HPP
+#define IPXP_INPUT_PCAP_STREAM_HPP
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <pcap/pcap.h>
+
+#include "pcap-walker.hpp"
+
+namespace ipxp {
+
+/*
+ * \brief Maximum number of records in one readahead chunk.
+ */
+#define STREAM_CHUNK_RECORDS 1024
+
+/*
+ * \brief Size of packet data in one readahead chunk.
+ */
+#define STREAM_CHUNK_DATA (1024 * 1024)
+
+/*
+ * \brief Number of chunks read ahead for each stream.
+ */
+#define STREAM_CHUNKS 4
+
+/**
+ * \brief Block of records together with their data.
+ */
+struct PcapChunk {
+   std::vector<PcapRecord> records;
+   uint8_t *data;
+   size_t size;
+   size_t used;
+   bool eof;
+   std::string error;
+
+   PcapChunk(size_t size);
+   ~PcapChunk();
+};
+
+/**
+ * \brief Pcap file read by a dedicated thread into chunks of records.
+ *
+ * Records returned by current() stay valid until release() is called.
+ */
+class PcapStream
+{
+public:
+   PcapStream(const std::string &file, const std::string &filter, size_t order = 0);
+   ~PcapStream();
+
+   void start();
+   bool next();
+   bool must_release() const;
+   void release();
+
+   const PcapRecord &current() const { return m_chunk->records[m_idx]; }
+   int datalink() const { return m_datalink; }
+   const std::string &file() const { return m_file; }
+   size_t order() const { return m_order; }
+
+private:
+   std::string m_file;
+   size_t m_order; /**< Position of file among merged files, breaks ties of timestamps */
+   pcap_t *m_handle;
+   PcapWalker *m_walker; /**< Reader of compressed file, used instead of libpcap handle */
+   int m_datalink;
+   std::thread *m_thread;
+   bool m_stop;
+
+   std::mutex m_mutex;
+   std::condition_variable m_cond;
+   std::vector<PcapChunk *> m_chunks;
+   std::deque<PcapChunk *> m_free; /**< Chunks to be filled by the thread */
+   std::deque<PcapChunk *> m_ready; /**< Chunks filled by the thread */
+   std::vector<PcapChunk *> m_used; /**< Consumed chunks waiting for release */
+
+   PcapChunk *m_chunk;
+   size_t m_idx;
+
+   void read_ahead();
+   int read_record(PcapRecord &rec);
+};
+
+}
+#endif /* IPXP_INPUT_PCAP_STREAM_HPP */
@@ -0,0 +1,423 @@
+/**
+ * \file pcap-walker.cpp
+ * \brief Walker over records of compressed pcap and pcapng files
+ * \date 2026
+ */
+/*
+ * Copyright (C) 2026 CESNET
+ *
+ * LICENSE TERMS
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name of the Company nor the names of its contributors
+ *    may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ *
+ *
+ */
+
+#include <cstring>
+#include <algorithm>
+
+#include <ipfixprobe/plugin.hpp>
+
+#include "pcap-walker.hpp"
+
+namespace ipxp {
+
+#define PCAP_MAGIC 0xa1b2c3d4
+#define PCAP_MAGIC_NSEC 0xa1b23c4d
+#define PCAPNG_BYTE_ORDER_MAGIC 0x1a2b3c4d
+
+#define PCAPNG_SHB 0x0a0d0d0a
+#define PCAPNG_IDB 1
+#define PCAPNG_SPB 3
+#define PCAPNG_EPB 6
+
+#define PCAPNG_OPT_END 0
+#define PCAPNG_OPT_TSRESOL 9
+
+// LINKTYPE_RAW differs from DLT_RAW, other supported link types have the same value
+#define LINKTYPE_RAW 101
+
+pcap_t *pcap_open_offline_nsec(const std::string &file, char *errbuf)
+{
+   return pcap_open_offline_with_tstamp_precision(file.c_str(), PCAP_TSTAMP_PRECISION_NANO, errbuf);
+}
+
+PcapWalker::PcapWalker(const std::string &file, const std::string &filter, bool threaded) :
+   m_input(file, Decompressor::detect(file), threaded), m_buf(nullptr), m_pos(0), m_pinned(false),
+   m_ng(false), m_swap(false), m_nsec(false), m_eof(false), m_datalink(-1), m_dead(nullptr)
+{
+   if (threaded) {
+      m_input.start();
+   }
+   read_header();
+
+   if (!filter.empty()) {
+      m_dead = pcap_open_dead(m_datalink, WALKER_MAX_CAPLEN);
+      if (m_dead == nullptr) {
+         throw PluginError("unable to create pcap handle for filter");
+      }
+      if (pcap_compile(m_dead, &m_prog, filter.c_str(), 0, PCAP_NETMASK_UNKNOWN) == -1) {
+         std::string err = pcap_geterr(m_dead);
+         pcap_close(m_dead);
+         throw PluginError("couldn't parse filter " + filter + ": " + err);
+      }
+   }
+}
+
+PcapWalker::~PcapWalker()
+{
+   if (m_dead != nullptr) {
+      pcap_freecode(&m_prog);
+      pcap_close(m_dead);
+   }
+}
+
+/**
+ * \brief Check whether file is compressed and must be read by the walker instead of libpcap.
+ */
+bool PcapWalker::is_compressed(const std::string &file)
+{
+   return Decompressor::detect(file) != Decompressor::Codec::NONE;
+}
+
+/**
+ * \brief Read next packet record.
+ * \return False at the end of file.
+ */
+bool PcapWalker::next(PcapRecord &rec)
+{
+   while (true) {
+      bool found = m_ng ? read_block(rec) : read_record(rec);
+      if (!found) {
+         if (m_eof) {
+            return false;
+         }
+         continue;
+      }
+      if (m_dead != nullptr) {
+         struct pcap_pkthdr hdr = {ts_to_timeval(rec.ts), rec.caplen, rec.len};
+         if (pcap_offline_filter(&m_prog, &hdr, rec.data) == 0) {
+            continue;
+         }
+      }
+      m_pinned = true;
+      return true;
+   }
+}
+
+/**
+ * \brief Check whether next() could wait for a buffer which is not released yet.
+ */
+bool PcapWalker::must_release() const
+{
+   return m_used.size() + 2 >= DECOMPRESS_BUFFERS;
+}
+
+/**
+ * \brief Return buffers of already consumed records to the decompression thread.
+ */
+void PcapWalker::release()
+{
+   for (auto &it : m_used) {
+      m_input.release(it);
+   }
+   m_used.clear();
+   m_carry.clear();
+}
+
+bool PcapWalker::fetch()
+{
+   if (m_buf != nullptr) {
+      // Buffers with skipped records only can be reused immediately
+      if (m_pinned) {
+         m_used.push_back(m_buf);
+      } else {
+         m_input.release(m_buf);
+      }
+   }
+   m_buf = m_input.next();
+   m_pos = 0;
+   m_pinned = false;
+   return m_buf != nullptr;
+}
+
+bool PcapWalker::at_eof()
+{
+   while (m_buf == nullptr || m_pos == m_buf->used) {
+      if (!fetch()) {
+         return true;
+      }
+   }
+   return false;
+}
+
+/**
+ * \brief Consume len bytes of data.
+ * \return Pointer to contiguous data, valid until release() is called.
+ */
+const uint8_t *PcapWalker::take(size_t len)
+{
+   if (at_eof()) {
+      throw PluginError("truncated dump file");
+   }
+   if (m_buf->used - m_pos >= len) {
+      const uint8_t *data = m_buf->data + m_pos;
+      m_pos += len;
+      return data;
+   }
+
+   std::vector<uint8_t> carry;
+   carry.reserve(len);
+   while (carry.size() < len) {
+      if (at_eof()) {
+         throw PluginError("truncated dump file");
+      }
+      size_t avail = std::min(m_buf->used - m_pos, len - carry.size());
+      carry.insert(carry.end(), m_buf->data + m_pos, m_buf->data + m_pos + avail);
+      m_pos += avail;
+   }
+   m_carry.push_back(std::move(carry));
+   return m_carry.back().data();
+}
+
+void PcapWalker::skip(size_t len)
+{
+   while (len) {
+      if (at_eof()) {
+         throw PluginError("truncated dump file");
+      }
+      size_t avail = std::min(m_buf->used - m_pos, len);
+      m_pos += avail;
+      len -= avail;
+   }
+}
+
+uint16_t PcapWalker::get16(const uint8_t *data) const
+{
+   uint16_t val;
+   memcpy(&val, data, sizeof(val));
+   return m_swap ? __builtin_bswap16(val) : val;
+}
+
+uint32_t PcapWalker::get32(const uint8_t *data) const
+{
+   uint32_t val;
+   memcpy(&val, data, sizeof(val));
+   return m_swap ? __builtin_bswap32(val) : val;
+}
+
+void PcapWalker::read_header()
+{
+   const uint8_t *data = take(4);
+   uint32_t magic;
+   memcpy(&magic, data, sizeof(magic));
+
+   if (magic == PCAPNG_SHB) {
+      m_ng = true;
+      uint32_t len;
+      memcpy(&len, take(4), sizeof(len));
+      read_section(len);
+      PcapRecord rec;
+      while (m_tsresol.empty() && !m_eof) {
+         if (read_block(rec)) {
+            throw PluginError("packet block precedes interface description block");
+         }
+      }
+      if (m_tsresol.empty()) {
+         throw PluginError("no interface description block found");
+      }
+      return;
+   }
+
+   if (magic == PCAP_MAGIC || magic == PCAP_MAGIC_NSEC) {
+      m_swap = false;
+   } else if (magic == __builtin_bswap32(PCAP_MAGIC) || magic == __builtin_bswap32(PCAP_MAGIC_NSEC)) {
+      m_swap = true;
+   } else {
+      throw PluginError("unknown file format");
+   }
+   m_nsec = get32(data) == PCAP_MAGIC_NSEC;
+
+   // Version, timezone, sigfigs and snaplen are not used
+   data = take(20);
+   set_datalink(get32(data + 16) & 0xffff);
+}
+
+/**
+ * \brief Read rest of section header block after its type.
+ * \param [in] len Block length with yet unknown byte order.
+ */
+void PcapWalker::read_section(uint32_t len)
+{
+   const uint8_t *data = take(4);
+   uint32_t magic;
+   memcpy(&magic, data, sizeof(magic));
+   if (magic == PCAPNG_BYTE_ORDER_MAGIC) {
+      m_swap = false;
+   } else if (magic == __builtin_bswap32(PCAPNG_BYTE_ORDER_MAGIC)) {
+      m_swap = true;
+   } else {
+      throw PluginError("unknown byte order of pcapng section");
+   }
+
+   uint32_t block_len = m_swap ? __builtin_bswap32(len) : len;
+   if (block_len < 28 || block_len % 4 || block_len > WALKER_MAX_BLOCK) {
+      throw PluginError("invalid section header block length");
+   }
+   skip(block_len - 12);
+
+   // Interface ids are local to section
+   m_tsresol.clear();
+   m_snaplen.clear();
+}
+
+void PcapWalker::read_interface(const uint8_t *body, size_t len)
+{
+   set_datalink(get16(body));
+   uint64_t tsresol = 1000000;
+
+   size_t off = 8;
+   while (off + 4 <= len) {
+      uint16_t code = get16(body + off);
+      uint16_t opt_len = get16(body + off + 2);
+      if (code == PCAPNG_OPT_END || off + 4 + opt_len > len) {
+         break;
+      }
+      if (code == PCAPNG_OPT_TSRESOL && opt_len >= 1) {
+         uint8_t val = body[off + 4];
+         uint8_t exp = val & 0x7f;
+         if ((val & 0x80 && exp > 63) || (!(val & 0x80) && exp > 19)) {
+            throw PluginError("unsupported timestamp resolution");
+         }
+         tsresol = 1;
+         for (uint8_t i = 0; i < exp; i++) {
+            tsresol *= (val & 0x80) ? 2 : 10;
+         }
+      }
+      off += 4 + ((opt_len + 3) & ~3);
+   }
+
+   m_tsresol.push_back(tsresol);
+   m_snaplen.push_back(get32(body + 4));
+}
+
+void PcapWalker::set_datalink(uint32_t linktype)
+{
+   int datalink = linktype == LINKTYPE_RAW ? DLT_RAW : static_cast<int>(linktype);
+   if (m_datalink != -1 && m_datalink != datalink) {
+      throw PluginError("interfaces with different link types are not supported");
+   }
+   m_datalink = datalink;
+}
+
+bool PcapWalker::read_record(PcapRecord &rec)
+{
+   if (at_eof()) {
+      m_eof = true;
+      return false;
+   }
+   const uint8_t *hdr = take(16);
+   rec.ts = m_nsec ? ts_from_sec_nsec(get32(hdr), get32(hdr + 4)) : ts_from_sec_usec(get32(hdr), get32(hdr + 4));
+   rec.caplen = get32(hdr + 8);
+   rec.len = get32(hdr + 12);
+   if (rec.caplen > WALKER_MAX_CAPLEN) {
+      throw PluginError("invalid captured length of packet record");
+   }
+   rec.data = take(rec.caplen);
+   return true;
+}
+
+/**
+ * \brief Read one pcapng block.
+ * \return True when the block contains a packet record.
+ */
+bool PcapWalker::read_block(PcapRecord &rec)
+{
+   if (at_eof()) {
+      m_eof = true;
+      return false;
+   }
+   const uint8_t *hdr = take(8);
+   uint32_t type = get32(hdr);
+   uint32_t len;
+   memcpy(&len, hdr + 4, sizeof(len));
+   if (type == PCAPNG_SHB) {
+      read_section(len);
+      return false;
+   }
+   len = get32(hdr + 4);
+   if (len < 12 || len % 4 || len > WALKER_MAX_BLOCK) {
+      throw PluginError("invalid block length");
+   }
+
+   if (type == PCAPNG_EPB) {
+      if (len < 32) {
+         throw PluginError("invalid enhanced packet block");
+      }
+      const uint8_t *body = take(20);
+      uint32_t iface = get32(body);
+      rec.caplen = get32(body + 12);
+      rec.len = get32(body + 16);
+      if (iface >= m_tsresol.size()) {
+         throw PluginError("packet refers to unknown interface");
+      }
+      if (rec.caplen > len - 32 || rec.caplen > WALKER_MAX_CAPLEN) {
+         throw PluginError("invalid captured length of packet record");
+      }
+
+      uint64_t ts = (static_cast<uint64_t>(get32(body + 4)) << 32) | get32(body + 8);
+      uint64_t units = m_tsresol[iface];
+      uint64_t frac = ts % units;
+      if (units >= NSEC_IN_SEC && units % NSEC_IN_SEC == 0) {
+         rec.ts = ts_from_sec_nsec(ts / units, frac / (units / NSEC_IN_SEC));
+      } else if (NSEC_IN_SEC % units == 0) {
+         rec.ts = ts_from_sec_nsec(ts / units, frac * (NSEC_IN_SEC / units));
+      } else {
+         rec.ts = ts_from_sec_nsec(ts / units, static_cast<double>(frac) * NSEC_IN_SEC / units);
+      }
+      rec.data = take(rec.caplen);
+      skip(len - 28 - rec.caplen);
+      return true;
+   } else if (type == PCAPNG_SPB) {
+      if (len < 16 || m_snaplen.empty()) {
+         throw PluginError("invalid simple packet block");
+      }
+      rec.len = get32(take(4));
+      rec.caplen = std::min(rec.len, len - 16);
+      if (m_snaplen[0] && rec.caplen > m_snaplen[0]) {
+         rec.caplen = m_snaplen[0];
+      }
+      if (rec.caplen > WALKER_MAX_CAPLEN) {
+         throw PluginError("invalid captured length of packet record");
+      }
+      // Simple packet block has no timestamp
+      rec.ts = 0;
+      rec.data = take(rec.caplen);
+      skip(len - 12 - rec.caplen);
+      return true;
+   } else if (type == PCAPNG_IDB) {
+      if (len < 20 || len > WALKER_MAX_CAPLEN) {
+         throw PluginError("invalid interface description block");
+      }
+      const uint8_t *body = take(len - 8);
+      read_interface(body, len - 12);
+      return false;
+   }
+
+   skip(len - 8);
+   return false;
+}
+
+}
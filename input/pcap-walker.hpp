@@ -0,0 +1,123 @@
+/**
+ * \file pcap-walker.hpp
+ * \brief Walker over records of compressed pcap and pcapng files
+ * \date 2026
+ */
+/*
+ * Copyright (C) 2026 CESNET
+ *
+ * LICENSE TERMS
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name of the Company nor the names of its contributors
+ *    may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ *
+ *
+ */
+
+#ifndef IPXP_INPUT_PCAP_WALKER_HPP
+#define IPXP_INPUT_PCAP_WALKER_HPP
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <sys/time.h>
+#include <pcap/pcap.h>
+#include <ipfixprobe/timestamp.hpp>
+
+#include "decompress.hpp"
+
+namespace ipxp {
+
+/*
+ * \brief Maximum captured length of a record, same as the limit of libpcap.
+ */
+#define WALKER_MAX_CAPLEN 262144
+
+/*
+ * \brief Maximum length of a pcapng block.
+ */
+#define WALKER_MAX_BLOCK (16 * 1024 * 1024)
+
+/**
+ * \brief Packet record read from a pcap file.
+ */
+struct PcapRecord {
+   timestamp_t ts;
+   uint32_t caplen;
+   uint32_t len;
+   const uint8_t *data;
+};
+
+/**
+ * \brief Open pcap file by libpcap, timestamps of packet headers are in seconds and nanoseconds.
+ */
+pcap_t *pcap_open_offline_nsec(const std::string &file, char *errbuf);
+
+/**
+ * \brief Reader of pcap and pcapng records from decompressed buffers.
+ *
+ * Records are returned without copying unless they cross a buffer boundary. Data of
+ * returned records stay valid until release() is called. Without the decompression thread,
+ * they are valid only until the next call of next().
+ */
+class PcapWalker
+{
+public:
+   PcapWalker(const std::string &file, const std::string &filter, bool threaded = true);
+   ~PcapWalker();
+
+   static bool is_compressed(const std::string &file);
+
+   bool next(PcapRecord &rec);
+   bool must_release() const;
+   void release();
+
+   int datalink() const { return m_datalink; }
+
+private:
+   Decompressor m_input;
+   DecompressBuffer *m_buf;
+   size_t m_pos;
+   bool m_pinned; /**< Current buffer contains data of a returned record */
+   std::vector<DecompressBuffer *> m_used; /**< Consumed buffers with returned records waiting for release */
+   std::vector<std::vector<uint8_t>> m_carry; /**< Copies of data crossing buffer boundary */
+
+   bool m_ng;
+   bool m_swap;
+   bool m_nsec;
+   bool m_eof;
+   int m_datalink;
+   std::vector<uint64_t> m_tsresol; /**< Timestamp units per second of pcapng interfaces */
+   std::vector<uint32_t> m_snaplen; /**< Snapshot length of pcapng interfaces */
+
+   pcap_t *m_dead;
+   struct bpf_program m_prog;
+
+   bool fetch();
+   bool at_eof();
+   const uint8_t *take(size_t len);
+   void skip(size_t len);
+   uint16_t get16(const uint8_t *data) const;
+   uint32_t get32(const uint8_t *data) const;
+
+   void read_header();
+   void read_section(uint32_t len);
+   void read_interface(const uint8_t *body, size_t len);
+   bool read_record(PcapRecord &rec);
+   bool read_block(PcapRecord &rec);
+   void set_datalink(uint32_t linktype);
+};
+
+}
+#endif /* IPXP_INPUT_PCAP_WALKER_HPP */
@@ -28,8 +28,16 @@
 
 #include <cstdio>
 #include <cstring>
+#include <cerrno>
+#include <ctime>
 #include <iostream>
 #include <iomanip>
+#include <algorithm>
+#include <dirent.h>
+#include <glob.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/stat.h>
 
 #include <pcap/pcap.h>
 
@@ -47,13 +55,7 @@ __attribute__((constructor)) static void register_this_plugin()
    register_plugin(&rec);
 }
 
-/**
- * \brief Parsing callback function for pcap_dispatch() call. Parse packets up to transport layer.
- * \param [in,out] arg Serves for passing pointer to Packet structure into callback function.
- * \param [in] h Contains timestamp and packet size.
- * \param [in] data Pointer to the captured packet data.
- */
-void packet_handler(u_char *arg, const struct pcap_pkthdr *h, const u_char *data)
+static inline void handle_packet(u_char *arg, const struct pcap_pkthdr *h, const u_char *data, bool nsec)
 {
 #ifdef __CYGWIN__
    // WinPcap, uses Microsoft's definition of struct timeval, which has `long` data type
@@ -64,19 +66,43 @@ void packet_handler(u_char *arg, const struct pcap_pkthdr *h, const u_char *data
    new_h.ts.tv_usec = *(reinterpret_cast<const uint32_t *>(h) + 1);
    new_h.caplen = *(reinterpret_cast<const uint32_t *>(h) + 2);
    new_h.len = *(reinterpret_cast<const uint32_t *>(h) + 3);
-   parse_packet((parser_opt_t *) arg, new_h.ts, data, new_h.len, new_h.caplen);
-#else
-   parse_packet((parser_opt_t *) arg, h->ts, data, h->len, h->caplen);
+   h = &new_h;
 #endif
+   timestamp_t ts = nsec ? ts_from_sec_nsec(h->ts.tv_sec, h->ts.tv_usec) : ts_from_sec_usec(h->ts.tv_sec, h->ts.tv_usec);
+   parse_packet((parser_opt_t *) arg, ts, data, h->len, h->caplen);
+}
+
+/**
+ * \brief Parsing callback function for pcap_dispatch() call. Parse packets up to transport layer.
+ * \param [in,out] arg Serves for passing pointer to Packet structure into callback function.
+ * \param [in] h Contains timestamp and packet size.
+ * \param [in] data Pointer to the captured packet data.
+ */
+void packet_handler(u_char *arg, const struct pcap_pkthdr *h, const u_char *data)
+{
+   handle_packet(arg, h, data, false);
+}
+
+/**
+ * \brief Parsing callback function for handles opened with nanosecond precision, tv_usec holds nanoseconds.
+ */
+void packet_handler_nsec(u_char *arg, const struct pcap_pkthdr *h, const u_char *data)
+{
+   handle_packet(arg, h, data, true);
 }
 
-PcapReader::PcapReader() : m_handle(nullptr), m_snaplen(-1), m_datalink(0), m_live(false), m_netmask(PCAP_NETMASK_UNKNOWN)
+PcapReader::PcapReader() : m_handle(nullptr), m_walker(nullptr), m_snaplen(-1), m_datalink(0), m_live(false), m_netmask(PCAP_NETMASK_UNKNOWN),
+   m_path(""), m_filter(""), m_watch(false), m_stream_mode(false), m_stream_cnt(0), m_pacer(nullptr), m_preload_idx(0), m_loop(0), m_loops(0), m_loop_span(0)
 {
 }
 
 PcapReader::~PcapReader()
 {
    close();
+   if (m_pacer != nullptr) {
+      std::cerr << "pcap: " << m_pacer->report() << std::endl;
+      delete m_pacer;
+   }
 }
 
 void PcapReader::init(const char *params)
@@ -101,6 +127,9 @@ void PcapReader::init(const char *params)
    }
 
    m_snaplen = parser.m_snaplen;
+   if (!m_snaplen) {
+      m_snaplen = m_capture_len && m_capture_len < MAX_SNAPLEN ? m_capture_len : MAX_SNAPLEN;
+   }
    if (m_snaplen < MIN_SNAPLEN) {
       std::cerr << "setting snapshot length to minimum value " << MIN_SNAPLEN << std::endl;
       m_snaplen = MIN_SNAPLEN;
@@ -109,15 +138,47 @@ void PcapReader::init(const char *params)
       m_snaplen = MAX_SNAPLEN;
    }
 
-   if (!parser.m_ifc.empty()) {
+   m_filter = parser.m_filter;
+   m_watch = parser.m_watch;
+   if (m_watch && (parser.m_merge || !is_batch(parser.m_file))) {
+      throw PluginError("watch mode requires a directory or a glob pattern");
+   }
+   if (parser.m_speed != 0 || parser.m_pps != 0) {
+      if (parser.m_speed != 0 && parser.m_pps != 0) {
+         throw PluginError("speed and pps options are mutually exclusive");
+      }
+      if (!parser.m_ifc.empty()) {
+         throw PluginError("replay pacing requires pcap files");
+      }
+      m_pacer = new Pacer(parser.m_speed, parser.m_pps);
+   }
+   if (parser.m_preload && (parser.m_merge || m_pacer != nullptr || !parser.m_ifc.empty() || is_batch(parser.m_file))) {
+      throw PluginError("loop replay requires a single pcap file and cannot be combined with merge, speed and pps options");
+   }
+
+   if (parser.m_merge) {
+      if (parser.m_file.empty()) {
+         throw PluginError("merge mode requires pcap files");
+      }
+      open_merge(parser.m_file);
+   } else if (!parser.m_ifc.empty()) {
       open_ifc(parser.m_ifc);
+      if (!m_filter.empty()) {
+         set_filter(m_filter);
+      }
+   } else if (parser.m_preload) {
+      m_loops = parser.m_loops;
+      preload(parser.m_file);
+   } else if (is_batch(parser.m_file)) {
+      m_path = parser.m_file;
+      scan_files();
+      if (m_files.empty() && !m_watch) {
+         throw PluginError("no pcap files found in " + m_path);
+      }
+      open_next_file();
    } else {
       open_file(parser.m_file);
    }
-
-   if (!parser.m_filter.empty()) {
-      set_filter(parser.m_filter);
-   }
 }
 
 void PcapReader::close()
@@ -126,21 +187,499 @@ void PcapReader::close()
       pcap_close(m_handle);
       m_handle = nullptr;
    }
+   delete m_walker;
+   m_walker = nullptr;
+   for (auto &it : m_streams) {
+      delete it;
+   }
+   for (auto &it : m_finished) {
+      delete it;
+   }
+   m_streams.clear();
+   m_finished.clear();
+   m_heap.clear();
+   m_pending.clear();
+   m_merge_files.clear();
+   m_stream_mode = false;
 }
 
 void PcapReader::open_file(const std::string &file)
 {
    char errbuf[PCAP_ERRBUF_SIZE];
 
-   m_handle = pcap_open_offline(file.c_str(), errbuf);
+   m_live = false;
+   if (m_pacer != nullptr) {
+      // Streams allow to check timestamp of the next packet without reading it
+      m_stream_mode = true;
+      open_stream(file);
+      return;
+   }
+   if (PcapWalker::is_compressed(file)) {
+      m_walker = new PcapWalker(file, m_filter);
+      m_datalink = m_walker->datalink();
+      check_datalink(m_datalink);
+      return;
+   }
+
+   m_handle = pcap_open_offline_nsec(file, errbuf);
    if (m_handle == nullptr) {
       throw PluginError(std::string("unable to open file: ") + errbuf);
    }
 
    m_datalink = pcap_datalink(m_handle);
-   m_live = false;
+   check_datalink(m_datalink);
+   if (!m_filter.empty()) {
+      set_filter(m_filter);
+   }
+}
+
+/**
+ * \brief Check whether path denotes a directory or a glob pattern instead of a single file.
+ */
+bool PcapReader::is_batch(const std::string &path) const
+{
+   struct stat st;
+   if (path.empty()) {
+      return false;
+   }
+   if (stat(path.c_str(), &st) == 0) {
+      return S_ISDIR(st.st_mode);
+   }
+   return path.find_first_of("*?[") != std::string::npos;
+}
+
+/**
+ * \brief Get regular files in the directory or matching the glob pattern.
+ */
+std::vector<std::string> PcapReader::list_files(const std::string &path) const
+{
+   std::vector<std::string> files;
+   struct stat st;
+
+   if (stat(path.c_str(), &st) == 0 && S_ISDIR(st.st_mode)) {
+      DIR *dir = opendir(path.c_str());
+      if (dir == nullptr) {
+         throw PluginError("unable to open directory " + path + ": " + strerror(errno));
+      }
+      struct dirent *ent;
+      while ((ent = readdir(dir)) != nullptr) {
+         if (ent->d_name[0] == '.') {
+            continue;
+         }
+         files.push_back(path + "/" + ent->d_name);
+      }
+      closedir(dir);
+   } else {
+      glob_t res;
+      int ret = glob(path.c_str(), 0, nullptr, &res);
+      if (ret != 0 && ret != GLOB_NOMATCH) {
+         globfree(&res);
+         throw PluginError("unable to expand glob pattern " + path);
+      }
+      for (size_t i = 0; i < res.gl_pathc; i++) {
+         files.push_back(res.gl_pathv[i]);
+      }
+      globfree(&res);
+   }
+
+   files.erase(std::remove_if(files.begin(), files.end(), [](const std::string &file) {
+      struct stat st;
+      return stat(file.c_str(), &st) != 0 || !S_ISREG(st.st_mode);
+   }), files.end());
+   return files;
+}
+
+/**
+ * \brief Read timestamp of the first packet and link type of file.
+ *
+ * Compressed files are decompressed without the thread and large buffers.
+ */
+static timestamp_t first_timestamp(const std::string &file, int &datalink)
+{
+   timestamp_t ts = 0;
+   if (PcapWalker::is_compressed(file)) {
+      PcapWalker walker(file, "", false);
+      PcapRecord rec;
+      if (walker.next(rec)) {
+         ts = rec.ts;
+      }
+      datalink = walker.datalink();
+      return ts;
+   }
+
+   char errbuf[PCAP_ERRBUF_SIZE];
+   pcap_t *handle = pcap_open_offline_nsec(file, errbuf);
+   if (handle == nullptr) {
+      throw PluginError(std::string("unable to open file: ") + errbuf);
+   }
+   struct pcap_pkthdr *hdr;
+   const u_char *data;
+   if (pcap_next_ex(handle, &hdr, &data) == 1) {
+      ts = ts_from_sec_nsec(hdr->ts.tv_sec, hdr->ts.tv_usec);
+   }
+   datalink = pcap_datalink(handle);
+   pcap_close(handle);
+   return ts;
+}
 
+/**
+ * \brief Queue new files ordered by timestamp of their first packet.
+ */
+void PcapReader::scan_files()
+{
+   std::vector<std::pair<timestamp_t, std::string>> found;
+   time_t now = time(nullptr);
+
+   for (auto &file : list_files(m_path)) {
+      struct stat st;
+      if (m_known_files.count(file) || stat(file.c_str(), &st) != 0) {
+         continue;
+      }
+      if (m_watch && st.st_mtime + WATCH_SETTLE_TIME > now) {
+         // File can be still written
+         continue;
+      }
+      m_known_files.insert(file);
+
+      int datalink;
+      try {
+         found.push_back(std::make_pair(first_timestamp(file, datalink), file));
+      } catch (PluginError &e) {
+         std::cerr << "skipping file " << file << ": " << e.what() << std::endl;
+      }
+   }
+
+   std::sort(found.begin(), found.end(), [](const std::pair<timestamp_t, std::string> &a, const std::pair<timestamp_t, std::string> &b) {
+      if (a.first != b.first) {
+         return a.first < b.first;
+      }
+      return a.second < b.second;
+   });
+   for (auto &it : found) {
+      m_files.push_back(it.second);
+   }
+}
+
+bool PcapReader::open_next_file()
+{
+   close();
+   if (m_files.empty()) {
+      return false;
+   }
+   std::string file = m_files.front();
+   m_files.pop_front();
+
+   open_file(file);
+   return true;
+}
+
+/**
+ * \brief Open comma separated list of files, directories or glob patterns for merging.
+ */
+void PcapReader::open_merge(const std::string &files)
+{
+   std::vector<std::pair<std::string, bool>> paths;
+   size_t begin = 0;
+   while (begin <= files.size()) {
+      size_t end = files.find(',', begin);
+      if (end == std::string::npos) {
+         end = files.size();
+      }
+      std::string path = files.substr(begin, end - begin);
+      trim_str(path);
+      if (!path.empty()) {
+         if (is_batch(path)) {
+            for (auto &it : list_files(path)) {
+               paths.push_back(std::make_pair(it, true));
+            }
+         } else {
+            paths.push_back(std::make_pair(path, false));
+         }
+      }
+      begin = end + 1;
+   }
+   if (paths.empty()) {
+      throw PluginError("no pcap files found in " + files);
+   }
+
+   // Files are opened only when the merge reaches their first packet, so only files with
+   // overlapping time ranges are read at the same time
+   for (auto &it : paths) {
+      timestamp_t ts;
+      try {
+         ts = first_timestamp(it.first, m_datalink);
+      } catch (PluginError &e) {
+         if (!it.second) {
+            throw;
+         }
+         // Directories and glob patterns can contain other files
+         std::cerr << "skipping file " << it.first << ": " << e.what() << std::endl;
+         continue;
+      }
+      check_datalink(m_datalink);
+      m_merge_files.push_back(std::make_pair(ts, it.first));
+   }
+   if (m_merge_files.empty()) {
+      throw PluginError("no pcap files found in " + files);
+   }
+   std::stable_sort(m_merge_files.begin(), m_merge_files.end(),
+      [](const std::pair<timestamp_t, std::string> &a, const std::pair<timestamp_t, std::string> &b) {
+         return a.first < b.first;
+      });
+   m_stream_mode = true;
+}
+
+/**
+ * \brief Compare current records of two streams, ties are broken by order of files.
+ */
+static bool stream_later(const PcapStream *a, const PcapStream *b)
+{
+   timestamp_t ts_a = a->current().ts;
+   timestamp_t ts_b = b->current().ts;
+   if (ts_a != ts_b) {
+      return ts_a > ts_b;
+   }
+   return a->order() > b->order();
+}
+
+void PcapReader::open_stream(const std::string &file)
+{
+   PcapStream *stream = new PcapStream(file, m_filter, m_stream_cnt++);
+   m_streams.push_back(stream);
+   m_datalink = stream->datalink();
    check_datalink(m_datalink);
+   stream->start();
+   advance_stream(stream);
+}
+
+/**
+ * \brief Move stream to its next record and put it to the heap.
+ *
+ * Finished stream is closed on the next call of get_merged(), when its packets are not used.
+ */
+void PcapReader::advance_stream(PcapStream *stream)
+{
+   if (stream->next()) {
+      m_heap.push_back(stream);
+      std::push_heap(m_heap.begin(), m_heap.end(), stream_later);
+      return;
+   }
+   m_streams.erase(std::find(m_streams.begin(), m_streams.end(), stream));
+   m_finished.push_back(stream);
+}
+
+InputPlugin::Result PcapReader::get_merged(PacketBlock &packets)
+{
+   parser_opt_t opt = {&packets, false, false, 0};
+   size_t seen = 0;
+
+   // Packets returned by previous call are not used anymore
+   for (auto &it : m_streams) {
+      it->release();
+   }
+   for (auto &it : m_finished) {
+      delete it;
+   }
+   m_finished.clear();
+   for (auto &it : m_pending) {
+      advance_stream(it);
+   }
+   m_pending.clear();
+
+   packets.cnt = 0;
+   while (packets.cnt < packets.size) {
+      if (!m_merge_files.empty() && (m_heap.empty() || m_merge_files.front().first <= m_heap.front()->current().ts)) {
+         // File starts before the next packet, it is merged from now on
+         std::string file = m_merge_files.front().second;
+         m_merge_files.pop_front();
+         open_stream(file);
+         continue;
+      }
+      if (m_heap.empty()) {
+         break;
+      }
+      if (m_pacer != nullptr && !m_pacer->ready(m_heap.front()->current().ts, packets.cnt == 0)) {
+         // Packets already in block are sent, otherwise cache is let to export expired flows
+         break;
+      }
+      std::pop_heap(m_heap.begin(), m_heap.end(), stream_later);
+      PcapStream *stream = m_heap.back();
+      const PcapRecord &rec = stream->current();
+      m_heap.pop_back();
+
+      opt.datalink = stream->datalink();
+      parse_packet(&opt, rec.ts, rec.data, rec.len, rec.caplen);
+      seen++;
+
+      if (stream->must_release()) {
+         m_pending.push_back(stream);
+         break;
+      }
+      advance_stream(stream);
+   }
+
+   m_seen += seen;
+   m_parsed += packets.cnt;
+   if (packets.cnt) {
+      return Result::PARSED;
+   }
+   if (m_heap.empty() && m_pending.empty()) {
+      if (!m_path.empty()) {
+         // Next file is opened on the next call
+         close();
+         return Result::NOT_PARSED;
+      }
+      return Result::END_OF_FILE;
+   }
+   if (m_pacer != nullptr && m_pending.empty() && seen == 0) {
+      return Result::TIMEOUT;
+   }
+   return Result::NOT_PARSED;
+}
+
+InputPlugin::Result PcapReader::get_walker(PacketBlock &packets)
+{
+   parser_opt_t opt = {&packets, false, false, m_datalink};
+   PcapRecord rec;
+   size_t seen = 0;
+
+   // Packets returned by previous call are not used anymore
+   m_walker->release();
+
+   packets.cnt = 0;
+   while (packets.cnt < packets.size && !m_walker->must_release()) {
+      if (!m_walker->next(rec)) {
+         if (packets.cnt) {
+            break;
+         }
+         if (m_path.empty()) {
+            return Result::END_OF_FILE;
+         }
+         // Next file is opened on the next call
+         close();
+         return Result::NOT_PARSED;
+      }
+      parse_packet(&opt, rec.ts, rec.data, rec.len, rec.caplen);
+      seen++;
+   }
+
+   m_seen += seen;
+   m_parsed += packets.cnt;
+   return packets.cnt ? Result::PARSED : Result::NOT_PARSED;
+}
+
+/**
+ * \brief Read all packets of file to memory for loop replay.
+ */
+void PcapReader::preload(const std::string &file)
+{
+   std::vector<size_t> offsets;
+   struct stat st;
+   PcapRecord rec;
+
+   open_file(file);
+   if (stat(file.c_str(), &st) == 0 && m_walker == nullptr) {
+      m_preload_data.reserve(st.st_size);
+   }
+   while (1) {
+      if (m_walker != nullptr) {
+         m_walker->release();
+         if (!m_walker->next(rec)) {
+            break;
+         }
+      } else {
+         struct pcap_pkthdr *hdr;
+         const u_char *data;
+         int ret = pcap_next_ex(m_handle, &hdr, &data);
+         if (ret == PCAP_ERROR_BREAK) {
+            break;
+         } else if (ret != 1) {
+            std::string err = pcap_geterr(m_handle);
+            close();
+            throw PluginError(err);
+         }
+         rec = {ts_from_sec_nsec(hdr->ts.tv_sec, hdr->ts.tv_usec), hdr->caplen, hdr->len, data};
+      }
+      offsets.push_back(m_preload_data.size());
+      m_preload_data.insert(m_preload_data.end(), rec.data, rec.data + rec.caplen);
+      m_preload.push_back(rec);
+   }
+   close();
+
+   if (m_preload.empty()) {
+      throw PluginError("no packets to replay in " + file);
+   }
+   for (size_t i = 0; i < m_preload.size(); i++) {
+      m_preload[i].data = m_preload_data.data() + offsets[i];
+   }
+
+   timestamp_t first = m_preload.front().ts;
+   timestamp_t last = m_preload.back().ts;
+   m_loop_span = last > first ? last - first + 1 : 1;
+}
+
+/**
+ * \brief Distinguish flows of loop replays by rewriting IP addresses and ports.
+ *
+ * Both addresses and ports are changed by the same mask, so both directions of a biflow stay paired.
+ * Only TCP and UDP ports from 1024 up are changed and they stay in that range, so well-known service
+ * ports recognized by process plugins are kept.
+ */
+static void rewrite_addresses(Packet &pkt, uint64_t loop)
+{
+   uint32_t mask = static_cast<uint32_t>(loop * 0x9e3779b1ULL);
+   if (pkt.ip_version == IP::v4) {
+      pkt.src_ip.v4 ^= mask;
+      pkt.dst_ip.v4 ^= mask;
+   } else if (pkt.ip_version == IP::v6) {
+      reinterpret_cast<uint32_t *>(pkt.src_ip.v6)[3] ^= mask;
+      reinterpret_cast<uint32_t *>(pkt.dst_ip.v6)[3] ^= mask;
+   }
+
+   if (pkt.ip_proto == IPPROTO_TCP || pkt.ip_proto == IPPROTO_UDP) {
+      uint16_t port_mask = (mask >> 16) & 0x3ff;
+      if (pkt.src_port >= 1024) {
+         pkt.src_port ^= port_mask;
+      }
+      if (pkt.dst_port >= 1024) {
+         pkt.dst_port ^= port_mask;
+      }
+   }
+}
+
+InputPlugin::Result PcapReader::get_preloaded(PacketBlock &packets)
+{
+   parser_opt_t opt = {&packets, false, false, m_datalink};
+   size_t seen = 0;
+
+   packets.cnt = 0;
+   while (packets.cnt < packets.size) {
+      if (m_preload_idx == m_preload.size()) {
+         if (m_loops && m_loop + 1 >= m_loops) {
+            break;
+         }
+         m_preload_idx = 0;
+         m_loop++;
+      }
+      const PcapRecord &rec = m_preload[m_preload_idx++];
+
+      // Replays follow each other in time
+      timestamp_t ts = rec.ts + m_loop * m_loop_span;
+
+      size_t cnt = packets.cnt;
+      parse_packet(&opt, ts, rec.data, rec.len, rec.caplen);
+      seen++;
+      if (m_loop && packets.cnt > cnt) {
+         rewrite_addresses(packets.pkts[cnt], m_loop);
+      }
+   }
+
+   m_seen += seen;
+   m_parsed += packets.cnt;
+   if (packets.cnt) {
+      return Result::PARSED;
+   }
+   return seen ? Result::NOT_PARSED : Result::END_OF_FILE;
 }
 
 void PcapReader::open_ifc(const std::string &ifc)
@@ -173,9 +712,9 @@ void PcapReader::open_ifc(const std::string &ifc)
 
 void PcapReader::check_datalink(int datalink)
 {
-   if (m_datalink != DLT_EN10MB && m_datalink != DLT_LINUX_SLL && m_datalink != DLT_RAW) {
+   if (datalink != DLT_EN10MB && datalink != DLT_LINUX_SLL && datalink != DLT_RAW) {
 #ifdef DLT_LINUX_SLL2
-      if (m_datalink == DLT_LINUX_SLL2) {
+      if (datalink == DLT_LINUX_SLL2) {
          // DLT_LINUX_SLL2 is also supported
          return;
       } else {
@@ -244,17 +783,60 @@ void PcapReader::set_filter(const std::string &filter_str)
    pcap_freecode(&filter);
 }
 
+bool PcapReader::wait(uint32_t timeout)
+{
+   if (!m_live) {
+      return false;
+   }
+   struct pollfd pfd = {pcap_get_selectable_fd(m_handle), POLLIN, 0};
+   if (pfd.fd < 0) {
+      return false;
+   }
+   if (poll(&pfd, 1, timeout) == -1 && errno != EINTR) {
+      throw PluginError(std::string("poll: ") + strerror(errno));
+   }
+   return true;
+}
+
+bool PcapReader::now(timestamp_t &ts) const
+{
+   return m_pacer != nullptr && m_pacer->now(ts);
+}
+
 InputPlugin::Result PcapReader::get(PacketBlock &packets)
 {
    parser_opt_t opt = {&packets, false, false, m_datalink};
    int ret;
 
-   if (m_handle == nullptr) {
-      throw PluginError("no interface capture or file opened");
+   if (!m_preload.empty()) {
+      return get_preloaded(packets);
+   }
+   if (m_stream_mode) {
+      return get_merged(packets);
+   }
+   if (m_handle == nullptr && m_walker == nullptr) {
+      if (m_path.empty()) {
+         throw PluginError("no interface capture or file opened");
+      }
+      if (m_files.empty() && m_watch) {
+         // Flows are not expired while waiting, they can continue in the next file
+         usleep(WATCH_SCAN_INTERVAL * 1000);
+         scan_files();
+      }
+      if (!open_next_file()) {
+         return m_watch ? Result::NOT_PARSED : Result::END_OF_FILE;
+      }
+      if (m_stream_mode) {
+         return get_merged(packets);
+      }
+   }
+
+   if (m_walker != nullptr) {
+      return get_walker(packets);
    }
 
    packets.cnt = 0;
-   ret = pcap_dispatch(m_handle, PCAP_PACKET_BLOCK_SIZE, packet_handler, (u_char *) (&opt));
+   ret = pcap_dispatch(m_handle, PCAP_PACKET_BLOCK_SIZE, m_live ? packet_handler : packet_handler_nsec, (u_char *) (&opt));
    if (m_live) {
       if (ret == 0) {
          return Result::TIMEOUT;
@@ -270,7 +852,12 @@ InputPlugin::Result PcapReader::get(PacketBlock &packets)
          m_parsed += opt.pblock->cnt;
          return Result::PARSED;
       } else if (ret == 0) {
-         return Result::END_OF_FILE;
+         if (m_path.empty()) {
+            return Result::END_OF_FILE;
+         }
+         // Next file is opened on the next call
+         close();
+         return Result::NOT_PARSED;
       }
    }
    if (ret < 0) {
@@ -29,6 +29,10 @@
 #ifndef IPXP_INPUT_PCAP_HPP
 #define IPXP_INPUT_PCAP_HPP
 
+#include <deque>
+#include <set>
+#include <string>
+#include <vector>
 #include <pcap/pcap.h>
 
 #include <ipfixprobe/input.hpp>
@@ -36,6 +40,9 @@
 #include <ipfixprobe/options.hpp>
 #include <ipfixprobe/utils.hpp>
 
+#include "pcap-stream.hpp"
+#include "pacer.hpp"
+
 namespace ipxp {
 
 /*
@@ -51,6 +58,12 @@ namespace ipxp {
 // Read timeout in miliseconds for pcap_open_live function.
 #define READ_TIMEOUT 1000
 
+// Interval in miliseconds between scans for new files in watch mode.
+#define WATCH_SCAN_INTERVAL 100
+
+// Files modified in last WATCH_SETTLE_TIME seconds are considered incomplete in watch mode.
+#define WATCH_SETTLE_TIME 5
+
 class PcapOptParser : public OptionsParser
 {
 public:
@@ -60,17 +73,39 @@ public:
    uint16_t m_snaplen;
    uint64_t m_id;
    bool m_list;
+   bool m_watch;
+   bool m_merge;
+   double m_speed;
+   uint64_t m_pps;
+   bool m_preload;
+   uint64_t m_loops;
 
    PcapOptParser() : OptionsParser("pcap", "Input plugin for reading packets from a pcap file or a network interface"),
-      m_file(""), m_ifc(""), m_filter(""), m_snaplen(-1), m_id(0), m_list(false)
+      m_file(""), m_ifc(""), m_filter(""), m_snaplen(0), m_id(0), m_list(false), m_watch(false), m_merge(false),
+      m_speed(0), m_pps(0), m_preload(false), m_loops(0)
    {
-      register_option("f", "file", "PATH", "Path to a pcap file", [this](const char *arg){m_file = arg; return true;}, OptionFlags::RequiredArgument);
+      register_option("f", "file", "PATH", "Path to a pcap file, a directory or a glob pattern. Files are read in order of their first packet timestamp, gzip and zstd compressed files are decompressed on the fly",
+         [this](const char *arg){m_file = arg; return true;}, OptionFlags::RequiredArgument);
       register_option("i", "ifc", "IFC", "Network interface name", [this](const char *arg){m_ifc = arg; return true;}, OptionFlags::RequiredArgument);
       register_option("F", "filter", "STR", "Filter string", [this](const char *arg){m_filter = arg; return true;}, OptionFlags::RequiredArgument);
-      register_option("s", "snaplen", "SIZE", "Snapshot length in bytes (live capture only)",
+      register_option("s", "snaplen", "SIZE", "Snapshot length in bytes (live capture only), derived from enabled process plugins by default",
          [this](const char *arg){try {m_snaplen = str2num<decltype(m_snaplen)>(arg);} catch(std::invalid_argument &e) {return false;} return true;},
          OptionFlags::RequiredArgument);
       register_option("l", "list", "", "Print list of available interfaces", [this](const char *arg){m_list = true; return true;}, OptionFlags::NoArgument);
+      register_option("w", "watch", "", "Keep waiting for new files in the directory or matching the glob pattern",
+         [this](const char *arg){m_watch = true; return true;}, OptionFlags::NoArgument);
+      register_option("m", "merge", "", "Read comma separated files (or all files of directories and glob patterns) in parallel and merge packets by timestamp",
+         [this](const char *arg){m_merge = true; return true;}, OptionFlags::NoArgument);
+      register_option("x", "speed", "NUM", "Replay files according to packet timestamps at speed multiplied by NUM (0.1-100)",
+         [this](const char *arg){try {m_speed = str2num<decltype(m_speed)>(arg);} catch(std::invalid_argument &e) {return false;}
+            return m_speed >= PACER_MIN_SPEED && m_speed <= PACER_MAX_SPEED;},
+         OptionFlags::RequiredArgument);
+      register_option("r", "pps", "NUM", "Replay files at fixed rate of NUM packets per second",
+         [this](const char *arg){try {m_pps = str2num<decltype(m_pps)>(arg);} catch(std::invalid_argument &e) {return false;} return m_pps > 0;},
+         OptionFlags::RequiredArgument);
+      register_option("L", "loop", "NUM", "Load file to memory and replay it NUM times (0 for infinite), IP addresses and ports are rewritten in each replay to create new flows",
+         [this](const char *arg){try {m_loops = str2num<decltype(m_loops)>(arg);} catch(std::invalid_argument &e) {return false;} m_preload = true; return true;},
+         OptionFlags::RequiredArgument);
    }
 };
 
@@ -88,23 +123,63 @@ public:
    OptionsParser *get_parser() const { return new PcapOptParser(); }
    std::string get_name() const { return "pcap"; }
    InputPlugin::Result get(PacketBlock &packets);
+   bool wait(uint32_t timeout);
+   bool now(timestamp_t &ts) const;
 
 private:
    pcap_t *m_handle;          /**< libpcap file handle */
+   PcapWalker *m_walker;      /**< Reader of compressed file */
    uint16_t m_snaplen;
    int m_datalink;
    bool m_live;               /**< Capturing from network interface */
    bpf_u_int32 m_netmask;       /**< Network mask. Used when setting filter */
 
+   std::string m_path;        /**< Directory or glob pattern of pcap files */
+   std::string m_filter;
+   bool m_watch;
+   std::deque<std::string> m_files; /**< Files waiting to be read */
+   std::set<std::string> m_known_files; /**< Files read or queued already */
+
+   bool m_stream_mode;        /**< Files are read as streams, merged by timestamp */
+   std::vector<PcapStream *> m_streams; /**< Open streams which did not reach the end of file */
+   std::vector<PcapStream *> m_heap; /**< Min-heap of streams ordered by timestamp of current record */
+   std::vector<PcapStream *> m_pending; /**< Streams waiting for release of chunks before advancing */
+   std::vector<PcapStream *> m_finished; /**< Streams at the end of file, closed with release of their packets */
+   std::deque<std::pair<timestamp_t, std::string>> m_merge_files; /**< Files not opened yet ordered by first packet */
+   size_t m_stream_cnt;       /**< Number of opened streams */
+   Pacer *m_pacer;            /**< Replay pacing, files are read as streams then */
+
+   std::vector<uint8_t> m_preload_data; /**< Data of all packets of preloaded file */
+   std::vector<PcapRecord> m_preload; /**< Records of preloaded file */
+   size_t m_preload_idx;
+   uint64_t m_loop;           /**< Current replay of preloaded file */
+   uint64_t m_loops;          /**< Number of replays, 0 for infinite */
+   uint64_t m_loop_span;      /**< Timestamp shift between replays in nanoseconds */
+
    void open_file(const std::string &file);
+   InputPlugin::Result get_walker(PacketBlock &packets);
    void open_ifc(const std::string &ifc);
    void set_filter(const std::string &filter_str);
 
+   bool is_batch(const std::string &path) const;
+   std::vector<std::string> list_files(const std::string &path) const;
+   void scan_files();
+   bool open_next_file();
+
+   void open_merge(const std::string &files);
+   void open_stream(const std::string &file);
+   void advance_stream(PcapStream *stream);
+   InputPlugin::Result get_merged(PacketBlock &packets);
+
+   void preload(const std::string &file);
+   InputPlugin::Result get_preloaded(PacketBlock &packets);
+
    void check_datalink(int datalink);
    void print_available_ifcs();
 };
 
 void packet_handler(u_char *arg, const struct pcap_pkthdr *h, const u_char *data);
+void packet_handler_nsec(u_char *arg, const struct pcap_pkthdr *h, const u_char *data);
 
 }
 #endif /* IPXP_INPUT_PCAP_HPP */
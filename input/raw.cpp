@@ -36,6 +36,7 @@
 #include <unistd.h>
 #include <poll.h>
 #include <linux/if_packet.h>
+#include <linux/filter.h>
 #include <arpa/inet.h>
 #include <sys/socket.h>
 #include <sys/types.h>
@@ -45,6 +46,10 @@
 #include <net/if.h>
 #include <ifaddrs.h>
 
+#ifdef WITH_PCAP
+#include <pcap/pcap.h>
+#endif
+
 #include "raw.hpp"
 #include "parser.hpp"
 
@@ -63,7 +68,7 @@ __attribute__((constructor)) static void register_this_plugin()
    register_plugin(&rec);
 }
 
-RawReader::RawReader() : m_sock(-1), m_fanout(0), m_rd(nullptr), m_pfd({0}), m_buffer(nullptr), m_buffer_size(0),
+RawReader::RawReader() : m_sock(-1), m_fanout(0), m_snaplen(0), m_rd(nullptr), m_pfd({0}), m_buffer(nullptr), m_buffer_size(0),
    m_block_idx(0), m_blocksize(0), m_framesize(0), m_blocknum(0), m_last_ppd(nullptr), m_pbd(nullptr), m_pkts_left(0)
 {
 }
@@ -88,6 +93,7 @@ void RawReader::init(const char *params)
    }
 
    m_fanout = parser.m_fanout;
+   m_snaplen = parser.m_snaplen ? parser.m_snaplen : m_capture_len;
    if (parser.m_ifc.empty()) {
       throw PluginError("specify network interface");
    }
@@ -105,7 +111,7 @@ void RawReader::init(const char *params)
       m_framesize = pagesize;
    }
 
-   open_ifc(parser.m_ifc);
+   open_ifc(parser.m_ifc, parser.m_filter);
 }
 
 void RawReader::close()
@@ -124,7 +130,7 @@ void RawReader::close()
    }
 }
 
-void RawReader::open_ifc(const std::string &ifc)
+void RawReader::open_ifc(const std::string &ifc, const std::string &filter)
 {
    int sock = socket(AF_PACKET, SOCK_RAW, htons(ETH_P_ALL));
    if (sock == -1) {
@@ -164,6 +170,15 @@ void RawReader::open_ifc(const std::string &ifc)
       throw PluginError(std::string("unable to set ifc to promisc mode: ") + strerror(errno));
    }
 
+   if (!filter.empty() || m_snaplen) {
+      try {
+         attach_filter(sock, filter, m_snaplen);
+      } catch (PluginError &e) {
+         ::close(sock);
+         throw;
+      }
+   }
+
    struct tpacket_req3 req;
    memset(&req, 0, sizeof(req));
 
@@ -242,16 +257,52 @@ void RawReader::open_ifc(const std::string &ifc)
    m_pbd = (struct tpacket_block_desc *) m_rd[m_block_idx].iov_base;
 }
 
-bool RawReader::get_block()
+void RawReader::attach_filter(int sock, const std::string &filter, uint32_t snaplen)
 {
-   if ((m_pbd->hdr.bh1.block_status & TP_STATUS_USER) == 0) {
-      // No data available at the moment
-      if (poll(&m_pfd, 1, 0) == -1) {
-         throw PluginError(std::string("poll: ") + strerror(errno));
+   // Filter is attached before the ring is set up, so no unfiltered packet gets into the ring.
+   // Return value of the filter is the number of bytes of the packet copied to the ring.
+   uint32_t caplen = snaplen ? snaplen : 65535;
+   struct sock_filter accept = BPF_STMT(BPF_RET | BPF_K, caplen);
+   struct sock_fprog fprog = {1, &accept};
+#ifdef WITH_PCAP
+   struct bpf_program prog = {0, nullptr};
+   if (!filter.empty()) {
+      pcap_t *handle = pcap_open_dead(DLT_EN10MB, caplen);
+      if (handle == nullptr) {
+         throw PluginError("unable to compile filter");
       }
-      return false;
+      if (pcap_compile(handle, &prog, filter.c_str(), 1, PCAP_NETMASK_UNKNOWN) == -1) {
+         std::string err = pcap_geterr(handle);
+         pcap_close(handle);
+         throw PluginError("couldn't parse filter " + filter + ": " + err);
+      }
+      pcap_close(handle);
+
+      // struct bpf_insn has the same layout as struct sock_filter
+      fprog.len = prog.bf_len;
+      fprog.filter = reinterpret_cast<struct sock_filter *>(prog.bf_insns);
    }
-   return true;
+#else
+   if (!filter.empty()) {
+      throw PluginError("filter is supported only when compiled with libpcap");
+   }
+#endif
+
+   int ret = setsockopt(sock, SOL_SOCKET, SO_ATTACH_FILTER, &fprog, sizeof(fprog));
+#ifdef WITH_PCAP
+   if (prog.bf_insns != nullptr) {
+      pcap_freecode(&prog);
+   }
+#endif
+   if (ret == -1) {
+      throw PluginError(std::string("unable to attach filter: ") + strerror(errno));
+   }
+}
+
+bool RawReader::get_block()
+{
+   // No data available at the moment when the block is still owned by kernel
+   return (m_pbd->hdr.bh1.block_status & TP_STATUS_USER) != 0;
 }
 
 void RawReader::return_block()
@@ -307,7 +358,7 @@ int RawReader::process_packets(struct tpacket_block_desc *pbd, PacketBlock &pack
       const u_char *data = (uint8_t *) ppd + ppd->tp_mac;
       size_t len = ppd->tp_len;
       size_t snaplen = ppd->tp_snaplen;
-      struct timeval ts = {ppd->tp_sec, ppd->tp_nsec / 1000};
+      timestamp_t ts = ts_from_sec_nsec(ppd->tp_sec, ppd->tp_nsec);
 
       parse_packet(&opt, ts, data, len, snaplen);
       ppd = (struct tpacket3_hdr *) ((uint8_t *) ppd + ppd->tp_next_offset);
@@ -362,4 +413,15 @@ InputPlugin::Result RawReader::get(PacketBlock &packets)
    return packets.cnt ? Result::PARSED : Result::NOT_PARSED;
  }
 
+bool RawReader::wait(uint32_t timeout)
+{
+   if (m_pkts_left || get_block()) {
+      return true;
+   }
+   if (poll(&m_pfd, 1, timeout) == -1 && errno != EINTR) {
+      throw PluginError(std::string("poll: ") + strerror(errno));
+   }
+   return true;
+}
+
 }
@@ -42,13 +42,15 @@ class RawOptParser : public OptionsParser
 {
 public:
    std::string m_ifc;
+   std::string m_filter;
+   uint32_t m_snaplen;
    uint16_t m_fanout;
    uint32_t m_block_cnt;
    uint32_t m_pkt_cnt;
    bool m_list;
 
    RawOptParser() : OptionsParser("raw", "Input plugin for reading packets from a raw socket"),
-      m_ifc(""), m_fanout(0), m_block_cnt(2048), m_pkt_cnt(32), m_list(false)
+      m_ifc(""), m_filter(""), m_snaplen(0), m_fanout(0), m_block_cnt(2048), m_pkt_cnt(32), m_list(false)
    {
       register_option("i", "ifc", "IFC", "Network interface name", [this](const char *arg){m_ifc = arg; return true;}, OptionFlags::RequiredArgument);
       register_option("f", "fanout", "ID", "Enable packet fanout",
@@ -62,6 +64,11 @@ public:
       register_option("p", "pkts", "SIZE", "Number of packets in block (should be power of two num)",
          [this](const char *arg){try {m_pkt_cnt = str2num<decltype(m_pkt_cnt)>(arg);} catch(std::invalid_argument &e) {return false;} return true;},
          OptionFlags::RequiredArgument);
+      register_option("F", "filter", "STR", "Filter string (tcpdump syntax), packets are filtered in kernel before they are copied to the ring",
+         [this](const char *arg){m_filter = arg; return true;}, OptionFlags::RequiredArgument);
+      register_option("s", "snaplen", "SIZE", "Snapshot length in bytes, packets are truncated in kernel. Derived from enabled process plugins by default",
+         [this](const char *arg){try {m_snaplen = str2num<decltype(m_snaplen)>(arg);} catch(std::invalid_argument &e) {return false;} return true;},
+         OptionFlags::RequiredArgument);
       register_option("l", "list", "", "Print list of available interfaces", [this](const char *arg){m_list = true; return true;}, OptionFlags::NoArgument);
    }
 };
@@ -76,10 +83,12 @@ public:
    OptionsParser *get_parser() const { return new RawOptParser(); }
    std::string get_name() const { return "raw"; }
    InputPlugin::Result get(PacketBlock &packets);
+   bool wait(uint32_t timeout);
 
 private:
    int m_sock;
    uint16_t m_fanout;
+   uint32_t m_snaplen;
    struct iovec *m_rd;
    struct pollfd m_pfd;
 
@@ -95,7 +104,8 @@ private:
    struct tpacket_block_desc *m_pbd;
    uint32_t m_pkts_left;
 
-   void open_ifc(const std::string &ifc);
+   void open_ifc(const std::string &ifc, const std::string &filter);
+   void attach_filter(int sock, const std::string &filter, uint32_t snaplen);
    bool get_block();
    void return_block();
    int read_packets(PacketBlock &packets);
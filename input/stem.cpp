@@ -93,7 +93,7 @@ bool StemPacketReader::convert(Stem::StatisticsPacket &stem_pkt, Packet &pkt)
       return false;
    }
 
-   pkt.ts = {hwdata.arrived_at.sec, hwdata.arrived_at.nsec / 1000};
+   pkt.ts = ts_from_sec_nsec(hwdata.arrived_at.sec, hwdata.arrived_at.nsec);
 
    memset(pkt.dst_mac, 0, sizeof(pkt.dst_mac));
    memset(pkt.src_mac, 0, sizeof(pkt.src_mac));
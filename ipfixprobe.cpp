@@ -34,6 +34,7 @@
 #include <sstream>
 #include <fstream>
 #include <memory>
+#include <algorithm>
 #include <thread>
 #include <future>
 #include <signal.h>
@@ -152,6 +153,46 @@ void process_plugin_argline(const std::string &args, std::string &plugin, std::s
    trim_str(params);
 }
 
+/**
+ * \brief Create storage plugin with its own copies of process plugins.
+ * \return Storage plugin or nullptr when the plugin requested exit.
+ */
+static StoragePlugin *init_storage_plugin(ipxp_conf_t &conf, const std::string &storage_name, const std::string &storage_params,
+   ipx_ring_t *output_queue, uint32_t output_held, OutputPlugin::Plugins &process_plugins,
+   std::vector<ProcessPlugin *> &storage_process_plugins)
+{
+   StoragePlugin *storage_plugin = nullptr;
+
+   try {
+      storage_plugin = dynamic_cast<StoragePlugin *>(conf.mgr.get(storage_name));
+      if (storage_plugin == nullptr) {
+         throw IPXPError("invalid storage plugin " + storage_name);
+      }
+      storage_plugin->set_queue(output_queue, output_held);
+      storage_plugin->init(storage_params.c_str());
+      conf.active.storage.push_back(storage_plugin);
+      conf.active.all.push_back(storage_plugin);
+   } catch (PluginError &e) {
+      delete storage_plugin;
+      throw IPXPError(storage_name + std::string(": ") + e.what());
+   } catch (PluginExit &e) {
+      delete storage_plugin;
+      return nullptr;
+   } catch (PluginManagerError &e) {
+      throw IPXPError(storage_name + std::string(": ") + e.what());
+   }
+
+   for (auto &it : process_plugins) {
+      ProcessPlugin *tmp = it.second->copy();
+      storage_plugin->add_plugin(tmp);
+      conf.active.process.push_back(tmp);
+      conf.active.all.push_back(tmp);
+      storage_process_plugins.push_back(tmp);
+   }
+
+   return storage_plugin;
+}
+
 bool process_plugin_args(ipxp_conf_t &conf, IpfixprobeOptParser &parser)
 {
    auto deleter = [&](OutputPlugin::Plugins *p) {
@@ -163,14 +204,33 @@ bool process_plugin_args(ipxp_conf_t &conf, IpfixprobeOptParser &parser)
    auto process_plugins = std::unique_ptr<OutputPlugin::Plugins, decltype(deleter)>(new OutputPlugin::Plugins(), deleter);
    std::string storage_name = "cache";
    std::string storage_params = "";
-   std::string output_name = "ipfix";
-   std::string output_params = "";
+   std::vector<std::pair<std::string, std::string>> output_args;
 
    if (parser.m_storage.size()) {
       process_plugin_argline(parser.m_storage[0], storage_name, storage_params);
    }
-   if (parser.m_output.size()) {
-      process_plugin_argline(parser.m_output[0], output_name, output_params);
+   for (auto &it : parser.m_output) {
+      std::string output_name;
+      std::string output_params;
+      process_plugin_argline(it, output_name, output_params);
+      output_args.push_back(std::make_pair(output_name, output_params));
+   }
+   if (output_args.empty()) {
+      output_args.push_back(std::make_pair("ipfix", ""));
+   }
+
+   // Sampling interval of flows is exported by sampling plugin
+   if (conf.sampling_interval) {
+      bool found = false;
+      for (auto &it : parser.m_process) {
+         std::string process_params;
+         std::string process_name;
+         process_plugin_argline(it, process_name, process_params);
+         found |= process_name == "sampling";
+      }
+      if (!found) {
+         parser.m_process.push_back("sampling");
+      }
    }
 
    // Process
@@ -207,49 +267,98 @@ bool process_plugin_args(ipxp_conf_t &conf, IpfixprobeOptParser &parser)
       }
    }
 
-   // Output
-   ipx_ring_t *output_queue = ipx_ring_init(conf.oqueue_size, 1);
-   if (output_queue == nullptr) {
-      throw IPXPError("unable to initialize ring buffer");
+   // Capture only headers and payload needed by process plugins
+   uint32_t capture_len = CAPTURE_HEADERS_LEN;
+   for (auto &it : *process_plugins) {
+      uint32_t payload_len = it.second->get_payload_len();
+      if (payload_len == PAYLOAD_LEN_ALL) {
+         capture_len = 0;
+         break;
+      }
+      capture_len = std::max(capture_len, CAPTURE_HEADERS_LEN + payload_len);
    }
-   OutputPlugin *output_plugin = nullptr;
-   try {
-      output_plugin = dynamic_cast<OutputPlugin *>(conf.mgr.get(output_name));
-      if (output_plugin == nullptr) {
+
+   // Output
+   uint32_t output_fps = conf.fps ? std::max<uint32_t>(conf.fps / conf.output_workers, 1) : 0;
+   for (uint32_t i = 0; i < conf.output_workers; i++) {
+      ipx_ring_t *output_queue = ipx_ring_init(conf.oqueue_size, 1);
+      if (output_queue == nullptr) {
+         throw IPXPError("unable to initialize ring buffer");
+      }
+      // Every output plugin of the worker exports all flows from the queue
+      std::vector<OutputPlugin *> output_plugins;
+      auto cleanup = [&]() {
          ipx_ring_destroy(output_queue);
-         throw IPXPError("invalid output plugin " + output_name);
+         for (auto plugin : output_plugins) {
+            delete plugin;
+         }
+      };
+      for (auto &it : output_args) {
+         const std::string &output_name = it.first;
+         OutputPlugin *output_plugin = nullptr;
+         try {
+            output_plugin = dynamic_cast<OutputPlugin *>(conf.mgr.get(output_name));
+            if (output_plugin == nullptr) {
+               cleanup();
+               throw IPXPError("invalid output plugin " + output_name);
+            }
+
+            output_plugin->set_worker(i);
+            output_plugin->init(it.second.c_str(), *process_plugins);
+            output_plugins.push_back(output_plugin);
+         } catch (PluginError &e) {
+            cleanup();
+            delete output_plugin;
+            throw IPXPError(output_name + std::string(": ") + e.what());
+         } catch (PluginExit &e) {
+            cleanup();
+            delete output_plugin;
+            return true;
+         } catch (PluginManagerError &e) {
+            cleanup();
+            throw IPXPError(output_name + std::string(": ") + e.what());
+         }
+      }
+      for (auto plugin : output_plugins) {
+         conf.active.output.push_back(plugin);
+         conf.active.all.push_back(plugin);
       }
 
-      output_plugin->init(output_params.c_str(), *process_plugins);
-      conf.active.output.push_back(output_plugin);
-      conf.active.all.push_back(output_plugin);
-   } catch (PluginError &e) {
-      ipx_ring_destroy(output_queue);
-      delete output_plugin;
-      throw IPXPError(output_name + std::string(": ") + e.what());
-   } catch (PluginExit &e) {
-      ipx_ring_destroy(output_queue);
-      delete output_plugin;
-      return true;
-   } catch (PluginManagerError &e) {
-      throw IPXPError(output_name + std::string(": ") + e.what());
-   }
-
-   {
-      std::promise<WorkerResult> *output_res = new std::promise<WorkerResult>();
-      auto output_stats = new std::atomic<OutputStats>();
-      conf.output_stats.push_back(output_stats);
-      OutputWorker tmp = {
-              output_plugin,
-              new std::thread(output_worker, output_plugin, output_queue, output_res, output_stats, conf.fps),
-              output_res,
-              output_stats,
-              output_queue
-      };
-      conf.outputs.push_back(tmp);
-      conf.output_fut.push_back(output_res->get_future());
+      // Single plugin reads the worker queue, several plugins get flows through the dispatcher
+      conf.outputs.push_back({{}, nullptr, output_queue});
+      OutputWorker &worker = conf.outputs.back();
+      bool dispatched = output_plugins.size() > 1;
+      for (auto plugin : output_plugins) {
+         conf.output_stats.push_back(new std::atomic<OutputStats>());
+         worker.outputs.push_back(new OutputQueue(plugin, dispatched ? nullptr : output_queue, conf.output_stats.back(),
+            dispatched));
+         if (dispatched) {
+            worker.outputs.back()->queue = ipx_ring_init(conf.oqueue_size, 0);
+            if (worker.outputs.back()->queue == nullptr) {
+               throw IPXPError("unable to initialize ring buffer");
+            }
+         }
+      }
+      for (auto output : worker.outputs) {
+         output->thread = new std::thread(output_worker, output, output_fps);
+      }
+      if (dispatched) {
+         worker.thread = new std::thread(output_dispatch_worker, output_queue, worker.outputs);
+      }
+   }
+
+   // Besides the queue, flows are held by the dispatcher and in queues of the plugins
+   uint32_t output_held = 0;
+   if (output_args.size() > 1) {
+      output_held = OUTPUT_BULK + output_args.size() * (conf.oqueue_size + OUTPUT_BULK);
    }
 
+   // Storage plugins are assigned to output workers round robin
+   size_t storage_idx = 0;
+   auto next_output_queue = [&]() {
+      return conf.outputs[storage_idx++ % conf.outputs.size()].queue;
+   };
+
    // Input
    size_t pipeline_idx = 0;
    for (auto &it : parser.m_input) {
@@ -264,6 +373,7 @@ bool process_plugin_args(ipxp_conf_t &conf, IpfixprobeOptParser &parser)
          if (input_plugin == nullptr) {
             throw IPXPError("invalid input plugin " + input_name);
          }
+         input_plugin->set_capture_len(capture_len);
          input_plugin->init(input_params.c_str());
          conf.active.input.push_back(input_plugin);
          conf.active.all.push_back(input_plugin);
@@ -277,52 +387,66 @@ bool process_plugin_args(ipxp_conf_t &conf, IpfixprobeOptParser &parser)
          throw IPXPError(input_name + std::string(": ") + e.what());
       }
 
-      try {
-         storage_plugin = dynamic_cast<StoragePlugin *>(conf.mgr.get(storage_name));
-         if (storage_plugin == nullptr) {
-            throw IPXPError("invalid storage plugin " + storage_name);
-         }
-         storage_plugin->set_queue(output_queue);
-         storage_plugin->init(storage_params.c_str());
-         conf.active.storage.push_back(storage_plugin);
-         conf.active.all.push_back(storage_plugin);
-      } catch (PluginError &e) {
-         delete storage_plugin;
-         throw IPXPError(storage_name + std::string(": ") + e.what());
-      } catch (PluginExit &e) {
-         delete storage_plugin;
-         return true;
-      } catch (PluginManagerError &e) {
-         throw IPXPError(storage_name + std::string(": ") + e.what());
-      }
-
-      std::vector<ProcessPlugin *> storage_process_plugins;
-      for (auto &it : *process_plugins) {
-         ProcessPlugin *tmp = it.second->copy();
-         storage_plugin->add_plugin(tmp);
-         conf.active.process.push_back(tmp);
-         conf.active.all.push_back(tmp);
-         storage_process_plugins.push_back(tmp);
-      }
-
       std::promise<WorkerResult> *input_res = new std::promise<WorkerResult>();
       conf.input_fut.push_back(input_res->get_future());
 
       auto input_stats = new std::atomic<InputStats>();
       conf.input_stats.push_back(input_stats);
 
+      PacketDedup *dedup = nullptr;
+      if (conf.dedup_window) {
+         dedup = new PacketDedup(conf.dedup_window, conf.dedup_fields);
+      }
+      FlowSampler *sampler = nullptr;
+      if (conf.sampling_interval) {
+         sampler = new FlowSampler(conf.sampling_interval, conf.sampling_max);
+      }
+
+      if (conf.storage_workers) {
+         WorkPipeline tmp = {{input_plugin, nullptr, input_res, input_stats, dedup, sampler}, {nullptr, {}}, {}};
+         size_t data_size = std::max<size_t>(conf.iqueue_size * conf.pkt_bufsize, DISPATCH_BLOCK_MIN_DATA);
+         for (uint32_t i = 0; i < conf.storage_workers; i++) {
+            StorageWorker worker = {nullptr, {}, nullptr, nullptr, nullptr};
+            worker.plugin = init_storage_plugin(conf, storage_name, storage_params, next_output_queue(), output_held, *process_plugins, worker.plugins);
+            if (worker.plugin == nullptr) {
+               return true;
+            }
+            worker.dispatch = new DispatchQueue(conf.dispatch_blocks, conf.iqueue_size, data_size);
+            worker.promise = new std::promise<WorkerResult>();
+            tmp.workers.push_back(worker);
+         }
+         for (auto &it : tmp.workers) {
+            it.thread = new std::thread(storage_worker, it.plugin, it.dispatch, conf.idle_policy, it.promise);
+         }
+         tmp.input.thread = new std::thread(input_dispatch_worker, input_plugin, tmp.workers, conf.iqueue_size,
+            conf.max_pkts, conf.idle_policy, dedup, sampler, input_res, input_stats);
+         conf.pipelines.push_back(tmp);
+         pipeline_idx++;
+         continue;
+      }
+
+      std::vector<ProcessPlugin *> storage_process_plugins;
+      storage_plugin = init_storage_plugin(conf, storage_name, storage_params, next_output_queue(), output_held, *process_plugins,
+         storage_process_plugins);
+      if (storage_plugin == nullptr) {
+         return true;
+      }
+
       WorkPipeline tmp = {
          {
             input_plugin,
             new std::thread(input_storage_worker, input_plugin, storage_plugin, conf.iqueue_size, 
-               conf.max_pkts, input_res, input_stats),
+               conf.max_pkts, conf.idle_policy, dedup, sampler, input_res, input_stats),
             input_res,
-            input_stats
+            input_stats,
+            dedup,
+            sampler
          },
          {
             storage_plugin,
             storage_process_plugins
-         }
+         },
+         {}
       };
       conf.pipelines.push_back(tmp);
       pipeline_idx++;
@@ -340,6 +464,9 @@ void finish(ipxp_conf_t &conf)
    for (auto &it : conf.pipelines) {
       it.input.thread->join();
       it.input.plugin->close();
+      for (auto &itw : it.workers) {
+         itw.thread->join();
+      }
    }
 
    // Terminate all storages
@@ -347,16 +474,37 @@ void finish(ipxp_conf_t &conf)
       for (auto &itp : it.storage.plugins) {
          itp->close();
       }
+      for (auto &itw : it.workers) {
+         for (auto &itp : itw.plugins) {
+            itp->close();
+         }
+      }
    }
 
    // Terminate all outputs
    terminate_export = 1;
    for (auto &it : conf.outputs) {
-      it.thread->join();
+      if (it.thread) {
+         it.thread->join();
+      }
+      for (auto output : it.outputs) {
+         output->thread->join();
+
+         // Closing may still send buffered data or drop it
+         output->plugin->close();
+         OutputStats stats = output->stats->load();
+         stats.dropped = output->plugin->m_flows_dropped + output->dropped;
+         output->stats->store(stats);
+      }
    }
 
    for (auto &it : conf.pipelines) {
-      it.storage.plugin->close();
+      if (it.storage.plugin) {
+         it.storage.plugin->close();
+      }
+      for (auto &itw : it.workers) {
+         itw.plugin->close();
+      }
    }
 
    std::cout << "Input stats:" << std::endl <<
@@ -365,7 +513,12 @@ void finish(ipxp_conf_t &conf)
       std::setw(13) << "parsed" <<
       std::setw(20) << "bytes" <<
       std::setw(13) << "dropped" <<
+      std::setw(13) << "duplicates" <<
+      std::setw(13) << "unsampled" <<
+      std::setw(9) << "sampling" <<
       std::setw(16) << "qtime" <<
+      std::setw(10) << "idle ms" <<
+      std::setw(9) << "idle cpu" <<
       std::setw(7) << "status" << std::endl;
 
    int idx = 0;
@@ -373,7 +526,11 @@ void finish(ipxp_conf_t &conf)
    uint64_t total_parsed = 0;
    uint64_t total_bytes = 0;
    uint64_t total_dropped = 0;
+   uint64_t total_duplicates = 0;
+   uint64_t total_unsampled = 0;
    uint64_t total_qtime = 0;
+   uint64_t total_idle = 0;
+   uint64_t total_idle_cpu = 0;
 
    for (auto &it : conf.input_fut) {
       WorkerResult res = it.get();
@@ -383,19 +540,29 @@ void finish(ipxp_conf_t &conf)
          status = res.msg;
       }
       InputStats stats = conf.input_stats[idx]->load();
+      double idle_cpu = stats.idle ? 100.0 * stats.idle_cpu / stats.idle : 0;
       std::cout <<
          std::setw(3) << idx++ << " " <<
          std::setw(12) << stats.packets << " " <<
          std::setw(12) << stats.parsed << " " <<
          std::setw(19) << stats.bytes << " " <<
          std::setw(12) << stats.dropped << " " <<
+         std::setw(12) << stats.duplicates << " " <<
+         std::setw(12) << stats.unsampled << " " <<
+         std::setw(8) << stats.sampling << " " <<
          std::setw(15) << stats.qtime << " " <<
+         std::setw(9) << stats.idle / 1000000 << " " <<
+         std::setw(7) << std::fixed << std::setprecision(1) << idle_cpu << "% " <<
          std::setw(6) << status << std::endl;
       total_packets += stats.packets;
       total_parsed += stats.parsed;
       total_bytes += stats.bytes;
       total_dropped += stats.dropped;
+      total_duplicates += stats.duplicates;
+      total_unsampled += stats.unsampled;
       total_qtime += stats.qtime;
+      total_idle += stats.idle;
+      total_idle_cpu += stats.idle_cpu;
    }
 
    std::cout <<
@@ -404,10 +571,51 @@ void finish(ipxp_conf_t &conf)
       std::setw(13) << total_parsed <<
       std::setw(20) << total_bytes <<
       std::setw(13) << total_dropped <<
-      std::setw(16) << total_qtime << std::endl;
+      std::setw(13) << total_duplicates <<
+      std::setw(13) << total_unsampled <<
+      std::setw(9) << "" <<
+      std::setw(16) << total_qtime <<
+      std::setw(10) << total_idle / 1000000 <<
+      std::setw(8) << std::fixed << std::setprecision(1) << (total_idle ? 100.0 * total_idle_cpu / total_idle : 0) << "%" << std::endl;
 
    std::cout << std::endl;
 
+   if (conf.storage_workers) {
+      std::cout << "Storage worker stats:" << std::endl <<
+         std::setw(3) << "#" <<
+         std::setw(7) << "worker" <<
+         std::setw(13) << "packets" <<
+         std::setw(8) << "share" <<
+         std::setw(13) << "stalls" <<
+         std::setw(13) << "stall ms" <<
+         std::setw(10) << "idle ms" <<
+         std::setw(9) << "idle cpu" << std::endl;
+
+      idx = 0;
+      for (auto &it : conf.pipelines) {
+         uint64_t packets = 0;
+         for (auto &itw : it.workers) {
+            packets += itw.dispatch->packets;
+         }
+         for (size_t i = 0; i < it.workers.size(); i++) {
+            DispatchQueue *dispatch = it.workers[i].dispatch;
+            double share = packets ? 100.0 * dispatch->packets / packets : 0;
+            double idle_cpu = dispatch->idle ? 100.0 * dispatch->idle_cpu / dispatch->idle : 0;
+            std::cout <<
+               std::setw(3) << idx << " " <<
+               std::setw(6) << i << " " <<
+               std::setw(12) << dispatch->packets << " " <<
+               std::setw(6) << std::fixed << std::setprecision(1) << share << "% " <<
+               std::setw(12) << dispatch->stalls << " " <<
+               std::setw(12) << dispatch->stall_time / 1000000 << " " <<
+               std::setw(9) << dispatch->idle / 1000000 << " " <<
+               std::setw(7) << std::fixed << std::setprecision(1) << idle_cpu << "%" << std::endl;
+         }
+         idx++;
+      }
+      std::cout << std::endl;
+   }
+
    std::cout << "Output stats:" << std::endl <<
       std::setw(3) << "#" <<
       std::setw(13) << "biflows" <<
@@ -417,21 +625,23 @@ void finish(ipxp_conf_t &conf)
       std::setw(7) << "status" << std::endl;
 
    idx = 0;
-   for (auto &it : conf.output_fut) {
-      WorkerResult res = it.get();
-      std::string status = "ok";
-      if (res.error) {
-         ok = false;
-         status = res.msg;
+   for (auto &it : conf.outputs) {
+      // One line for each output plugin of the worker
+      for (auto output : it.outputs) {
+         std::string status = "ok";
+         if (output->failed) {
+            ok = false;
+            status = output->error;
+         }
+         OutputStats stats = output->stats->load();
+         std::cout <<
+            std::setw(3) << idx++ << " " <<
+            std::setw(12) << stats.biflows << " " <<
+            std::setw(12) << stats.packets << " " <<
+            std::setw(19) << stats.bytes << " " <<
+            std::setw(12) << stats.dropped << " " <<
+            std::setw(6) << status << std::endl;
       }
-      OutputStats stats = conf.output_stats[idx]->load();
-      std::cout <<
-         std::setw(3) << idx++ << " " <<
-         std::setw(12) << stats.biflows << " " <<
-         std::setw(12) << stats.packets << " " <<
-         std::setw(19) << stats.bytes << " " <<
-         std::setw(12) << stats.dropped << " " <<
-         std::setw(6) << status << std::endl;
    }
 
    if (!ok) {
@@ -524,9 +734,9 @@ void main_loop(ipxp_conf_t &conf)
             break;
          }
       }
-      for (auto &it : conf.output_fut) {
-         std::future_status status = it.wait_for(std::chrono::seconds(0));
-         if (status == std::future_status::ready) {
+      for (auto &it : conf.outputs) {
+         // Export goes on while any plugin of each output worker works
+         if (std::all_of(it.outputs.begin(), it.outputs.end(), [](const OutputQueue *output) { return output->failed.load(); })) {
             stop = 1;
             break;
          }
@@ -573,8 +783,8 @@ int run(int argc, char *argv[])
       std::cout << PACKAGE_VERSION << std::endl;
       goto EXIT;
    }
-   if (parser.m_storage.size() > 1 || parser.m_output.size() > 1) {
-      error("only one storage and output plugin can be specified");
+   if (parser.m_storage.size() > 1) {
+      error("only one storage plugin can be specified");
       status = EXIT_FAILURE;
       goto EXIT;
    }
@@ -619,6 +829,14 @@ int run(int argc, char *argv[])
    conf.fps = parser.m_fps;
    conf.pkt_bufsize = parser.m_pkt_bufsize;
    conf.max_pkts = parser.m_max_pkts;
+   conf.storage_workers = parser.m_workers;
+   conf.dispatch_blocks = parser.m_blocks;
+   conf.idle_policy = parser.m_idle;
+   conf.dedup_window = parser.m_dedup;
+   conf.dedup_fields = parser.m_dedup_fields;
+   conf.sampling_interval = parser.m_sampling;
+   conf.sampling_max = parser.m_sampling_max;
+   conf.output_workers = parser.m_output_workers;
 
    try {
       if (process_plugin_args(conf, parser)) {
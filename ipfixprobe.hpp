@@ -83,6 +83,14 @@ public:
    uint32_t m_fps;
    uint32_t m_pkt_bufsize;
    uint32_t m_max_pkts;
+   uint32_t m_workers;
+   uint32_t m_blocks;
+   IdlePolicy m_idle;
+   uint32_t m_dedup;
+   uint32_t m_dedup_fields;
+   uint32_t m_sampling;
+   uint32_t m_sampling_max;
+   uint32_t m_output_workers;
    bool m_help;
    std::string m_help_str;
    bool m_version;
@@ -90,7 +98,8 @@ public:
    IpfixprobeOptParser() : OptionsParser("ipfixprobe", "flow exporter supporting various custom IPFIX elements"),
                            m_pid(""), m_daemon(false),
                            m_iqueue(DEFAULT_IQUEUE_SIZE), m_oqueue(DEFAULT_OQUEUE_SIZE), m_fps(DEFAULT_FPS),
-                           m_pkt_bufsize(1600), m_max_pkts(0), m_help(false), m_help_str(""), m_version(false)
+                           m_pkt_bufsize(1600), m_max_pkts(0), m_workers(0), m_blocks(DISPATCH_BLOCKS), m_idle(IdlePolicy::SPIN),
+                           m_dedup(0), m_dedup_fields(DEDUP_ALL), m_sampling(0), m_sampling_max(0), m_output_workers(1), m_help(false), m_help_str(""), m_version(false)
    {
       m_delim = ' ';
 
@@ -104,7 +113,7 @@ public:
                           m_storage.push_back(arg);
                           return true;
                       }, OptionFlags::RequiredArgument);
-      register_option("-o", "--output", "ARGS", "Activate output plugin (-h output for help)",
+      register_option("-o", "--output", "ARGS", "Activate output plugin, multiple outputs export the same flows (-h output for help)",
                       [this](const char *arg) {
                           m_output.push_back(arg);
                           return true;
@@ -144,6 +153,57 @@ public:
                                   std::invalid_argument &e) { return false; }
                           return true;
                       }, OptionFlags::RequiredArgument);
+      register_option("-w", "--workers", "NUM", "Distribute packets of each input among NUM storage workers by symmetric flow hash. Use 1 to run capture and cache of each input in separate threads",
+                      [this](const char *arg) {
+                          try { m_workers = str2num<decltype(m_workers)>(arg); } catch (
+                                  std::invalid_argument &e) { return false; }
+                          return true;
+                      }, OptionFlags::RequiredArgument);
+      register_option("-b", "--blocks", "NUM", "Number of packet blocks buffered for each storage worker, see -w",
+                      [this](const char *arg) {
+                          try { m_blocks = str2num<decltype(m_blocks)>(arg); } catch (
+                                  std::invalid_argument &e) { return false; }
+                          return m_blocks > 0;
+                      }, OptionFlags::RequiredArgument);
+      register_option("-I", "--idle", "POLICY", "What input and storage workers do while there are no packets: busy (poll input without pause), "
+                      "spin (poll, then yield CPU and sleep, default) or block (wait for packets, supported by raw and pcap live capture, "
+                      "storage workers sleep). Input waiting for a storage worker backs off the same way",
+                      [this](const char *arg) {
+                          std::string policy(arg);
+                          if (policy == "busy") {
+                             m_idle = IdlePolicy::BUSY;
+                          } else if (policy == "spin") {
+                             m_idle = IdlePolicy::SPIN;
+                          } else if (policy == "block") {
+                             m_idle = IdlePolicy::BLOCK;
+                          } else {
+                             return false;
+                          }
+                          return true;
+                      }, OptionFlags::RequiredArgument);
+      register_option("-D", "--dedup", "TIME", "Drop packets whose copy was seen on the same input within TIME microseconds, e.g. both directions of a SPAN port",
+                      [this](const char *arg) {
+                          try { m_dedup = str2num<decltype(m_dedup)>(arg); } catch (
+                                  std::invalid_argument &e) { return false; }
+                          return m_dedup > 0;
+                      }, OptionFlags::RequiredArgument);
+      register_option("-K", "--dedup-key", "FIELDS", "Comma separated packet fields compared by -D: ipid, addr, ports, seq, csum, len or all (default)",
+                      [this](const char *arg) {
+                          return PacketDedup::parse_fields(arg, m_dedup_fields);
+                      }, OptionFlags::RequiredArgument);
+      register_option("-S", "--sampling", "N[:MAX]", "Keep only packets of one in N flows selected by symmetric hash of addresses, ports and protocol, the interval is exported by sampling plugin. "
+                      "With MAX, the interval is doubled up to MAX when input drops packets or storage workers stall and halved again when load drops",
+                      [this](const char *arg) {
+                          return FlowSampler::parse_interval(arg, m_sampling, m_sampling_max);
+                      }, OptionFlags::RequiredArgument);
+      register_option("-O", "--output-workers", "NUM", "Number of output workers, each of them runs its own instances of output plugins. "
+                      "Storage plugins are assigned to output workers round robin, the -f limit is divided among the workers. "
+                      "Output files of worker N get -wN suffix before extension",
+                      [this](const char *arg) {
+                          try { m_output_workers = str2num<decltype(m_output_workers)>(arg); } catch (
+                                  std::invalid_argument &e) { return false; }
+                          return m_output_workers > 0;
+                      }, OptionFlags::RequiredArgument);
       register_option("-P", "--pid", "FILE", "Create pid file", [this](const char *arg) {
           m_pid = arg;
           return m_pid != "";
@@ -170,6 +230,14 @@ struct ipxp_conf_t {
    uint32_t worker_cnt;
    uint32_t fps;
    uint32_t max_pkts;
+   uint32_t storage_workers;
+   uint32_t dispatch_blocks;
+   IdlePolicy idle_policy;
+   uint32_t dedup_window;
+   uint32_t dedup_fields;
+   uint32_t sampling_interval;
+   uint32_t sampling_max;
+   uint32_t output_workers;
 
    PluginManager mgr;
    struct Plugins {
@@ -187,7 +255,6 @@ struct ipxp_conf_t {
    std::vector<std::atomic<OutputStats> *> output_stats;
 
    std::vector<std::shared_future<WorkerResult>> input_fut;
-   std::vector<std::future<WorkerResult>> output_fut;  
 
    size_t pkt_bufsize;
    size_t blocks_cnt;
@@ -200,7 +267,8 @@ struct ipxp_conf_t {
 
    ipxp_conf_t() : iqueue_size(DEFAULT_IQUEUE_SIZE),
                    oqueue_size(DEFAULT_OQUEUE_SIZE),
-                   worker_cnt(0), fps(0), max_pkts(0),
+                   worker_cnt(0), fps(0), max_pkts(0), storage_workers(0), dispatch_blocks(DISPATCH_BLOCKS), idle_policy(IdlePolicy::SPIN),
+                   dedup_window(0), dedup_fields(DEDUP_ALL), sampling_interval(0), sampling_max(0), output_workers(1),
                    pkt_bufsize(1600), blocks_cnt(0), pkts_cnt(0), pkt_data_cnt(0), blocks(nullptr), pkts(nullptr), pkt_data(nullptr)
    {
    }
@@ -215,6 +283,24 @@ struct ipxp_conf_t {
          delete it.input.plugin;
          delete it.input.thread;
          delete it.input.promise;
+         delete it.input.dedup;
+         delete it.input.sampler;
+      }
+
+      for (auto &it : pipelines) {
+         for (auto &itw : it.workers) {
+            itw.dispatch->finished = true;
+            if (itw.thread->joinable()) {
+               itw.thread->join();
+            }
+            delete itw.thread;
+            delete itw.promise;
+            delete itw.plugin;
+            for (auto &itp : itw.plugins) {
+               delete itp;
+            }
+            delete itw.dispatch;
+         }
       }
 
       for (auto &it : pipelines) {
@@ -229,12 +315,21 @@ struct ipxp_conf_t {
 
       terminate_export = 1;
       for (auto &it : outputs) {
-         if (it.thread->joinable()) {
+         if (it.thread && it.thread->joinable()) {
             it.thread->join();
          }
          delete it.thread;
-         delete it.promise;
-         delete it.plugin;
+         for (auto &itp : it.outputs) {
+            if (itp->thread && itp->thread->joinable()) {
+               itp->thread->join();
+            }
+            delete itp->thread;
+            delete itp->plugin;
+            if (itp->queue && itp->queue != it.queue) {
+               ipx_ring_destroy(itp->queue);
+            }
+            delete itp;
+         }
          ipx_ring_destroy(it.queue);
       }
 
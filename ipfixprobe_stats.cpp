@@ -151,7 +151,12 @@ int main(int argc, char *argv[])
          std::setw(10) << "parsed" <<
          std::setw(16) << "bytes" <<
          std::setw(10) << "dropped" <<
-         std::setw(10) << "qtime" << std::endl;
+         std::setw(11) << "duplicates" <<
+         std::setw(10) << "unsampled" <<
+         std::setw(9) << "sampling" <<
+         std::setw(10) << "qtime" <<
+         std::setw(10) << "idle ms" <<
+         std::setw(9) << "idle cpu" << std::endl;
 
       uint8_t *data = buffer + sizeof(msg_header_t);
       size_t idx = 0;
@@ -164,7 +169,13 @@ int main(int argc, char *argv[])
             std::setw(9) << stats->parsed << " " <<
             std::setw(15) << stats->bytes << " " <<
             std::setw(9) << stats->dropped << " " <<
-            std::setw(9) << stats->qtime << " " << std::endl;
+            std::setw(10) << stats->duplicates << " " <<
+            std::setw(9) << stats->unsampled << " " <<
+            std::setw(8) << stats->sampling << " " <<
+            std::setw(9) << stats->qtime << " " <<
+            std::setw(9) << stats->idle / 1000000 << " " <<
+            std::setw(7) << std::fixed << std::setprecision(1) <<
+               (stats->idle ? 100.0 * stats->idle_cpu / stats->idle : 0) << "% " << std::endl;
       }
 
       std::cout << "Output stats:" << std::endl <<
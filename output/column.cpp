@@ -0,0 +1,372 @@
+/**
+ * \file column.cpp
+ * \brief Output plugin writing flows in columnar batches
+ * \date 2026
+ */
+/*
+ * Copyright (C) 2026 CESNET
+ *
+ * LICENSE TERMS
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name of the Company nor the names of its contributors
+ *    may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ *
+ *
+ */
+
+#include <config.h>
+
+#include <cstring>
+#include <cerrno>
+#include <algorithm>
+#include <climits>
+#include <unistd.h>
+#include <fcntl.h>
+
+#include "column.hpp"
+
+namespace ipxp {
+
+__attribute__((constructor)) static void register_this_plugin()
+{
+   static PluginRecord rec = PluginRecord("column", [](){return new ColumnExporter();});
+   register_plugin(&rec);
+}
+
+/**
+ * \brief Columns of basic flow fields in order they are stored in batch.
+ */
+enum BasicColumn {
+   COL_TIME_FIRST,
+   COL_TIME_LAST,
+   COL_IP_VERSION,
+   COL_PROTO,
+   COL_SRC_IP,
+   COL_DST_IP,
+   COL_SRC_PORT,
+   COL_DST_PORT,
+   COL_PACKETS,
+   COL_PACKETS_REV,
+   COL_BYTES,
+   COL_BYTES_REV,
+   COL_TCP_FLAGS,
+   COL_TCP_FLAGS_REV,
+   COL_SRC_MAC,
+   COL_DST_MAC,
+   COL_END_REASON
+};
+
+ColumnExporter::ColumnExporter() : m_fd(-1), m_rows(COLUMN_BATCH_ROWS), m_cnt(0), m_batch_time(0), m_basic_cnt(0)
+{
+}
+
+ColumnExporter::~ColumnExporter()
+{
+   close();
+}
+
+void ColumnExporter::init(const char *params)
+{
+   ColumnOptParser parser;
+   try {
+      parser.parse(params);
+   } catch (ParserError &e) {
+      throw PluginError(e.what());
+   }
+   if (parser.m_file.empty()) {
+      throw PluginError("output file must be specified");
+   }
+   m_rows = parser.m_rows;
+
+   std::string path = worker_path(parser.m_file);
+   m_fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+   if (m_fd == -1) {
+      throw PluginError("failed to open output file " + path + ": " + strerror(errno));
+   }
+
+   add_column("time_first", ColumnType::U64, 8);
+   add_column("time_last", ColumnType::U64, 8);
+   add_column("ip_version", ColumnType::U8, 1);
+   add_column("proto", ColumnType::U8, 1);
+   add_column("src_ip", ColumnType::FIXED, 16);
+   add_column("dst_ip", ColumnType::FIXED, 16);
+   add_column("src_port", ColumnType::U16, 2);
+   add_column("dst_port", ColumnType::U16, 2);
+   add_column("packets", ColumnType::U32, 4);
+   add_column("packets_rev", ColumnType::U32, 4);
+   add_column("bytes", ColumnType::U64, 8);
+   add_column("bytes_rev", ColumnType::U64, 8);
+   add_column("tcp_flags", ColumnType::U8, 1);
+   add_column("tcp_flags_rev", ColumnType::U8, 1);
+   add_column("src_mac", ColumnType::FIXED, 6);
+   add_column("dst_mac", ColumnType::FIXED, 6);
+   add_column("end_reason", ColumnType::U8, 1);
+   m_basic_cnt = m_cols.size();
+
+   // File starts with magic and byte order mark of the values
+   uint32_t bom = 0x01020304;
+   if (!write_data("IPXPCOL2", 8) || !write_data(&bom, sizeof(bom))) {
+      throw PluginError(std::string("failed to write output file: ") + strerror(errno));
+   }
+}
+
+void ColumnExporter::init(const char *params, Plugins &plugins)
+{
+   init(params);
+
+   m_ext_cols.assign(get_extension_cnt(), -1);
+   for (auto &it : plugins) {
+      RecordExt *ext = it.second->get_ext();
+      if (ext == nullptr) {
+         continue;
+      }
+      if (ext->m_ext_id >= 0 && static_cast<size_t>(ext->m_ext_id) < m_ext_cols.size()) {
+         m_ext_cols[ext->m_ext_id] = m_cols.size();
+         add_column(it.first, ColumnType::DICT, 0);
+      }
+      delete ext;
+   }
+}
+
+void ColumnExporter::close()
+{
+   if (m_fd != -1) {
+      write_batch();
+      ::close(m_fd);
+      m_fd = -1;
+   }
+}
+
+int ColumnExporter::export_flow(const Flow &flow)
+{
+   m_flows_seen++;
+   if (!m_cnt) {
+      m_batch_time = time(nullptr);
+   }
+
+   put<uint64_t>(COL_TIME_FIRST, flow.time_first);
+   put<uint64_t>(COL_TIME_LAST, flow.time_last);
+   put<uint8_t>(COL_IP_VERSION, flow.ip_version);
+   put<uint8_t>(COL_PROTO, flow.ip_proto);
+   if (flow.ip_version == IP::v4) {
+      // IPv4 addresses are stored as IPv4-mapped IPv6 addresses
+      uint8_t addr[16] = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0xff, 0xff};
+      memcpy(addr + 12, &flow.src_ip.v4, 4);
+      put_bytes(COL_SRC_IP, addr);
+      memcpy(addr + 12, &flow.dst_ip.v4, 4);
+      put_bytes(COL_DST_IP, addr);
+   } else {
+      put_bytes(COL_SRC_IP, flow.src_ip.v6);
+      put_bytes(COL_DST_IP, flow.dst_ip.v6);
+   }
+   put<uint16_t>(COL_SRC_PORT, flow.src_port);
+   put<uint16_t>(COL_DST_PORT, flow.dst_port);
+   put<uint32_t>(COL_PACKETS, flow.src_packets);
+   put<uint32_t>(COL_PACKETS_REV, flow.dst_packets);
+   put<uint64_t>(COL_BYTES, flow.src_bytes);
+   put<uint64_t>(COL_BYTES_REV, flow.dst_bytes);
+   put<uint8_t>(COL_TCP_FLAGS, flow.src_tcp_flags);
+   put<uint8_t>(COL_TCP_FLAGS_REV, flow.dst_tcp_flags);
+   put_bytes(COL_SRC_MAC, flow.src_mac);
+   put_bytes(COL_DST_MAC, flow.dst_mac);
+   put<uint8_t>(COL_END_REASON, flow.end_reason);
+
+   for (size_t i = m_basic_cnt; i < m_cols.size(); i++) {
+      m_cols[i].idx[m_cnt] = COLUMN_NULL;
+   }
+   for (RecordExt *ext = flow.m_exts; ext != nullptr; ext = ext->m_next) {
+      if (ext->m_ext_id < 0 || static_cast<size_t>(ext->m_ext_id) >= m_ext_cols.size() || m_ext_cols[ext->m_ext_id] == -1) {
+         continue;
+      }
+      m_text.clear();
+      ext->append_text(m_text);
+      put_string(m_cols[m_ext_cols[ext->m_ext_id]], m_text);
+   }
+
+   m_cnt++;
+   if (m_cnt == m_rows) {
+      write_batch();
+   }
+   return 0;
+}
+
+void ColumnExporter::flush()
+{
+   if (m_cnt && time(nullptr) - m_batch_time >= COLUMN_FLUSH_TIMEOUT) {
+      write_batch();
+   }
+}
+
+void ColumnExporter::add_column(const std::string &name, ColumnType type, uint16_t width)
+{
+   m_cols.emplace_back(name, type, width);
+   Column &col = m_cols.back();
+   if (type == ColumnType::DICT) {
+      col.offsets.push_back(0);
+      col.idx.resize(m_rows);
+   } else {
+      col.data.resize(static_cast<size_t>(m_rows) * width);
+   }
+}
+
+template<typename T>
+void ColumnExporter::put(size_t col, T value)
+{
+   memcpy(m_cols[col].data.data() + m_cnt * sizeof(T), &value, sizeof(T));
+}
+
+void ColumnExporter::put_bytes(size_t col, const void *value)
+{
+   Column &c = m_cols[col];
+   memcpy(c.data.data() + static_cast<size_t>(m_cnt) * c.width, value, c.width);
+}
+
+void ColumnExporter::put_string(Column &col, const std::string &value)
+{
+   auto it = col.dict.find(value);
+   if (it == col.dict.end()) {
+      uint32_t idx = col.offsets.size() - 1;
+      it = col.dict.emplace(value, idx).first;
+      col.chars += value;
+      col.offsets.push_back(col.chars.size());
+   }
+   col.idx[m_cnt] = it->second;
+}
+
+/**
+ * \brief Write current batch to file
+ *
+ * Batch consists of a header with magic "BTCH", number of rows and number of
+ * columns, followed by columns. Each column has a header with name length,
+ * name, type, value width and data size, followed by data. Data of fixed width
+ * column are values of all rows. Data of dictionary column are number of
+ * distinct values, their end offsets preceded by zero, the values and finally
+ * dictionary index of each row. The whole batch is written by one writev().
+ */
+void ColumnExporter::write_batch()
+{
+   if (!m_cnt) {
+      return;
+   }
+
+   // All headers are built first, so that the pieces do not move while referenced
+   uint16_t cols = m_cols.size();
+   std::vector<size_t> hdr_end;
+   m_hdr.clear();
+   m_hdr.append("BTCH", 4);
+   m_hdr.append(reinterpret_cast<const char *>(&m_cnt), sizeof(m_cnt));
+   m_hdr.append(reinterpret_cast<const char *>(&cols), sizeof(cols));
+   hdr_end.push_back(m_hdr.size());
+   for (auto &col : m_cols) {
+      uint8_t name_len = std::min<size_t>(col.name.size(), UINT8_MAX);
+      uint8_t type = static_cast<uint8_t>(col.type);
+      uint64_t size;
+      uint32_t dict_cnt = col.offsets.size() - 1;
+      if (col.type == ColumnType::DICT) {
+         size = sizeof(dict_cnt) + col.offsets.size() * sizeof(uint32_t) + col.chars.size() + m_cnt * sizeof(uint32_t);
+      } else {
+         size = static_cast<uint64_t>(m_cnt) * col.width;
+      }
+
+      m_hdr.append(reinterpret_cast<const char *>(&name_len), sizeof(name_len));
+      m_hdr.append(col.name, 0, name_len);
+      m_hdr.append(reinterpret_cast<const char *>(&type), sizeof(type));
+      m_hdr.append(reinterpret_cast<const char *>(&col.width), sizeof(col.width));
+      m_hdr.append(reinterpret_cast<const char *>(&size), sizeof(size));
+      if (col.type == ColumnType::DICT) {
+         m_hdr.append(reinterpret_cast<const char *>(&dict_cnt), sizeof(dict_cnt));
+      }
+      hdr_end.push_back(m_hdr.size());
+   }
+
+   auto add = [this](const void *data, size_t size) {
+      m_iov.push_back({const_cast<void *>(data), size});
+   };
+   m_iov.clear();
+   for (size_t i = 0; i < hdr_end.size(); i++) {
+      size_t begin = i ? hdr_end[i - 1] : 0;
+      add(m_hdr.data() + begin, hdr_end[i] - begin);
+      if (!i) {
+         continue;
+      }
+      Column &col = m_cols[i - 1];
+      if (col.type == ColumnType::DICT) {
+         add(col.offsets.data(), col.offsets.size() * sizeof(uint32_t));
+         add(col.chars.data(), col.chars.size());
+         add(col.idx.data(), m_cnt * sizeof(uint32_t));
+      } else {
+         add(col.data.data(), static_cast<size_t>(m_cnt) * col.width);
+      }
+   }
+
+   if (!write_vector(m_iov)) {
+      m_flows_dropped += m_cnt;
+   }
+   for (auto &col : m_cols) {
+      if (col.type == ColumnType::DICT) {
+         col.dict.clear();
+         col.offsets.assign(1, 0);
+         col.chars.clear();
+      }
+   }
+   m_cnt = 0;
+}
+
+bool ColumnExporter::write_data(const void *data, size_t size)
+{
+   const uint8_t *ptr = static_cast<const uint8_t *>(data);
+
+   while (size) {
+      ssize_t ret = write(m_fd, ptr, size);
+      if (ret == -1) {
+         if (errno == EINTR) {
+            continue;
+         }
+         return false;
+      }
+      ptr += ret;
+      size -= ret;
+   }
+   return true;
+}
+
+/**
+ * \brief Write all pieces, pieces are modified by partial writes
+ */
+bool ColumnExporter::write_vector(std::vector<struct iovec> &iov)
+{
+   size_t idx = 0;
+
+   while (idx < iov.size()) {
+      ssize_t ret = writev(m_fd, &iov[idx], std::min<size_t>(iov.size() - idx, IOV_MAX));
+      if (ret == -1) {
+         if (errno == EINTR) {
+            continue;
+         }
+         return false;
+      }
+      size_t done = ret;
+      while (idx < iov.size() && done >= iov[idx].iov_len) {
+         done -= iov[idx].iov_len;
+         idx++;
+      }
+      if (done) {
+         iov[idx].iov_base = static_cast<uint8_t *>(iov[idx].iov_base) + done;
+         iov[idx].iov_len -= done;
+      }
+   }
+   return true;
+}
+
+}
@@ -0,0 +1,130 @@
+/**
+ * \file column.hpp
+ * \brief Output plugin writing flows in columnar batches
+ * \date 2026
+ */
+/*
+ * Copyright (C) 2026 CESNET
+ *
+ * LICENSE TERMS
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name of the Company nor the names of its contributors
+ *    may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ *
+ *
+ */
+
+#ifndef IPXP_OUTPUT_COLUMN_HPP
+#define IPXP_OUTPUT_COLUMN_HPP
+
+#include <config.h>
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <ctime>
+#include <sys/uio.h>
+
+#include <ipfixprobe/output.hpp>
+#include <ipfixprobe/process.hpp>
+#include <ipfixprobe/flowifc.hpp>
+#include <ipfixprobe/utils.hpp>
+#include <ipfixprobe/options.hpp>
+
+namespace ipxp {
+
+#define COLUMN_BATCH_ROWS 65536 /**< Default number of flows in one batch */
+#define COLUMN_FLUSH_TIMEOUT 5 /**< Time in seconds after which an idle exporter writes incomplete batch */
+#define COLUMN_NULL 0xFFFFFFFF /**< Dictionary index of missing value */
+
+/**
+ * \brief Column types stored in batch.
+ */
+enum class ColumnType : uint8_t {
+   U8 = 1,
+   U16 = 2,
+   U32 = 3,
+   U64 = 4,
+   FIXED = 5, /**< Fixed width byte string, e.g. an address */
+   DICT = 6 /**< Dictionary encoded variable length string */
+};
+
+class ColumnOptParser : public OptionsParser
+{
+public:
+   std::string m_file;
+   uint32_t m_rows;
+
+   ColumnOptParser() : OptionsParser("column", "Output plugin writing flows in columnar batches"),
+      m_file(""), m_rows(COLUMN_BATCH_ROWS)
+   {
+      register_option("f", "file", "PATH", "Output file, output worker N other than the first one inserts -wN before extension of PATH",
+         [this](const char *arg){m_file = arg; return true;}, OptionFlags::RequiredArgument);
+      register_option("r", "rows", "NUM", "Number of flows in one batch",
+         [this](const char *arg){try {m_rows = str2num<decltype(m_rows)>(arg);} catch(std::invalid_argument &e) {return false;}
+         return m_rows > 0;}, OptionFlags::RequiredArgument);
+   }
+};
+
+class ColumnExporter : public OutputPlugin
+{
+public:
+   ColumnExporter();
+   ~ColumnExporter();
+   void init(const char *params);
+   void init(const char *params, Plugins &plugins);
+   void close();
+   OptionsParser *get_parser() const { return new ColumnOptParser(); }
+   std::string get_name() const { return "column"; }
+   int export_flow(const Flow &flow);
+   void flush();
+
+private:
+   struct Column {
+      std::string name;
+      ColumnType type;
+      uint16_t width; /**< Size of one value of fixed width column */
+      std::vector<uint8_t> data; /**< Values of fixed width column */
+
+      /* Dictionary encoded column */
+      std::unordered_map<std::string, uint32_t> dict; /**< Index of each distinct value */
+      std::vector<uint32_t> offsets; /**< Offsets of values in chars, one more than values */
+      std::string chars; /**< Distinct values one after another */
+      std::vector<uint32_t> idx; /**< Dictionary index of each row */
+
+      Column(const std::string &name, ColumnType type, uint16_t width) : name(name), type(type), width(width) {}
+   };
+
+   int m_fd;
+   uint32_t m_rows; /**< Maximal number of rows in batch */
+   uint32_t m_cnt; /**< Number of rows in current batch */
+   time_t m_batch_time; /**< Time the current batch was started at */
+   std::vector<Column> m_cols; /**< Columns of basic flow fields followed by extension columns */
+   size_t m_basic_cnt; /**< Number of basic flow columns */
+   std::vector<int> m_ext_cols; /**< Column index of each extension ID, -1 when not exported */
+   std::string m_text; /**< Scratch buffer for extension text */
+   std::string m_hdr; /**< Batch and column headers of the batch being written */
+   std::vector<struct iovec> m_iov; /**< Pieces of the batch being written */
+
+   void add_column(const std::string &name, ColumnType type, uint16_t width);
+   template<typename T> void put(size_t col, T value);
+   void put_bytes(size_t col, const void *value);
+   void put_string(Column &col, const std::string &value);
+   void write_batch();
+   bool write_data(const void *data, size_t size);
+   bool write_vector(std::vector<struct iovec> &iov);
+};
+
+}
+#endif /* IPXP_OUTPUT_COLUMN_HPP */
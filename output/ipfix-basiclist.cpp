@@ -63,17 +63,6 @@ int32_t IpfixBasicList::FillBuffer(uint8_t *buffer, int32_t *values, uint16_t le
    return this->FillBuffer(buffer, (uint32_t *) values, len, fieldID);
 }
 
-int32_t IpfixBasicList::FillBuffer(uint8_t *buffer, struct timeval *values, uint16_t len, uint16_t fieldID)
-{
-   int32_t written = this->FillBufferHdr(buffer, len, sizeof(uint64_t), fieldID);
-
-   for (int i = 0; i < len; i++) {
-      (*reinterpret_cast<uint64_t *>(buffer + written)) = swap_uint64(Tv2Ts(values[i]));
-      written += sizeof(uint64_t);
-   }
-   return written;
-}
-
 int32_t IpfixBasicList::FillBuffer(uint8_t *buffer, uint8_t *values, uint16_t len, uint16_t fieldID)
 {
    int32_t written = this->FillBufferHdr(buffer, len, sizeof(uint8_t), fieldID);
@@ -88,6 +77,20 @@ int32_t IpfixBasicList::FillBuffer(uint8_t *buffer, int8_t *values, uint16_t len
    return this->FillBuffer(buffer, (uint8_t *) values, len, fieldID);
 }
 
+/**
+ * \brief Fill list of timestamps, they are exported in milliseconds.
+ */
+int32_t IpfixBasicList::FillBufferTs(uint8_t *buffer, timestamp_t *values, uint16_t len, uint16_t fieldID)
+{
+   int32_t written = this->FillBufferHdr(buffer, len, sizeof(uint64_t), fieldID);
+
+   for (int i = 0; i < len; i++) {
+      (*reinterpret_cast<uint64_t *>(buffer + written)) = swap_uint64(ts_to_msec(values[i]));
+      written += sizeof(uint64_t);
+   }
+   return written;
+}
+
 int32_t IpfixBasicList::FillBufferHdr(uint8_t *buffer, uint16_t length, uint16_t elementLength, uint16_t fieldID)
 {
    uint32_t bufferPtr = 0;
@@ -119,9 +122,4 @@ int32_t IpfixBasicList::HeaderSize()
    return IpfixBasicListRecordHdrSize;
 }
 
-uint64_t IpfixBasicList::Tv2Ts(timeval input)
-{
-   return static_cast<uint64_t>(input.tv_sec) * 1000 + (input.tv_usec / 1000);
-}
-
 }
@@ -0,0 +1,204 @@
+/**
+ * \file ipfix-file.cpp
+ * \brief IPFIX file writer with rotation
+ * \date 2026
+ */
+/*
+ * Copyright (C) 2026 CESNET
+ *
+ * LICENSE TERMS
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name of the Company nor the names of its contributors
+ *    may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ *
+ *
+ */
+
+#include <cstring>
+#include <cerrno>
+#include <cstdlib>
+#include <climits>
+#include <unistd.h>
+#include <fcntl.h>
+
+#include <ipfixprobe/plugin.hpp>
+
+#include "ipfix-file.hpp"
+
+namespace ipxp {
+
+IpfixFile::IpfixFile(const std::string &pattern, uint32_t rotate_time, uint64_t rotate_size, bool direct) :
+   m_pattern(pattern), m_rotate_time(rotate_time), m_rotate_size(rotate_size), m_direct(direct),
+   m_fd(-1), m_name(""), m_end(0), m_retry(0), m_size(0), m_lost(0), m_buf(nullptr), m_used(0), m_buf_flows(0)
+{
+   void *buf;
+   if (posix_memalign(&buf, FILE_ALIGN, FILE_BUFFER_SIZE)) {
+      throw PluginError("not enough memory");
+   }
+   m_buf = static_cast<uint8_t *>(buf);
+}
+
+IpfixFile::~IpfixFile()
+{
+   close();
+   free(m_buf);
+}
+
+/**
+ * \brief Open new file
+ *
+ * \param now Current time
+ * \return True on success
+ */
+bool IpfixFile::open(time_t now)
+{
+   time_t start = now;
+   struct tm tm;
+   char buf[PATH_MAX];
+
+   if (m_rotate_time) {
+      start = now - now % m_rotate_time;
+      m_end = start + m_rotate_time;
+   }
+   localtime_r(&start, &tm);
+   if (strftime(buf, sizeof(buf), m_pattern.c_str(), &tm) == 0) {
+      errno = ENAMETOOLONG;
+      return false;
+   }
+
+   std::string base = buf;
+   uint32_t idx = 0;
+   while (true) {
+      m_name = idx ? base + "." + std::to_string(idx) : base;
+      m_fd = ::open(m_name.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC | (m_direct ? O_DIRECT : 0), 0644);
+      if (m_fd == -1 && m_direct && errno == EINVAL) {
+         /* File system does not support direct I/O */
+         m_direct = false;
+         continue;
+      }
+      if (m_fd != -1 || errno != EEXIST) {
+         break;
+      }
+      idx++;
+   }
+   if (m_fd == -1) {
+      m_retry = now + FILE_RETRY_INTERVAL;
+      return false;
+   }
+   m_size = 0;
+   return true;
+}
+
+/**
+ * \brief Write buffered data and close the current file
+ */
+void IpfixFile::close()
+{
+   if (m_fd != -1) {
+      write_buffer(true);
+      ::close(m_fd);
+      m_fd = -1;
+      m_size = 0;
+   }
+}
+
+/**
+ * \brief Append message to the current file
+ *
+ * \param data Message data
+ * \param length Message length
+ * \param flows Number of flows in message
+ * \return True on success, false when no file is open
+ */
+bool IpfixFile::write(const uint8_t *data, uint16_t length, uint16_t flows)
+{
+   if (m_fd == -1) {
+      return false;
+   }
+   if (m_used + length > FILE_BUFFER_SIZE) {
+      /* Buffer is empty or holds only unaligned tail even when the write fails */
+      write_buffer(false);
+   }
+
+   memcpy(m_buf + m_used, data, length);
+   m_used += length;
+   m_buf_flows += flows;
+   m_size += length;
+   return true;
+}
+
+/**
+ * \brief Check whether a message of given length belongs to a new file
+ *
+ * New file is also needed when the last one could not be opened.
+ */
+bool IpfixFile::need_rotation(time_t now, uint16_t length) const
+{
+   return (m_fd == -1 && now >= m_retry) || (m_rotate_time && now >= m_end) ||
+      (m_rotate_size && m_size && m_size + length > m_rotate_size);
+}
+
+/**
+ * \brief Get number of flows lost due to write errors and reset the counter
+ */
+uint64_t IpfixFile::take_lost()
+{
+   uint64_t lost = m_lost;
+   m_lost = 0;
+   return lost;
+}
+
+/**
+ * \brief Write buffered data to the file
+ *
+ * With direct I/O, only aligned part of the data is written unless all data
+ * is requested. Buffered data are lost when the write fails.
+ *
+ * \param all Write also unaligned tail of the data
+ */
+bool IpfixFile::write_buffer(bool all)
+{
+   size_t len = m_used;
+   size_t done = 0;
+
+   if (m_direct && !all) {
+      len -= len % FILE_ALIGN;
+   } else if (m_direct && len % FILE_ALIGN) {
+      /* Tail of the file cannot be written directly */
+      fcntl(m_fd, F_SETFL, fcntl(m_fd, F_GETFL) & ~O_DIRECT);
+   }
+
+   while (done < len) {
+      ssize_t ret = ::write(m_fd, m_buf + done, len - done);
+      if (ret == -1) {
+         if (errno == EINTR) {
+            continue;
+         }
+         m_lost += m_buf_flows;
+         m_buf_flows = 0;
+         m_used = 0;
+         return false;
+      }
+      done += ret;
+   }
+
+   memmove(m_buf, m_buf + len, m_used - len);
+   m_used -= len;
+   if (!m_used) {
+      m_buf_flows = 0;
+   }
+   return true;
+}
+
+}
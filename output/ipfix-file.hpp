@@ -0,0 +1,86 @@
+/**
+ * \file ipfix-file.hpp
+ * \brief IPFIX file writer with rotation
+ * \date 2026
+ */
+/*
+ * Copyright (C) 2026 CESNET
+ *
+ * LICENSE TERMS
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name of the Company nor the names of its contributors
+ *    may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ *
+ *
+ */
+
+#ifndef IPXP_OUTPUT_IPFIX_FILE_HPP
+#define IPXP_OUTPUT_IPFIX_FILE_HPP
+
+#include <string>
+#include <ctime>
+#include <cstdint>
+#include <cstddef>
+
+namespace ipxp {
+
+#define FILE_BUFFER_SIZE (4 * 1024 * 1024) /**< Size of write buffer, data is written in pieces of this size */
+#define FILE_ALIGN 4096 /**< Alignment of buffer and writes required by direct I/O */
+#define FILE_RETRY_INTERVAL 1 /**< Time in seconds to wait before opening a file again after failure */
+
+/**
+ * \brief Writer of IPFIX files (RFC 5655), i.e. plain sequences of IPFIX messages.
+ *
+ * File name is a strftime() pattern expanded with the time the file is
+ * opened at, or the start of rotation interval. A numeric suffix is added
+ * when the file already exists. Messages are collected in a large buffer
+ * written at once, optionally bypassing page cache with O_DIRECT. When a file
+ * cannot be opened, rotation is requested again after FILE_RETRY_INTERVAL.
+ */
+class IpfixFile
+{
+public:
+   IpfixFile(const std::string &pattern, uint32_t rotate_time, uint64_t rotate_size, bool direct);
+   ~IpfixFile();
+
+   bool open(time_t now);
+   void close();
+   bool write(const uint8_t *data, uint16_t length, uint16_t flows);
+   bool need_rotation(time_t now, uint16_t length) const;
+   uint64_t take_lost();
+
+   const std::string &name() const { return m_name; }
+
+private:
+   std::string m_pattern;
+   uint32_t m_rotate_time; /**< Rotation interval in seconds, 0 when disabled */
+   uint64_t m_rotate_size; /**< Maximal file size in bytes, 0 when unlimited */
+   bool m_direct;
+
+   int m_fd;
+   std::string m_name; /**< Name of the current file */
+   time_t m_end; /**< End of rotation interval of the current file */
+   time_t m_retry; /**< Time of the next attempt to open a file when no file is open */
+   uint64_t m_size; /**< Size of data of the current file including buffered data */
+   uint64_t m_lost; /**< Flows lost due to write errors since last take_lost() */
+
+   uint8_t *m_buf;
+   size_t m_used;
+   uint64_t m_buf_flows; /**< Number of flows in write buffer */
+
+   bool write_buffer(bool all);
+};
+
+}
+#endif /* IPXP_OUTPUT_IPFIX_FILE_HPP */
@@ -0,0 +1,484 @@
+/**
+ * \file ipfix-spool.cpp
+ * \brief Disk spool of IPFIX messages waiting for collector
+ * \date 2026
+ */
+/*
+ * Copyright (C) 2026 CESNET
+ *
+ * LICENSE TERMS
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name of the Company nor the names of its contributors
+ *    may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ *
+ *
+ */
+
+#include <cstring>
+#include <cerrno>
+#include <algorithm>
+#include <unistd.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+
+#include <ipfixprobe/plugin.hpp>
+
+#include "ipfix-spool.hpp"
+
+namespace ipxp {
+
+static bool write_all(int fd, const uint8_t *data, size_t size)
+{
+   while (size) {
+      ssize_t ret = write(fd, data, size);
+      if (ret == -1) {
+         if (errno == EINTR) {
+            continue;
+         }
+         return false;
+      }
+      data += ret;
+      size -= ret;
+   }
+   return true;
+}
+
+IpfixSpool::IpfixSpool(const std::string &dir, const std::string &prefix, uint64_t limit) :
+   m_dir(dir), m_prefix(prefix), m_limit(limit), m_seq(0), m_lock(-1),
+   m_msgs(0), m_flows(0), m_bytes(0), m_lost(0),
+   m_wr_buf(nullptr), m_wr_used(0), m_wr_msgs(0), m_wr_flows(0),
+   m_rd_buf(nullptr), m_rd_head(0), m_rd_tail(0)
+{
+   if (access(dir.c_str(), W_OK | X_OK) == -1) {
+      throw PluginError("unable to use spool directory " + dir + ": " + strerror(errno));
+   }
+   std::string lock = m_dir + "/" + m_prefix + ".lock";
+   m_lock = open(lock.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+   if (m_lock == -1) {
+      throw PluginError("unable to create spool lock " + lock + ": " + strerror(errno));
+   }
+   if (flock(m_lock, LOCK_EX | LOCK_NB) == -1) {
+      ::close(m_lock);
+      throw PluginError("spool " + m_prefix + " in " + dir + " is used by another exporter");
+   }
+   m_wr_buf = new uint8_t[SPOOL_BUFFER_SIZE];
+   m_rd_buf = new uint8_t[SPOOL_BUFFER_SIZE];
+   recover();
+}
+
+IpfixSpool::~IpfixSpool()
+{
+   persist();
+   for (auto &it : m_segs) {
+      ::close(it.fd);
+   }
+   ::close(m_lock);
+   delete[] m_wr_buf;
+   delete[] m_rd_buf;
+}
+
+/**
+ * \brief Append message to the spool
+ *
+ * \param data Message data
+ * \param length Message length
+ * \param flows Number of flows in message
+ * \return True on success, false when the spool is full or the file cannot be written
+ */
+bool IpfixSpool::push(const uint8_t *data, uint16_t length, uint16_t flows)
+{
+   size_t size = SPOOL_RECORD_HEADER + length;
+
+   if (m_bytes + size > m_limit) {
+      return false;
+   }
+   if (m_segs.empty() || m_segs.back().written + m_wr_used + size > SPOOL_SEGMENT_SIZE) {
+      if (!write_buffer() || !open_segment()) {
+         return false;
+      }
+   }
+   if (m_wr_used + size > SPOOL_BUFFER_SIZE && !write_buffer()) {
+      return false;
+   }
+
+   memcpy(m_wr_buf + m_wr_used, &length, sizeof(length));
+   memcpy(m_wr_buf + m_wr_used + sizeof(length), &flows, sizeof(flows));
+   memcpy(m_wr_buf + m_wr_used + SPOOL_RECORD_HEADER, data, length);
+   m_wr_used += size;
+   m_wr_msgs++;
+   m_wr_flows += flows;
+
+   m_msgs++;
+   m_flows += flows;
+   m_bytes += size;
+   return true;
+}
+
+/**
+ * \brief Get the oldest message of the spool
+ *
+ * Returned data are valid until pop() or clear() is called. Whole spool is
+ * cleared when the message cannot be read.
+ *
+ * \param data Pointer to message data
+ * \param length Message length
+ * \param flows Number of flows in message
+ * \return True on success, false when the spool is empty
+ */
+bool IpfixSpool::front(uint8_t **data, uint16_t *length, uint16_t *flows)
+{
+   if (!m_msgs || !fill(SPOOL_RECORD_HEADER)) {
+      return false;
+   }
+   memcpy(length, m_rd_buf + m_rd_head, sizeof(*length));
+   memcpy(flows, m_rd_buf + m_rd_head + sizeof(*length), sizeof(*flows));
+   if (!fill(SPOOL_RECORD_HEADER + *length)) {
+      return false;
+   }
+
+   *data = m_rd_buf + m_rd_head + SPOOL_RECORD_HEADER;
+   return true;
+}
+
+/**
+ * \brief Remove the message returned by front()
+ */
+void IpfixSpool::pop()
+{
+   uint16_t length;
+   uint16_t flows;
+
+   memcpy(&length, m_rd_buf + m_rd_head, sizeof(length));
+   memcpy(&flows, m_rd_buf + m_rd_head + sizeof(length), sizeof(flows));
+   m_rd_head += SPOOL_RECORD_HEADER + length;
+
+   m_msgs--;
+   m_flows -= flows;
+   m_bytes -= SPOOL_RECORD_HEADER + length;
+   if (!m_msgs) {
+      /* Release disk space right after the outage */
+      remove_segments();
+      m_rd_head = 0;
+      m_rd_tail = 0;
+   }
+}
+
+/**
+ * \brief Remove all messages, their flows are accounted as lost
+ */
+void IpfixSpool::clear()
+{
+   m_lost += m_flows;
+   m_msgs = 0;
+   m_flows = 0;
+   m_bytes = 0;
+   m_wr_used = 0;
+   m_wr_msgs = 0;
+   m_wr_flows = 0;
+   m_rd_head = 0;
+   m_rd_tail = 0;
+   remove_segments();
+}
+
+/**
+ * \brief Return message taken out of the spool to its front
+ *
+ * Requeued messages precede stored messages in order of calls. They are written
+ * to disk on destruction, no other method can be called after requeue().
+ *
+ * \param data Message data
+ * \param length Message length
+ * \param flows Number of flows in message
+ */
+void IpfixSpool::requeue(const uint8_t *data, uint16_t length, uint16_t flows)
+{
+   size_t pos = m_requeued.size();
+   m_requeued.resize(pos + SPOOL_RECORD_HEADER + length);
+   memcpy(&m_requeued[pos], &length, sizeof(length));
+   memcpy(&m_requeued[pos + sizeof(length)], &flows, sizeof(flows));
+   memcpy(&m_requeued[pos + SPOOL_RECORD_HEADER], data, length);
+
+   m_msgs++;
+   m_flows += flows;
+   m_bytes += SPOOL_RECORD_HEADER + length;
+}
+
+/**
+ * \brief Get number of flows lost due to file errors or clear() and reset the counter
+ */
+uint64_t IpfixSpool::take_lost()
+{
+   uint64_t lost = m_lost;
+   m_lost = 0;
+   return lost;
+}
+
+/**
+ * \brief Create new segment file to append messages to
+ */
+std::string IpfixSpool::segment_path(uint64_t seq) const
+{
+   return m_dir + "/" + m_prefix + "." + std::to_string(seq) + ".spool";
+}
+
+bool IpfixSpool::open_segment()
+{
+   Segment seg;
+
+   seg.path = segment_path(m_seq++);
+   seg.fd = open(seg.path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+   if (seg.fd == -1) {
+      return false;
+   }
+   seg.written = 0;
+   seg.read = 0;
+   m_segs.push_back(seg);
+   return true;
+}
+
+/**
+ * \brief Write content of write buffer to the last segment
+ *
+ * Messages in write buffer are lost when the write fails.
+ */
+bool IpfixSpool::write_buffer()
+{
+   size_t done = 0;
+
+   while (done < m_wr_used) {
+      Segment &seg = m_segs.back();
+      ssize_t ret = pwrite(seg.fd, m_wr_buf + done, m_wr_used - done, seg.written + done);
+      if (ret == -1) {
+         if (errno == EINTR) {
+            continue;
+         }
+         m_msgs -= m_wr_msgs;
+         m_flows -= m_wr_flows;
+         m_bytes -= m_wr_used;
+         m_lost += m_wr_flows;
+         break;
+      }
+      done += ret;
+   }
+
+   bool ok = done == m_wr_used;
+   if (ok && done) {
+      m_segs.back().written += done;
+   }
+   m_wr_used = 0;
+   m_wr_msgs = 0;
+   m_wr_flows = 0;
+   return ok;
+}
+
+/**
+ * \brief Read data from segments until read buffer holds at least size bytes
+ */
+bool IpfixSpool::fill(size_t size)
+{
+   while (m_rd_tail - m_rd_head < size) {
+      if (m_rd_head) {
+         memmove(m_rd_buf, m_rd_buf + m_rd_head, m_rd_tail - m_rd_head);
+         m_rd_tail -= m_rd_head;
+         m_rd_head = 0;
+      }
+
+      if (m_segs.empty()) {
+         return false;
+      }
+      Segment &seg = m_segs.front();
+      if (seg.read == seg.written) {
+         if (m_segs.size() > 1) {
+            /* Records never cross segments, the segment is consumed */
+            ::close(seg.fd);
+            unlink(seg.path.c_str());
+            m_segs.pop_front();
+         } else if (!m_wr_used || !write_buffer()) {
+            return false;
+         }
+         continue;
+      }
+
+      size_t len = std::min<uint64_t>(SPOOL_BUFFER_SIZE - m_rd_tail, seg.written - seg.read);
+      ssize_t ret = pread(seg.fd, m_rd_buf + m_rd_tail, len, seg.read);
+      if (ret == -1 && errno == EINTR) {
+         continue;
+      } else if (ret <= 0) {
+         clear();
+         return false;
+      }
+      seg.read += ret;
+      m_rd_tail += ret;
+   }
+   return true;
+}
+
+/**
+ * \brief Close and remove all segment files
+ */
+void IpfixSpool::remove_segments()
+{
+   for (auto &it : m_segs) {
+      ::close(it.fd);
+      unlink(it.path.c_str());
+   }
+   m_segs.clear();
+}
+
+/**
+ * \brief Load segment files left by previous spool with the same prefix
+ */
+void IpfixSpool::recover()
+{
+   std::string begin = m_prefix + ".";
+   std::string end = ".spool";
+   std::vector<uint64_t> seqs;
+
+   DIR *dir = opendir(m_dir.c_str());
+   if (dir == nullptr) {
+      return;
+   }
+   struct dirent *entry;
+   while ((entry = readdir(dir)) != nullptr) {
+      std::string name = entry->d_name;
+      if (name.size() <= begin.size() + end.size() || name.compare(0, begin.size(), begin) ||
+            name.compare(name.size() - end.size(), end.size(), end)) {
+         continue;
+      }
+      std::string seq = name.substr(begin.size(), name.size() - begin.size() - end.size());
+      if (seq.find_first_not_of("0123456789") == std::string::npos) {
+         seqs.push_back(std::stoull(seq));
+      }
+   }
+   closedir(dir);
+   std::sort(seqs.begin(), seqs.end());
+
+   for (auto seq : seqs) {
+      Segment seg;
+      seg.path = segment_path(seq);
+      seg.fd = open(seg.path.c_str(), O_RDWR | O_CLOEXEC);
+      seg.written = 0;
+      seg.read = 0;
+      if (seg.fd == -1) {
+         continue;
+      }
+      if (!recover_segment(seg)) {
+         ::close(seg.fd);
+         unlink(seg.path.c_str());
+         continue;
+      }
+      m_segs.push_back(seg);
+      m_seq = seq + 1;
+   }
+}
+
+/**
+ * \brief Count complete records of the segment, incomplete record at its end is removed
+ *
+ * \param seg Segment with opened file
+ * \return False when the segment holds no complete record
+ */
+bool IpfixSpool::recover_segment(Segment &seg)
+{
+   struct stat st;
+   if (fstat(seg.fd, &st) == -1) {
+      return false;
+   }
+
+   uint64_t size = st.st_size;
+   uint64_t base = 0; /* File offset of read buffer start */
+   size_t used = 0;
+   while (true) {
+      size_t pos = seg.written - base;
+      uint16_t length = 0;
+      uint16_t flows = 0;
+      if (used - pos >= SPOOL_RECORD_HEADER) {
+         memcpy(&length, m_rd_buf + pos, sizeof(length));
+         memcpy(&flows, m_rd_buf + pos + sizeof(length), sizeof(flows));
+      }
+      if (used - pos < SPOOL_RECORD_HEADER || used - pos < static_cast<size_t>(SPOOL_RECORD_HEADER + length)) {
+         if (base + used == size) {
+            break;
+         }
+         memmove(m_rd_buf, m_rd_buf + pos, used - pos);
+         base += pos;
+         used -= pos;
+         ssize_t ret = pread(seg.fd, m_rd_buf + used, std::min<uint64_t>(SPOOL_BUFFER_SIZE - used, size - base - used), base + used);
+         if (ret == -1 && errno == EINTR) {
+            continue;
+         } else if (ret <= 0) {
+            break;
+         }
+         used += ret;
+         continue;
+      }
+
+      seg.written += SPOOL_RECORD_HEADER + length;
+      m_msgs++;
+      m_flows += flows;
+      m_bytes += SPOOL_RECORD_HEADER + length;
+   }
+
+   if (seg.written != size && ftruncate(seg.fd, seg.written) == -1) {
+      return false;
+   }
+   return seg.written != 0;
+}
+
+/**
+ * \brief Keep stored messages in segment files for the next spool
+ *
+ * Requeued messages and messages in read buffer are written in front of
+ * unread data of the first segment, which replaces it.
+ */
+void IpfixSpool::persist()
+{
+   write_buffer();
+   if (!m_msgs) {
+      remove_segments();
+      return;
+   }
+
+   size_t buffered = m_rd_tail - m_rd_head;
+   if (m_requeued.empty() && !buffered && (m_segs.empty() || !m_segs.front().read)) {
+      return;
+   }
+   if (m_segs.empty() && !open_segment()) {
+      return;
+   }
+
+   Segment &seg = m_segs.front();
+   std::string path = seg.path + ".tmp";
+   int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+   bool ok = fd != -1 && write_all(fd, m_requeued.data(), m_requeued.size()) &&
+      write_all(fd, m_rd_buf + m_rd_head, buffered);
+   while (ok && seg.read < seg.written) {
+      ssize_t ret = pread(seg.fd, m_wr_buf, std::min<uint64_t>(SPOOL_BUFFER_SIZE, seg.written - seg.read), seg.read);
+      if (ret == -1 && errno == EINTR) {
+         continue;
+      }
+      ok = ret > 0 && write_all(fd, m_wr_buf, ret);
+      seg.read += ret;
+   }
+   if (fd != -1) {
+      ::close(fd);
+   }
+   if (!ok || rename(path.c_str(), seg.path.c_str()) == -1) {
+      unlink(path.c_str());
+   }
+}
+
+}
@@ -0,0 +1,111 @@
+/**
+ * \file ipfix-spool.hpp
+ * \brief Disk spool of IPFIX messages waiting for collector
+ * \date 2026
+ */
+/*
+ * Copyright (C) 2026 CESNET
+ *
+ * LICENSE TERMS
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name of the Company nor the names of its contributors
+ *    may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ *
+ *
+ */
+
+#ifndef IPXP_OUTPUT_IPFIX_SPOOL_HPP
+#define IPXP_OUTPUT_IPFIX_SPOOL_HPP
+
+#include <string>
+#include <deque>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+namespace ipxp {
+
+#define SPOOL_BUFFER_SIZE (1024 * 1024) /**< Size of write and read buffers, data is written and read in pieces of this size */
+#define SPOOL_SEGMENT_SIZE (64 * 1024 * 1024) /**< Maximal size of one segment file */
+#define SPOOL_RECORD_HEADER 4 /**< Size of record header, 2B message length and 2B number of flows */
+
+/**
+ * \brief FIFO of IPFIX messages stored in append-only segment files.
+ *
+ * Messages are appended to the last segment through a write buffer and read
+ * from the first segment through a read buffer. A segment file is removed
+ * as soon as all of its messages are read. Segment files of a non-empty spool
+ * are kept on destruction and loaded by the next spool with the same prefix
+ * in the directory, so stored messages survive restart. The prefix is locked
+ * while the spool exists.
+ */
+class IpfixSpool
+{
+public:
+   IpfixSpool(const std::string &dir, const std::string &prefix, uint64_t limit);
+   ~IpfixSpool();
+
+   bool push(const uint8_t *data, uint16_t length, uint16_t flows);
+   bool front(uint8_t **data, uint16_t *length, uint16_t *flows);
+   void pop();
+   void clear();
+   void requeue(const uint8_t *data, uint16_t length, uint16_t flows);
+   uint64_t take_lost();
+
+   bool empty() const { return m_msgs == 0; }
+   uint64_t size() const { return m_bytes; }
+
+private:
+   struct Segment {
+      std::string path;
+      int fd;
+      uint64_t written; /**< Size of data written to the file */
+      uint64_t read; /**< Size of data read from the file */
+   };
+
+   std::string m_dir;
+   std::string m_prefix;
+   uint64_t m_limit; /**< Maximal size of stored records */
+   uint64_t m_seq; /**< Number of the next segment file */
+   int m_lock; /**< Locked file descriptor of the prefix */
+   std::deque<Segment> m_segs; /**< Segments from the oldest one, messages are appended to the last one */
+
+   uint64_t m_msgs; /**< Number of stored messages */
+   uint64_t m_flows; /**< Number of flows in stored messages */
+   uint64_t m_bytes; /**< Size of stored records */
+   uint64_t m_lost; /**< Flows lost due to file errors since last take_lost() */
+
+   uint8_t *m_wr_buf;
+   size_t m_wr_used;
+   uint64_t m_wr_msgs; /**< Number of messages in write buffer */
+   uint64_t m_wr_flows; /**< Number of flows in write buffer */
+
+   uint8_t *m_rd_buf;
+   size_t m_rd_head;
+   size_t m_rd_tail;
+
+   std::vector<uint8_t> m_requeued; /**< Records returned in front of the spool by requeue() */
+
+   std::string segment_path(uint64_t seq) const;
+   bool open_segment();
+   bool write_buffer();
+   bool fill(size_t size);
+   void remove_segments();
+   void recover();
+   bool recover_segment(Segment &seg);
+   void persist();
+};
+
+}
+#endif /* IPXP_OUTPUT_IPFIX_SPOOL_HPP */
@@ -42,8 +42,14 @@
 #include <stdlib.h>
 #include <unistd.h>
 #include <string.h>
+#include <ctype.h>
 #include <sys/socket.h>
 #include <sys/types.h>
+#include <sys/uio.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <netinet/in.h>
+#include <netinet/udp.h>
 #include <arpa/inet.h>
 #include <netdb.h>
 #include <errno.h>
@@ -133,8 +139,9 @@ const char *basic_tmplt_v6[] = {
 
 IPFIXExporter::IPFIXExporter() :
    extensions(nullptr), extension_cnt(0),
+   tmpltTable(TEMPLATE_TABLE_SIZE), tmpltTableCnt(0),
    templates(nullptr), templatesDataSize(0),
-   basic_ifc_num(-1), verbose(false),
+   verbose(false),
    sequenceNum(0), exportedPackets(0),
    fd(-1), addrinfo(nullptr),
    host(""), port(4739), protocol(IPPROTO_TCP),
@@ -144,7 +151,17 @@ IPFIXExporter::IPFIXExporter() :
    templateRefreshPackets(TEMPLATE_REFRESH_PACKETS),
    dir_bit_field(0),
    mtu(DEFAULT_MTU), packetDataBuffer(nullptr),
-   tmpltMaxBufferSize(mtu - IPFIX_HEADER_SIZE)
+   tmpltMaxBufferSize(mtu - IPFIX_HEADER_SIZE),
+   batchSize(IPFIX_BATCH_MSGS), batchCnt(0), batch(nullptr),
+   iov(nullptr), msgs(nullptr), msgPackets(nullptr), cmsgBuffer(nullptr),
+#ifdef UDP_SEGMENT
+   gso(true),
+#else
+   gso(false),
+#endif
+   spill(nullptr), spillSize(IPFIX_SPILL_SIZE), spillHead(0), spillTail(0), spillSent(0),
+   spillPkts(nullptr), spool(nullptr), replayRate(IPFIX_REPLAY_RATE), replayBudget(0), replayTime({0, 0}),
+   file(nullptr), connecting(false), resendTemplates(false)
 {
 }
 
@@ -169,9 +186,14 @@ void IPFIXExporter::init(const char *params)
    host = parser.m_host;
    port = parser.m_port;
    odid = parser.m_id;
+   if (parser.m_worker_odid) {
+      odid += m_worker_id;
+   }
    mtu = parser.m_mtu;
    dir_bit_field = parser.m_dir;
    templateRefreshTime = parser.m_template_refresh_time;
+   batchSize = parser.m_batch;
+   spillSize = parser.m_spill;
 
    if (parser.m_udp) {
       protocol = IPPROTO_UDP;
@@ -180,15 +202,55 @@ void IPFIXExporter::init(const char *params)
    if (mtu <= IPFIX_HEADER_SIZE) {
       throw PluginError("IPFIX message MTU size should be at least " + std::to_string(IPFIX_HEADER_SIZE));
    }
+   if (spillSize < mtu) {
+      throw PluginError("spill buffer size should be at least MTU size " + std::to_string(mtu));
+   }
    tmpltMaxBufferSize = mtu - IPFIX_HEADER_SIZE;
-   packetDataBuffer = (uint8_t *) malloc(sizeof(uint8_t) * mtu);
-   if (!packetDataBuffer) {
+   packetDataBuffer = (uint8_t *) malloc(sizeof(uint8_t) * mtu * batchSize);
+   batch = (ipfix_packet_t *) malloc(sizeof(ipfix_packet_t) * batchSize);
+   iov = (struct iovec *) malloc(sizeof(struct iovec) * batchSize);
+   msgs = (struct mmsghdr *) malloc(sizeof(struct mmsghdr) * batchSize);
+   msgPackets = (uint16_t *) malloc(sizeof(uint16_t) * batchSize);
+   cmsgBuffer = (uint8_t *) calloc(batchSize, CMSG_SPACE(sizeof(uint16_t)));
+   spill = (uint8_t *) malloc(spillSize);
+   spillPkts = (ipfix_packet_t *) malloc(sizeof(ipfix_packet_t) * batchSize);
+   if (!packetDataBuffer || !batch || !iov || !msgs || !msgPackets || !cmsgBuffer || !spill || !spillPkts) {
       throw PluginError("not enough memory");
    }
+   for (uint16_t i = 0; i < batchSize; i++) {
+      batch[i].data = packetDataBuffer + i * mtu;
+   }
 
-   int ret = connect_to_collector();
-   if (ret) {
-      lastReconnect = time(nullptr);
+   if (!parser.m_spool.empty()) {
+      /* Prefix is stable across restarts, so the next run replays what is left in the spool */
+      std::string prefix = "ipfixprobe-" + host + "-" + std::to_string(port) + "-" + std::to_string(m_worker_id);
+      for (auto &it : prefix) {
+         if (!isalnum(it) && it != '-' && it != '.') {
+            it = '_';
+         }
+      }
+      spool = new IpfixSpool(parser.m_spool, prefix, parser.m_spool_limit);
+      if (verbose && !spool->empty()) {
+         fprintf(stderr, "VERBOSE: %" PRIu64 " bytes of spooled messages recovered\n", spool->size());
+      }
+      replayRate = parser.m_replay;
+      replayBudget = replayRate;
+      clock_gettime(CLOCK_MONOTONIC, &replayTime);
+   }
+
+   if (!parser.m_file.empty()) {
+      file = new IpfixFile(worker_path(parser.m_file), parser.m_rotate, parser.m_rotate_size, parser.m_direct);
+      if (!file->open(time(nullptr))) {
+         throw PluginError("unable to open file " + file->name() + ": " + strerror(errno));
+      }
+      if (verbose) {
+         fprintf(stderr, "VERBOSE: Writing IPFIX file %s\n", file->name().c_str());
+      }
+   } else {
+      int ret = connect_to_collector();
+      if (ret) {
+         lastReconnect = time(nullptr);
+      }
    }
 
    if (verbose) {
@@ -226,8 +288,17 @@ void IPFIXExporter::init(const char *params, Plugins &plugins)
 
 void IPFIXExporter::close()
 {
-   /* Try to flush any remaining data */
-   flush();
+   /* Try to flush any remaining data, the plugin may be closed already */
+   if (batch != nullptr) {
+      flush();
+      drain_spill();
+   }
+   if (file != nullptr) {
+      file->close();
+      m_flows_dropped += file->take_lost();
+      delete file;
+      file = nullptr;
+   }
 
    /* Close the connection */
    if (fd != -1) {
@@ -236,6 +307,7 @@ void IPFIXExporter::close()
       addrinfo = nullptr;
       fd = -1;
    }
+   connecting = false;
 
    template_t *tmp = templates;
    while (tmp != nullptr) {
@@ -245,51 +317,91 @@ void IPFIXExporter::close()
       tmp = templates;
    }
    templates = nullptr;
+   tmpltTable.assign(tmpltTable.size(), TmpltSlot());
+   tmpltTableCnt = 0;
 
    if (packetDataBuffer != nullptr) {
       free(packetDataBuffer);
       packetDataBuffer = nullptr;
    }
+   free(batch);
+   free(iov);
+   free(msgs);
+   free(msgPackets);
+   free(cmsgBuffer);
+   free(spill);
+   free(spillPkts);
+   delete spool;
+   batch = nullptr;
+   iov = nullptr;
+   msgs = nullptr;
+   msgPackets = nullptr;
+   cmsgBuffer = nullptr;
+   spill = nullptr;
+   spillPkts = nullptr;
+   spool = nullptr;
    if (extensions != nullptr) {
       delete [] extensions;
       extensions = nullptr;
    }
 }
 
-uint64_t IPFIXExporter::get_template_id(const Record &flow)
+/**
+ * \brief Find slot of template table with given extension mask or an unused slot
+ *
+ * @param mask Extension mask
+ * @return Slot with the templates or unused slot to store them to
+ */
+IPFIXExporter::TmpltSlot *IPFIXExporter::find_template_slot(uint64_t mask)
 {
-   RecordExt *ext = flow.m_exts;
-   uint64_t tmpltIdx = 0;
-   while (ext != nullptr) {
-      tmpltIdx |= ((uint64_t) 1 << ext->m_ext_id);
-      ext = ext->m_next;
+   uint32_t size_mask = tmpltTable.size() - 1;
+   uint32_t idx = ((mask * 0x9E3779B97F4A7C15ULL) >> 32) & size_mask;
+
+   while (tmpltTable[idx].tmplt[TMPLT_IDX_V4] != nullptr && tmpltTable[idx].mask != mask) {
+      idx = (idx + 1) & size_mask;
    }
+   return &tmpltTable[idx];
+}
+
+/**
+ * \brief Double the number of slots of template table
+ */
+void IPFIXExporter::grow_template_table()
+{
+   std::vector<TmpltSlot> old(tmpltTable.size() * 2);
 
-   return tmpltIdx;
+   old.swap(tmpltTable);
+   for (auto &slot : old) {
+      if (slot.tmplt[TMPLT_IDX_V4] != nullptr) {
+         *find_template_slot(slot.mask) = slot;
+      }
+   }
 }
 
-template_t *IPFIXExporter::get_template(const Flow &flow)
+/**
+ * \brief Get template of flow, create it when it does not exist
+ *
+ * Extensions of the flow must be stored in extensions array.
+ *
+ * @param flow Flow to export
+ * @param mask Extension mask of the flow
+ * @return Template to export the flow with
+ */
+template_t *IPFIXExporter::get_template(const Flow &flow, uint64_t mask)
 {
    int ipTmpltIdx = flow.ip_version == IP::v6 ? TMPLT_IDX_V6 : TMPLT_IDX_V4;
-   uint64_t tmpltIdx = get_template_id(flow);
+   TmpltSlot *slot = find_template_slot(mask);
 
-   if (tmpltMap[ipTmpltIdx].find(tmpltIdx) == tmpltMap[ipTmpltIdx].end()) {
+   if (slot->tmplt[TMPLT_IDX_V4] == nullptr) {
       std::vector<const char *> all_fields;
+      uint8_t extIds[TEMPLATE_MAX_EXTS];
+      uint8_t extCnt = 0;
 
-      RecordExt *ext = flow.m_exts;
-      while (ext != nullptr) {
-         if (ext->m_ext_id < 0 || ext->m_ext_id >= extension_cnt) {
-            throw PluginError("encountered invalid extension id");
-         }
-         extensions[ext->m_ext_id] = ext;
-         ext = ext->m_next;
-      }
       for (int i = 0; i < extension_cnt; i++) {
-         if (extensions[i] == nullptr) {
+         if (!(mask & ((uint64_t) 1 << i))) {
             continue;
          }
          const char **fields = extensions[i]->get_ipfix_tmplt();
-         extensions[i] = nullptr;
          if (fields == nullptr) {
             throw PluginError("missing template fields for extension with ID " + std::to_string(i));
          }
@@ -297,36 +409,40 @@ template_t *IPFIXExporter::get_template(const Flow &flow)
             all_fields.push_back(*fields);
             fields++;
          }
+         extIds[extCnt++] = i;
       }
       all_fields.push_back(nullptr);
 
-      tmpltMap[TMPLT_IDX_V4][tmpltIdx] = create_template(basic_tmplt_v4, all_fields.data());
-      tmpltMap[TMPLT_IDX_V6][tmpltIdx] = create_template(basic_tmplt_v6, all_fields.data());
+      if ((tmpltTableCnt + 1) * 2 > tmpltTable.size()) {
+         grow_template_table();
+         slot = find_template_slot(mask);
+      }
+
+      template_t *tmplt[TMPLT_MAP_IDX_CNT];
+      tmplt[TMPLT_IDX_V4] = create_template(basic_tmplt_v4, all_fields.data());
+      tmplt[TMPLT_IDX_V6] = create_template(basic_tmplt_v6, all_fields.data());
+      for (int i = 0; i < TMPLT_MAP_IDX_CNT; i++) {
+         if (tmplt[i] == nullptr) {
+            throw PluginError("unable to create template");
+         }
+         tmplt[i]->extCnt = extCnt;
+         memcpy(tmplt[i]->extIds, extIds, extCnt);
+         slot->tmplt[i] = tmplt[i];
+      }
+      slot->mask = mask;
+      tmpltTableCnt++;
    }
 
-   return tmpltMap[ipTmpltIdx][tmpltIdx];
+   return slot->tmplt[ipTmpltIdx];
 }
 
-int IPFIXExporter::fill_extensions(RecordExt *ext, uint8_t *buffer, int size)
+int IPFIXExporter::fill_extensions(template_t *tmplt, uint8_t *buffer, int size)
 {
    int length = 0;
-   int extCnt = 0;
-   while (ext != nullptr) {
-      extensions[ext->m_ext_id] = ext;
-      extCnt++;
-      ext = ext->m_next;
-   }
    // TODO: export multiple extension header of same type
-   for (int i = 0; i < extension_cnt; i++) {
-      if (extensions[i] == nullptr) {
-         continue;
-      }
-      int length_ext = extensions[i]->fill_ipfix(buffer + length, size - length);
-      extensions[i] = nullptr;
+   for (uint8_t i = 0; i < tmplt->extCnt; i++) {
+      int length_ext = extensions[tmplt->extIds[i]]->fill_ipfix(buffer + length, size - length);
       if (length_ext < 0) {
-         for (int j = i; j < extension_cnt; j++) {
-            extensions[j] = nullptr;
-         }
          return -1;
       }
       length += length_ext;
@@ -336,21 +452,20 @@ int IPFIXExporter::fill_extensions(RecordExt *ext, uint8_t *buffer, int size)
 
 bool IPFIXExporter::fill_template(const Flow &flow, template_t *tmplt)
 {
-   RecordExt *ext = flow.m_exts;
    int length = 0;
 
-   if (basic_ifc_num >= 0 && ext == nullptr) {
-      length = fill_basic_flow(flow, tmplt);
-      if (length < 0) {
-         return false;
-      }
-   } else {
-      length = fill_basic_flow(flow, tmplt);
-      if (length < 0) {
-         return false;
-      }
+   /* Record of fixed size template does not fit */
+   if (tmplt->recordSize && tmplt->bufferSize + tmplt->recordSize > tmpltMaxBufferSize) {
+      return false;
+   }
+
+   length = fill_basic_flow(flow, tmplt);
+   if (length < 0) {
+      return false;
+   }
 
-      int ext_written = fill_extensions(ext, tmplt->buffer + tmplt->bufferSize + length, tmpltMaxBufferSize - tmplt->bufferSize - length);
+   if (tmplt->extCnt) {
+      int ext_written = fill_extensions(tmplt, tmplt->buffer + tmplt->bufferSize + length, tmpltMaxBufferSize - tmplt->bufferSize - length);
       if (ext_written < 0) {
          return false;
       }
@@ -364,10 +479,21 @@ bool IPFIXExporter::fill_template(const Flow &flow, template_t *tmplt)
 
 int IPFIXExporter::export_flow(const Flow &flow)
 {
+   uint64_t mask = 0;
+
    m_flows_seen++;
-   template_t *tmplt = get_template(flow);
+   for (RecordExt *ext = flow.m_exts; ext != nullptr; ext = ext->m_next) {
+      if (ext->m_ext_id < 0 || ext->m_ext_id >= extension_cnt) {
+         throw PluginError("encountered invalid extension id");
+      }
+      extensions[ext->m_ext_id] = ext;
+      mask |= (uint64_t) 1 << ext->m_ext_id;
+   }
+
+   template_t *tmplt = get_template(flow, mask);
    if (!fill_template(flow, tmplt)) {
-      flush();
+      send_templates();
+      send_data(false);
 
       if (!fill_template(flow, tmplt)) {
          m_flows_dropped++;
@@ -550,6 +676,9 @@ template_t *IPFIXExporter::create_template(const char **tmplt, const char **ext)
 
    /* Template header size */
    newTemplate->templateSize = 4;
+   newTemplate->recordSize = 0;
+   newTemplate->extCnt = 0;
+   bool fixedSize = true;
 
    while (1) {
       while (tmp && *tmp) {
@@ -577,6 +706,11 @@ template_t *IPFIXExporter::create_template(const char **tmplt, const char **ext)
             } else {
                len = tmpFileRecord->length;
             }
+            if (tmpFileRecord->length < 0) {
+               fixedSize = false;
+            } else {
+               newTemplate->recordSize += len;
+            }
             *((uint16_t *) &newTemplate->templateRecord[newTemplate->templateSize + 2]) = htons(len);
 
             /* Update template size */
@@ -609,6 +743,9 @@ template_t *IPFIXExporter::create_template(const char **tmplt, const char **ext)
 
    /* Set field count */
    ((uint16_t *) newTemplate->templateRecord)[1] = htons(newTemplate->fieldCount);
+   if (!fixedSize) {
+      newTemplate->recordSize = 0;
+   }
 
    /* Initialize buffer for records */
    init_template_buffer(newTemplate);
@@ -765,31 +902,43 @@ void IPFIXExporter::send_templates()
       /* Send template packet */
       /* After error, the plugin sends all templates after reconnection,
        * so we need not concern about it here */
-      send_packet(&pkt);
+      send_packets(&pkt, 1);
 
       free(pkt.data);
    }
 }
 
 /**
- * \brief Send data in all buffers to collector
+ * \brief Move data in all buffers to the batch of packets
+ *
+ * The batch is sent when it gets full.
+ *
+ * @param all Send also packets waiting in not yet full batch
  */
-void IPFIXExporter::send_data()
+void IPFIXExporter::send_data(bool all)
 {
-   ipfix_packet_t pkt;
-   pkt.data = packetDataBuffer;
-
-   /* Send all new templates */
-   while (create_data_packet(&pkt)) {
-      int ret = send_packet(&pkt);
-      if (ret == 1) {
-         /* Collector reconnected, resend the packet */
-         ret = send_packet(&pkt);
-      }
-      if (ret != 0) {
-         m_flows_dropped += pkt.flows;
+   while (create_data_packet(&batch[batchCnt])) {
+      batchCnt++;
+      if (batchCnt == batchSize) {
+         send_batch();
       }
    }
+   if (all) {
+      send_batch();
+   }
+}
+
+/**
+ * \brief Send packets waiting in batch to collector
+ */
+void IPFIXExporter::send_batch()
+{
+   if (!batchCnt) {
+      return;
+   }
+
+   send_packets(batch, batchCnt);
+   batchCnt = 0;
 }
 
 /**
@@ -797,99 +946,610 @@ void IPFIXExporter::send_data()
  */
 void IPFIXExporter::flush()
 {
+   if (file && file->need_rotation(time(nullptr), 0)) {
+      rotate_file(time(nullptr));
+   }
+
    /* Send all new templates */
    send_templates();
 
-   /* Send the data packet */
-   send_data();
+   /* Send the data packets */
+   send_data(true);
 }
 
 /**
- * \brief Sends packet using UDP or TCP as defined in plugin configuration
+ * \brief Sends packets to collector without blocking
  *
- * When the collector disconnects, tries to reconnect and resend the data
+ * Packets are written directly to the socket only when no older packets wait
+ * in the spill buffer. Packets the socket does not accept now are stored to
+ * the spill buffer, packets that do not fit into it are dropped.
  *
- * \param packet Packet to send
- * \return 0 on success, -1 on socket error, 1 when data needs to be resent (after reconnect)
+ * \param packets Packets to send
+ * \param cnt Number of packets
  */
-int IPFIXExporter::send_packet(ipfix_packet_t *packet)
+void IPFIXExporter::send_packets(ipfix_packet_t *packets, uint16_t cnt)
 {
-   int ret; /* Return value of sendto */
-   int sent = 0; /* Sent data size */
+   uint16_t sent = 0;
+   size_t offset = 0; /* Sent data size of the first unsent packet */
+   int ret = 1;
 
-   /* Check that connection is OK or drop packet */
-   if (reconnect()) {
-      return -1;
+   if (file) {
+      write_file(packets, cnt);
+      return;
+   }
+   if (reconnect() == 0 && flush_spill()) {
+      ret = write_packets(packets, cnt, &sent, &offset);
+   }
+   if (ret == 1 && sent < cnt) {
+      sent += spill_packets(packets + sent, cnt - sent, offset);
+   }
+   if (sent < cnt) {
+      drop_packets(packets + sent, cnt - sent);
+   }
+   if (spool) {
+      m_flows_dropped += spool->take_lost();
+   }
+}
+
+/**
+ * \brief Write packets to IPFIX file
+ *
+ * \param packets Packets to write
+ * \param cnt Number of packets
+ */
+void IPFIXExporter::write_file(ipfix_packet_t *packets, uint16_t cnt)
+{
+   time_t now = time(nullptr);
+
+   for (uint16_t i = 0; i < cnt; i++) {
+      if (file->need_rotation(now, packets[i].length)) {
+         rotate_file(now);
+      }
+      ((ipfix_header_t *) packets[i].data)->sequenceNumber = htonl(sequenceNum);
+      if (!file->write(packets[i].data, packets[i].length, packets[i].flows)) {
+         drop_packets(&packets[i], 1);
+         continue;
+      }
+      sequenceNum += packets[i].flows;
+      exportedPackets++;
+   }
+   m_flows_dropped += file->take_lost();
+}
+
+/**
+ * \brief Close current IPFIX file and open new one starting with all templates
+ *
+ * \param now Current time
+ */
+void IPFIXExporter::rotate_file(time_t now)
+{
+   ipfix_packet_t pkt;
+
+   file->close();
+   if (!file->open(now)) {
+      if (verbose) {
+         fprintf(stderr, "VERBOSE: Cannot open file %s: %s\n", file->name().c_str(), strerror(errno));
+      }
+      return;
+   }
+   if (verbose) {
+      fprintf(stderr, "VERBOSE: Writing IPFIX file %s\n", file->name().c_str());
+   }
+
+   /* Each file must be readable on its own */
+   expire_templates();
+   if (create_template_packet(&pkt)) {
+      ((ipfix_header_t *) pkt.data)->sequenceNumber = htonl(sequenceNum);
+      file->write(pkt.data, pkt.length, 0);
+      free(pkt.data);
+   }
+}
+
+/**
+ * \brief Write packets to the socket using UDP or TCP as defined in plugin configuration
+ *
+ * When the collector disconnects, closes the connection so that the next call
+ * reconnects. Sequence numbers of packets are set here, because they are
+ * unique per connection.
+ *
+ * \param packets Packets to send
+ * \param cnt Number of packets
+ * \param sent Number of packets sent successfully
+ * \param offset Sent data size of the first unsent packet, updated on return
+ * \return 0 on success, 1 when rest of the packets needs to be sent later, -1 when the first unsent packet should be dropped
+ */
+int IPFIXExporter::write_packets(ipfix_packet_t *packets, uint16_t cnt, uint16_t *sent, size_t *offset)
+{
+   uint32_t seq = sequenceNum;
+   int err;
+
+   *sent = 0;
+
+   for (uint16_t i = 0; i < cnt; i++) {
+      ((ipfix_header_t *) packets[i].data)->sequenceNumber = htonl(seq);
+      seq += packets[i].flows;
+   }
+
+   if (protocol == IPPROTO_UDP) {
+      err = send_datagrams(packets, cnt, sent);
+   } else {
+      err = send_stream(packets, cnt, sent, offset);
    }
 
-   /* sendto() does not guarantee that everything will be send in one piece */
-   while (sent < packet->length) {
-      /* Send data to collector (TCP and SCTP ignores last two arguments) */
-      ret = sendto(fd, (void *) (packet->data + sent), packet->length - sent, 0,
-            addrinfo->ai_addr, addrinfo->ai_addrlen);
+   for (uint16_t i = 0; i < *sent; i++) {
+      /* Update sequence number for next packet */
+      sequenceNum += packets[i].flows;
+
+      /* Increase packet counter */
+      exportedPackets++;
+   }
+
+   if (verbose && *sent) {
+      fprintf(stderr, "VERBOSE: %" PRIu16 " packets (%" PRIu64 ") sent to %s on port %" PRIu16 ". Next sequence number is %" PRIu32 "\n",
+            *sent, exportedPackets, host.c_str(), port, sequenceNum);
+   }
+
+   if (err == EAGAIN || err == EWOULDBLOCK) {
+      /* Socket buffer is full */
+      return 1;
+   } else if (err) {
+      int ret = send_error(err);
+      if (ret == -1 && *offset) {
+         /* Part of the packet is already in the stream, it cannot be dropped alone */
+         send_error(ECONNRESET);
+         ret = 1;
+      }
+      *offset = 0;
+      return ret;
+   }
+   return 0;
+}
+
+/**
+ * \brief Send packets stored in spill buffer
+ *
+ * \return True when the spill buffer is empty
+ */
+bool IPFIXExporter::flush_spill()
+{
+   load_spool();
+   while (!spillMsgs.empty()) {
+      uint16_t cnt = std::min<size_t>(spillMsgs.size(), batchSize);
+      uint8_t *data = spill + spillHead;
+      for (uint16_t i = 0; i < cnt; i++) {
+         spillPkts[i] = spillMsgs[i];
+         spillPkts[i].data = data;
+         data += spillPkts[i].length;
+      }
+
+      uint16_t sent = 0;
+      size_t offset = spillSent;
+      int ret = write_packets(spillPkts, cnt, &sent, &offset);
+      for (uint16_t i = 0; i < sent; i++) {
+         spillHead += spillMsgs.front().length;
+         spillMsgs.pop_front();
+      }
+      spillSent = offset;
 
-      /* Check that the data were sent correctly */
       if (ret == -1) {
-         switch (errno) {
-         case 0: break; /* OK */
-         case ECONNRESET:
-         case EINTR:
-         case ENOTCONN:
-         case ENOTSOCK:
-         case EPIPE:
-         case EHOSTUNREACH:
-         case ENETDOWN:
-         case ENETUNREACH:
-         case ENOBUFS:
-         case ENOMEM:
-
-            /* The connection is broken */
-            if (verbose) {
-               fprintf(stderr, "VERBOSE: Collector closed connection\n");
-            }
+         /* Packet was not accepted, drop it so that it does not block the rest */
+         drop_packets(&spillPkts[sent], 1);
+         spillHead += spillMsgs.front().length;
+         spillMsgs.pop_front();
+      } else if (ret == 1) {
+         break;
+      }
+      load_spool();
+   }
+
+   if (spillMsgs.empty()) {
+      spillHead = 0;
+      spillTail = 0;
+      spillSent = 0;
+      return !spool || spool->empty();
+   }
+   return false;
+}
 
-            /* free resources */
-            ::close(fd);
-            fd = -1;
-            freeaddrinfo(addrinfo);
-            addrinfo = nullptr;
+/**
+ * \brief Store packets at the end of spill buffer
+ *
+ * Packets that do not fit into spill buffer are stored to disk spool. Once the
+ * spool is in use, all packets go there until it is replayed.
+ *
+ * \param packets Packets to store
+ * \param cnt Number of packets
+ * \param offset Sent data size of the first packet
+ * \return Number of packets stored
+ */
+uint16_t IPFIXExporter::spill_packets(ipfix_packet_t *packets, uint16_t cnt, size_t offset)
+{
+   uint16_t i = 0;
 
-            /* Set last connection try time so that we would reconnect immediatelly */
-            lastReconnect = 1;
+   if (spillMsgs.empty()) {
+      spillHead = 0;
+      spillTail = 0;
+      spillSent = offset;
+   }
+   if (!spool || spool->empty()) {
+      while (i < cnt && spill_back(&packets[i])) {
+         i++;
+      }
+   }
+   if (spool) {
+      while (i < cnt && spool->push(packets[i].data, packets[i].length, packets[i].flows)) {
+         i++;
+      }
+   }
 
-            /* Reset the sequences number since it is unique per connection */
-            sequenceNum = 0;
-            ((ipfix_header_t *) packet->data)->sequenceNumber = 0; /* no need to change byteorder of 0 */
+   return i;
+}
 
-            /* Say that we should try to connect and send data again */
-            return 1;
-         default:
-            /* Unknown error */
+/**
+ * \brief Store packet at the end of spill buffer
+ *
+ * \param packet Packet to store
+ * \return True on success, false when the packet does not fit
+ */
+bool IPFIXExporter::spill_back(ipfix_packet_t *packet)
+{
+   if (spillTail + packet->length > spillSize && spillHead) {
+      /* Move stored packets to the beginning of the buffer */
+      memmove(spill, spill + spillHead, spillTail - spillHead);
+      spillTail -= spillHead;
+      spillHead = 0;
+   }
+   if (spillTail + packet->length > spillSize) {
+      return false;
+   }
+   memcpy(spill + spillTail, packet->data, packet->length);
+   spillTail += packet->length;
+   spillMsgs.push_back(*packet);
+   return true;
+}
+
+/**
+ * \brief Store packet at the beginning of spill buffer
+ *
+ * No part of the first stored packet can be sent already.
+ *
+ * \param packet Packet to store
+ * \return True on success, false when the packet does not fit
+ */
+bool IPFIXExporter::spill_front(ipfix_packet_t *packet)
+{
+   if (spillHead < packet->length) {
+      if (spillTail - spillHead + packet->length > spillSize) {
+         return false;
+      }
+      memmove(spill + packet->length, spill + spillHead, spillTail - spillHead);
+      spillTail = spillTail - spillHead + packet->length;
+      spillHead = packet->length;
+   }
+   spillHead -= packet->length;
+   memcpy(spill + spillHead, packet->data, packet->length);
+   spillMsgs.push_front(*packet);
+   return true;
+}
+
+/**
+ * \brief Move packets from disk spool to spill buffer
+ *
+ * Replay of spooled packets is limited by replay rate, so that the collector
+ * is not flooded after an outage.
+ */
+void IPFIXExporter::load_spool()
+{
+   uint8_t *data;
+   uint16_t length;
+   uint16_t flows;
+
+   if (!spool || spool->empty()) {
+      return;
+   }
+
+   if (replayRate) {
+      struct timespec now;
+      clock_gettime(CLOCK_MONOTONIC, &now);
+      /* Budget is refilled at most for one second, so the burst is limited too */
+      uint64_t elapsed = std::min<uint64_t>((now.tv_sec - replayTime.tv_sec) * 1000000000ULL + now.tv_nsec - replayTime.tv_nsec,
+            1000000000ULL);
+      uint64_t burst = std::max<uint64_t>(replayRate, mtu);
+      replayBudget = std::min<uint64_t>(replayBudget + elapsed * replayRate / 1000000000ULL, burst);
+      replayTime = now;
+   }
+
+   while (spool->front(&data, &length, &flows)) {
+      ipfix_packet_t pkt = {data, length, flows};
+      if (replayRate && length > replayBudget) {
+         break;
+      }
+      if (spillMsgs.empty()) {
+         spillHead = 0;
+         spillTail = 0;
+         spillSent = 0;
+      }
+      if (!spill_back(&pkt)) {
+         break;
+      }
+      spool->pop();
+      if (replayRate) {
+         replayBudget -= length;
+      }
+   }
+   m_flows_dropped += spool->take_lost();
+}
+
+/**
+ * \brief Drop all packets stored in spill buffer
+ */
+void IPFIXExporter::drop_spill()
+{
+   for (auto &it : spillMsgs) {
+      m_flows_dropped += it.flows;
+   }
+   if (verbose && !spillMsgs.empty()) {
+      fprintf(stderr, "VERBOSE: %zu spilled packets dropped\n", spillMsgs.size());
+   }
+   spillMsgs.clear();
+   spillHead = 0;
+   spillTail = 0;
+   spillSent = 0;
+}
+
+/**
+ * \brief Account flows of packets that could not be sent nor stored
+ *
+ * \param packets Dropped packets
+ * \param cnt Number of packets
+ */
+void IPFIXExporter::drop_packets(ipfix_packet_t *packets, uint16_t cnt)
+{
+   for (uint16_t i = 0; i < cnt; i++) {
+      m_flows_dropped += packets[i].flows;
+   }
+   if (verbose) {
+      fprintf(stderr, "VERBOSE: %" PRIu16 " packets dropped\n", cnt);
+   }
+}
+
+/**
+ * \brief Wait until packets stored in spill buffer are sent
+ *
+ * Packets not sent within IPFIX_DRAIN_TIMEOUT seconds are dropped, or kept
+ * in the spool for the next run when the spool is enabled.
+ */
+void IPFIXExporter::drain_spill()
+{
+   time_t end = time(nullptr) + IPFIX_DRAIN_TIMEOUT;
+
+   while ((!spillMsgs.empty() || (spool && !spool->empty())) && time(nullptr) < end) {
+      if (reconnect() == 0) {
+         if (flush_spill()) {
+            break;
+         }
+      } else if (!connecting) {
+         break;
+      }
+
+      /* Only sleep while spooled packets wait for replay budget */
+      struct pollfd pfd = {spillMsgs.empty() ? -1 : fd, POLLOUT, 0};
+      poll(&pfd, 1, 100);
+   }
+   if (!spool) {
+      drop_spill();
+      return;
+   }
+
+   if (!spillMsgs.empty() || !spool->empty()) {
+      /* Next run starts a new session, so the kept packets are preceded by all templates they may use */
+      ipfix_packet_t pkt;
+      expire_templates();
+      if (create_template_packet(&pkt)) {
+         spool->requeue(pkt.data, pkt.length, pkt.flows);
+         free(pkt.data);
+      }
+   }
+   uint8_t *data = spill + spillHead;
+   for (auto &it : spillMsgs) {
+      spool->requeue(data, it.length, it.flows);
+      data += it.length;
+   }
+   spillMsgs.clear();
+   spillHead = 0;
+   spillTail = 0;
+   spillSent = 0;
+   m_flows_dropped += spool->take_lost();
+}
+
+/**
+ * \brief Prepare datagrams of sendmmsg
+ *
+ * Consecutive packets of the same size are merged into one UDP GSO datagram,
+ * the last packet of such datagram may be shorter.
+ *
+ * \param packets Packets to send
+ * \param cnt Number of packets
+ * \return Number of datagrams
+ */
+uint16_t IPFIXExporter::prepare_datagrams(ipfix_packet_t *packets, uint16_t cnt)
+{
+   uint16_t datagrams = 0;
+   uint16_t i = 0;
+
+   while (i < cnt) {
+      uint16_t segs = 1;
+#ifdef UDP_SEGMENT
+      uint32_t size = packets[i].length;
+      while (gso && i + segs < cnt && segs < IPFIX_GSO_MAX_SEGS &&
+            packets[i + segs].length <= packets[i].length &&
+            size + packets[i + segs].length <= IPFIX_GSO_MAX_SIZE) {
+         size += packets[i + segs].length;
+         segs++;
+         if (packets[i + segs - 1].length != packets[i].length) {
+            break;
+         }
+      }
+#endif
+
+      struct msghdr *hdr = &msgs[datagrams].msg_hdr;
+      memset(hdr, 0, sizeof(*hdr));
+      hdr->msg_name = addrinfo->ai_addr;
+      hdr->msg_namelen = addrinfo->ai_addrlen;
+      hdr->msg_iov = &iov[i];
+      hdr->msg_iovlen = segs;
+      for (uint16_t j = i; j < i + segs; j++) {
+         iov[j].iov_base = packets[j].data;
+         iov[j].iov_len = packets[j].length;
+      }
+#ifdef UDP_SEGMENT
+      if (segs > 1) {
+         hdr->msg_control = cmsgBuffer + datagrams * CMSG_SPACE(sizeof(uint16_t));
+         hdr->msg_controllen = CMSG_SPACE(sizeof(uint16_t));
+         struct cmsghdr *cmsg = CMSG_FIRSTHDR(hdr);
+         cmsg->cmsg_level = SOL_UDP;
+         cmsg->cmsg_type = UDP_SEGMENT;
+         cmsg->cmsg_len = CMSG_LEN(sizeof(uint16_t));
+         *((uint16_t *) CMSG_DATA(cmsg)) = packets[i].length;
+      }
+#endif
+      msgPackets[datagrams] = segs;
+      datagrams++;
+      i += segs;
+   }
+
+   return datagrams;
+}
+
+/**
+ * \brief Send packets as UDP datagrams with sendmmsg
+ *
+ * \param packets Packets to send
+ * \param cnt Number of packets
+ * \param sent Number of packets sent successfully
+ * \return 0 on success, errno on error
+ */
+int IPFIXExporter::send_datagrams(ipfix_packet_t *packets, uint16_t cnt, uint16_t *sent)
+{
+   uint16_t datagrams = prepare_datagrams(packets, cnt);
+   uint16_t done = 0;
+
+   while (done < datagrams) {
+      int ret = sendmmsg(fd, msgs + done, datagrams - done, 0);
+      if (ret == -1) {
+         if (gso && (errno == EIO || errno == EINVAL) && msgPackets[done] > 1) {
+            /* Segmentation offload is not supported by the kernel or the device */
             if (verbose) {
-               perror("VERBOSE: Cannot send data to collector");
+               fprintf(stderr, "VERBOSE: UDP segmentation offload not available\n");
             }
-            return -1;
+            gso = false;
+            datagrams = prepare_datagrams(packets + *sent, cnt - *sent);
+            done = 0;
+            continue;
          }
+         return errno;
       }
-
-      /* No error from sendto(), add sent data count to total */
-      sent += ret;
+      for (int i = 0; i < ret; i++) {
+         *sent += msgPackets[done + i];
+      }
+      done += ret;
    }
 
-   /* Update sequence number for next packet */
-   sequenceNum += packet->flows;
+   return 0;
+}
+
+/**
+ * \brief Send packets over stream connection with writev
+ *
+ * \param packets Packets to send
+ * \param cnt Number of packets
+ * \param sent Number of packets sent successfully
+ * \param offset Sent data size of the first packet, updated on return
+ * \return 0 on success, errno on error
+ */
+int IPFIXExporter::send_stream(ipfix_packet_t *packets, uint16_t cnt, uint16_t *sent, size_t *offset)
+{
+   /* writev() does not guarantee that everything will be send in one piece */
+   while (*sent < cnt) {
+      int iovcnt = 0;
+      for (uint16_t i = *sent; i < cnt; i++) {
+         size_t skip = i == *sent ? *offset : 0;
+         iov[iovcnt].iov_base = packets[i].data + skip;
+         iov[iovcnt].iov_len = packets[i].length - skip;
+         iovcnt++;
+      }
 
-   /* Increase packet counter */
-   exportedPackets++;
+      ssize_t ret = writev(fd, iov, iovcnt);
+      if (ret == -1) {
+         return errno;
+      }
 
-   if (verbose) {
-      fprintf(stderr, "VERBOSE: Packet (%" PRIu64 ") sent to %s on port %" PRIu16 ". Next sequence number is %i\n",
-            exportedPackets, host.c_str(), port, sequenceNum);
+      size_t len = ret;
+      while (len) {
+         size_t rest = packets[*sent].length - *offset;
+         if (len < rest) {
+            *offset += len;
+            break;
+         }
+         len -= rest;
+         *offset = 0;
+         (*sent)++;
+      }
    }
 
    return 0;
 }
 
+/**
+ * \brief Handle error of sending data to collector
+ *
+ * \param err Error number
+ * \return -1 on socket error, 1 when data needs to be sent again (after reconnect)
+ */
+int IPFIXExporter::send_error(int err)
+{
+   switch (err) {
+   case ECONNRESET:
+   case EINTR:
+   case ENOTCONN:
+   case ENOTSOCK:
+   case EPIPE:
+   case EHOSTUNREACH:
+   case ENETDOWN:
+   case ENETUNREACH:
+   case ENOBUFS:
+   case ENOMEM:
+
+      /* The connection is broken */
+      if (verbose) {
+         fprintf(stderr, "VERBOSE: Collector closed connection\n");
+      }
+
+      /* free resources */
+      ::close(fd);
+      fd = -1;
+      freeaddrinfo(addrinfo);
+      addrinfo = nullptr;
+
+      /* Set last connection try time so that we would reconnect immediatelly */
+      lastReconnect = 1;
+      connecting = false;
+      resendTemplates = true;
+
+      /* Reset the sequences number since it is unique per connection */
+      sequenceNum = 0;
+
+      /* Say that we should try to connect and send data again */
+      return 1;
+   default:
+      /* Unknown error */
+      if (verbose) {
+         fprintf(stderr, "VERBOSE: Cannot send data to collector: %s\n", strerror(err));
+      }
+      return -1;
+   }
+}
+
 /**
  * \brief Create connection to collector
  *
@@ -952,9 +1612,24 @@ int IPFIXExporter::connect_to_collector()
          continue;
       }
 
+      /* Collector must never block the exporting thread */
+      if (fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK) == -1) {
+         if (verbose) {
+            perror("VERBOSE: Cannot set socket to non-blocking mode");
+         }
+         ::close(fd);
+         fd = -1;
+         continue;
+      }
+
       /* connect to server with TCP and SCTP */
       if (protocol != IPPROTO_UDP &&
             connect(fd, tmp->ai_addr, tmp->ai_addrlen) == -1) {
+         if (errno == EINPROGRESS) {
+            /* Connection is checked by reconnect() */
+            connecting = true;
+            break;
+         }
          if (verbose) {
             perror("VERBOSE: Cannot connect to collector");
          }
@@ -963,12 +1638,7 @@ int IPFIXExporter::connect_to_collector()
          continue;
       }
 
-      /* Connected, meaningless for UDP */
-      if (protocol != IPPROTO_UDP) {
-         if (verbose) {
-            fprintf(stderr, "VERBOSE: Successfully connected to collector\n");
-         }
-      }
+      connected();
       break;
    }
 
@@ -986,6 +1656,9 @@ int IPFIXExporter::connect_to_collector()
 /**
  * \brief Checks that connection is OK or tries to reconnect
  *
+ * Connection to the collector is established without blocking, the connection
+ * in progress is reported as not OK.
+ *
  * @return 0 when connection is OK or reestablished, 1 when not
  */
 int IPFIXExporter::reconnect()
@@ -997,23 +1670,78 @@ int IPFIXExporter::reconnect()
          /* Try to reconnect */
          if (connect_to_collector() == 0) {
             lastReconnect = 0;
-            /* Resend all templates */
-            expire_templates();
-            send_templates();
          } else {
-            /* Set new reconnect time and drop packet */
+            /* Set new reconnect time and keep packets */
             lastReconnect = time(nullptr);
             return 1;
          }
       } else {
-         /* Timeout not reached, drop packet */
+         /* Timeout not reached, keep packets */
          return 1;
       }
    }
 
+   if (connecting) {
+      /* Check whether the connection in progress was established */
+      struct pollfd pfd = {fd, POLLOUT, 0};
+      if (poll(&pfd, 1, 0) == 0) {
+         return 1;
+      }
+
+      int err = 0;
+      socklen_t len = sizeof(err);
+      if (getsockopt(fd, SOL_SOCKET, SO_ERROR, &err, &len) == -1) {
+         err = errno;
+      }
+      if (err) {
+         if (verbose) {
+            fprintf(stderr, "VERBOSE: Cannot connect to collector: %s\n", strerror(err));
+         }
+         ::close(fd);
+         fd = -1;
+         freeaddrinfo(addrinfo);
+         addrinfo = nullptr;
+         connecting = false;
+         lastReconnect = time(nullptr);
+         return 1;
+      }
+      connecting = false;
+      connected();
+   }
+
    return 0;
 }
 
+/**
+ * \brief Prepare the established connection for sending data
+ *
+ * After reconnection, all templates are sent again before packets waiting in
+ * spill buffer.
+ */
+void IPFIXExporter::connected()
+{
+   ipfix_packet_t pkt;
+
+   if (verbose && protocol != IPPROTO_UDP) {
+      fprintf(stderr, "VERBOSE: Successfully connected to collector\n");
+   }
+   if (!resendTemplates) {
+      return;
+   }
+   resendTemplates = false;
+
+   /* Resend all templates */
+   expire_templates();
+   if (create_template_packet(&pkt)) {
+      if (!spill_front(&pkt)) {
+         /* Spilled packets must not precede templates they use */
+         drop_spill();
+         spill_front(&pkt);
+      }
+      free(pkt.data);
+   }
+}
+
 #define GEN_FIELDS_SUMLEN_INT(FIELD) FIELD_LEN(FIELD) +
 #define GEN_FILLFIELDS_INT(TMPLT) IPFIX_FILL_FIELD(p, TMPLT);
 #define GEN_FILLFIELDS_MAXLEN(TMPLT) IPFIX_FILL_FIELD(p, TMPLT);
@@ -39,7 +39,10 @@
 #define IPXP_OUTPUT_IPFIX_H
 
 #include <vector>
-#include <map>
+#include <deque>
+#include <ctime>
+#include <sys/socket.h>
+#include <sys/uio.h>
 
 #include <ipfixprobe/output.hpp>
 #include <ipfixprobe/process.hpp>
@@ -48,6 +51,9 @@
 #include <ipfixprobe/flowifc.hpp>
 #include <ipfixprobe/ipfix-elements.hpp>
 
+#include "ipfix-spool.hpp"
+#include "ipfix-file.hpp"
+
 #define COUNT_IPFIX_TEMPLATES(T) + 1
 
 #define TEMPLATE_SET_ID 2
@@ -63,6 +69,16 @@
 #define RECONNECT_TIMEOUT 60
 #define TEMPLATE_REFRESH_TIME 600
 #define TEMPLATE_REFRESH_PACKETS 0
+#define TEMPLATE_TABLE_SIZE 16 /**< Initial number of slots of template table, power of two */
+#define TEMPLATE_MAX_EXTS 64 /**< Maximal number of extensions in one template */
+#define IPFIX_BATCH_MSGS 32 /**< Default number of IPFIX messages sent by one system call */
+#define IPFIX_BATCH_MAX 1024 /**< Maximal number of IPFIX messages sent by one system call, IOV_MAX */
+#define IPFIX_GSO_MAX_SEGS 64 /**< Maximal number of UDP segments in one GSO datagram */
+#define IPFIX_GSO_MAX_SIZE 65507 /**< Maximal size of UDP payload of one GSO datagram */
+#define IPFIX_SPILL_SIZE (16 * 1024 * 1024) /**< Default size of buffer for packets not accepted by the socket */
+#define IPFIX_DRAIN_TIMEOUT 10 /**< Time in seconds to send spilled packets when the plugin is closed */
+#define IPFIX_SPOOL_LIMIT (1024ULL * 1024 * 1024) /**< Default maximal size of disk spool */
+#define IPFIX_REPLAY_RATE (10 * 1000 * 1000) /**< Default replay rate of spooled packets in bytes per second */
 
 namespace ipxp {
 
@@ -76,11 +92,21 @@ public:
    uint64_t m_id;
    uint32_t m_dir;
    uint32_t m_template_refresh_time;
+   uint16_t m_batch;
+   uint64_t m_spill;
+   std::string m_spool;
+   uint64_t m_spool_limit;
+   uint64_t m_replay;
+   std::string m_file;
+   uint32_t m_rotate;
+   uint64_t m_rotate_size;
+   bool m_direct;
+   bool m_worker_odid;
    bool m_verbose;
 
    IpfixOptParser() : OptionsParser("ipfix", "Output plugin for ipfix export"),
       m_host("127.0.0.1"), m_port(4739), m_mtu(DEFAULT_MTU), m_udp(false), m_id(DEFAULT_EXPORTER_ID), m_dir(0), 
-      m_template_refresh_time(TEMPLATE_REFRESH_TIME), m_verbose(false)
+      m_template_refresh_time(TEMPLATE_REFRESH_TIME), m_batch(IPFIX_BATCH_MSGS), m_spill(IPFIX_SPILL_SIZE), m_spool(""), m_spool_limit(IPFIX_SPOOL_LIMIT), m_replay(IPFIX_REPLAY_RATE), m_file(""), m_rotate(0), m_rotate_size(0), m_direct(false), m_worker_odid(false), m_verbose(false)
    {
       register_option("h", "host", "ADDR", "Remote collector address", [this](const char *arg){m_host = arg; return true;}, OptionFlags::RequiredArgument);
       register_option("p", "port", "PORT", "Remote collector port",
@@ -99,6 +125,32 @@ public:
       register_option("t", "template", "NUM", "Template refresh rate (sec)",
          [this](const char *arg){try {m_template_refresh_time = str2num<decltype(m_template_refresh_time)>(arg);} 
          catch(std::invalid_argument &e) {return false;} return true;}, OptionFlags::RequiredArgument);
+      register_option("b", "batch", "NUM", "Number of IPFIX messages sent at once",
+         [this](const char *arg){try {m_batch = str2num<decltype(m_batch)>(arg);} catch(std::invalid_argument &e) {return false;}
+         return m_batch > 0 && m_batch <= IPFIX_BATCH_MAX;}, OptionFlags::RequiredArgument);
+      register_option("s", "spill", "SIZE", "Size of buffer for messages waiting for slow or unavailable collector in bytes",
+         [this](const char *arg){try {m_spill = str2num<decltype(m_spill)>(arg);} catch(std::invalid_argument &e) {return false;} return true;},
+         OptionFlags::RequiredArgument);
+      register_option("S", "spool", "DIR", "Store messages that do not fit into spill buffer to files in directory, messages left there are replayed by the next run",
+         [this](const char *arg){m_spool = arg; return true;}, OptionFlags::RequiredArgument);
+      register_option("L", "spool-limit", "SIZE", "Maximal size of spooled messages in bytes",
+         [this](const char *arg){try {m_spool_limit = str2num<decltype(m_spool_limit)>(arg);} catch(std::invalid_argument &e) {return false;} return true;},
+         OptionFlags::RequiredArgument);
+      register_option("r", "replay", "RATE", "Replay rate of spooled messages in bytes per second, 0 for unlimited",
+         [this](const char *arg){try {m_replay = str2num<decltype(m_replay)>(arg);} catch(std::invalid_argument &e) {return false;} return true;},
+         OptionFlags::RequiredArgument);
+      register_option("f", "file", "PATH", "Write IPFIX file instead of sending to collector, PATH is strftime pattern",
+         [this](const char *arg){m_file = arg; return !m_file.empty();}, OptionFlags::RequiredArgument);
+      register_option("R", "rotate", "SEC", "Start new file every SEC seconds",
+         [this](const char *arg){try {m_rotate = str2num<decltype(m_rotate)>(arg);} catch(std::invalid_argument &e) {return false;} return true;},
+         OptionFlags::RequiredArgument);
+      register_option("Z", "rotate-size", "SIZE", "Start new file when the file reaches SIZE bytes",
+         [this](const char *arg){try {m_rotate_size = str2num<decltype(m_rotate_size)>(arg);} catch(std::invalid_argument &e) {return false;} return true;},
+         OptionFlags::RequiredArgument);
+      register_option("D", "direct", "", "Write file with direct I/O bypassing page cache",
+         [this](const char *arg){m_direct = true; return true;}, OptionFlags::NoArgument);
+      register_option("W", "worker-odid", "", "Add index of output worker to exporter identification",
+         [this](const char *arg){m_worker_odid = true; return true;}, OptionFlags::NoArgument);
       register_option("v", "verbose", "", "Enable verbose mode", [this](const char *arg){m_verbose = true; return true;}, OptionFlags::NoArgument);
    }
 };
@@ -124,6 +176,9 @@ typedef struct template_t {
 	uint8_t exported; /**< 1 indicates that the template was exported to collector*/
 	time_t exportTime; /**< Time when the template was last exported */
 	uint64_t exportPacket; /**< Number of packet when the template was last exported */
+	uint16_t recordSize; /**< Size of data record, 0 when the template has variable length fields */
+	uint8_t extCnt; /**< Number of extensions filled into data record */
+	uint8_t extIds[TEMPLATE_MAX_EXTS]; /**< IDs of extensions in order of their fields in template */
 	struct template_t *next;
 } template_t;
 
@@ -248,12 +303,16 @@ private:
       TMPLT_IDX_V6 = 1,
       TMPLT_MAP_IDX_CNT
    };
-   RecordExt **extensions;
+   struct TmpltSlot {
+      uint64_t mask; /**< Extensions of flows exported with the templates, bit per extension ID */
+      template_t *tmplt[TMPLT_MAP_IDX_CNT]; /**< Templates for each IP version, nullptr in unused slot */
+   };
+   RecordExt **extensions; /**< Extensions of exported flow indexed by extension ID */
    int extension_cnt;
-   std::map<uint64_t, template_t *> tmpltMap[TMPLT_MAP_IDX_CNT];
+   std::vector<TmpltSlot> tmpltTable; /**< Open addressing hash table of templates */
+   uint32_t tmpltTableCnt; /**< Number of used slots of template table */
    template_t *templates; /**< Templates in use by plugin */
 	uint16_t templatesDataSize; /**< Total data size stored in templates */
-   int basic_ifc_num;
    bool verbose;
 
    uint32_t sequenceNum; /**< Number of exported flows */
@@ -276,9 +335,35 @@ private:
    uint32_t dir_bit_field;     /**< Direction bit field value. */
 
    uint16_t mtu; /**< Max size of packet payload sent */
-   uint8_t *packetDataBuffer; /**< Data buffer to store packet */
+   uint8_t *packetDataBuffer; /**< Data buffer to store batch of packets, mtu bytes per packet */
    uint16_t tmpltMaxBufferSize; /**< Size of template buffer, tmpltBufferSize < packetDataBuffer */
 
+   /* Batching */
+   uint16_t batchSize; /**< Maximal number of packets sent at once */
+   uint16_t batchCnt; /**< Number of packets waiting in batch */
+   ipfix_packet_t *batch; /**< Packets waiting to be sent */
+   struct iovec *iov; /**< IO vectors of packets being sent */
+   struct mmsghdr *msgs; /**< Datagrams of sendmmsg, each of them carries one or more packets */
+   uint16_t *msgPackets; /**< Number of packets in each datagram of msgs */
+   uint8_t *cmsgBuffer; /**< Ancillary data with UDP segment size of datagrams */
+   bool gso; /**< Send equally sized packets as one UDP GSO datagram */
+
+   /* Spill buffer */
+   uint8_t *spill; /**< Packets not accepted by the socket yet, stored one after another */
+   size_t spillSize; /**< Size of spill buffer */
+   size_t spillHead; /**< Offset of the first stored packet */
+   size_t spillTail; /**< Offset of the end of the last stored packet */
+   size_t spillSent; /**< Sent data size of the first stored packet */
+   std::deque<ipfix_packet_t> spillMsgs; /**< Lengths and flow counts of stored packets */
+   ipfix_packet_t *spillPkts; /**< Stored packets being sent */
+   IpfixSpool *spool; /**< Packets that do not fit into spill buffer, nullptr when disabled */
+   uint64_t replayRate; /**< Maximal rate of packets moved from spool to spill buffer in bytes per second */
+   uint64_t replayBudget; /**< Size of packets that can be moved from spool now */
+   struct timespec replayTime; /**< Time of last replay budget update */
+   IpfixFile *file; /**< File the packets are written to instead of collector, nullptr when disabled */
+   bool connecting; /**< Connection to collector is in progress */
+   bool resendTemplates; /**< Templates must be sent again when connection is established */
+
    void init_template_buffer(template_t *tmpl);
    int fill_template_set_header(uint8_t *ptr, uint16_t size);
    void check_template_lifetime(template_t *tmpl);
@@ -289,15 +374,33 @@ private:
    uint16_t create_template_packet(ipfix_packet_t *packet);
    uint16_t create_data_packet(ipfix_packet_t *packet);
    void send_templates();
-   void send_data();
-   int send_packet(ipfix_packet_t *packet);
+   void send_data(bool all);
+   void send_batch();
+   void send_packets(ipfix_packet_t *packets, uint16_t cnt);
+   int write_packets(ipfix_packet_t *packets, uint16_t cnt, uint16_t *sent, size_t *offset);
+   bool flush_spill();
+   uint16_t spill_packets(ipfix_packet_t *packets, uint16_t cnt, size_t offset);
+   bool spill_back(ipfix_packet_t *packet);
+   bool spill_front(ipfix_packet_t *packet);
+   void load_spool();
+   void drop_spill();
+   void drop_packets(ipfix_packet_t *packets, uint16_t cnt);
+   void drain_spill();
+   void write_file(ipfix_packet_t *packets, uint16_t cnt);
+   void rotate_file(time_t now);
+   uint16_t prepare_datagrams(ipfix_packet_t *packets, uint16_t cnt);
+   int send_datagrams(ipfix_packet_t *packets, uint16_t cnt, uint16_t *sent);
+   int send_stream(ipfix_packet_t *packets, uint16_t cnt, uint16_t *sent, size_t *offset);
+   int send_error(int err);
    int connect_to_collector();
    int reconnect();
+   void connected();
    int fill_basic_flow(const Flow &flow, template_t *tmplt);
-   int fill_extensions(RecordExt *ext, uint8_t *buffer, int size);
+   int fill_extensions(template_t *tmplt, uint8_t *buffer, int size);
 
-   uint64_t get_template_id(const Record &flow);
-   template_t *get_template(const Flow &flow);
+   TmpltSlot *find_template_slot(uint64_t mask);
+   void grow_template_table();
+   template_t *get_template(const Flow &flow, uint64_t mask);
    bool fill_template(const Flow &flow, template_t *tmplt);
    void flush();
    void shutdown();
@@ -29,10 +29,14 @@
 #include <config.h>
 
 #include <string>
-#include <ostream>
-#include <fstream>
-#include <iomanip>
-#include <iostream>
+#include <mutex>
+#include <algorithm>
+#include <cerrno>
+#include <unistd.h>
+#include <fcntl.h>
+#include <arpa/inet.h>
+
+#include <ipfixprobe/text-format.hpp>
 
 #include "text.hpp"
 
@@ -44,8 +48,15 @@ __attribute__((constructor)) static void register_this_plugin()
    register_plugin(&rec);
 }
 
-TextExporter::TextExporter() : m_out(&std::cout), m_hide_mac(false)
+/**
+ * \brief Output workers sharing stdout write whole buffers one after another.
+ */
+static std::mutex stdout_mutex;
+
+TextExporter::TextExporter() : m_fd(STDOUT_FILENO), m_buf_flows(0), m_hide_mac(false), m_json(false)
 {
+   m_time[0].sec = -1;
+   m_time[1].sec = -1;
 }
 
 TextExporter::~TextExporter()
@@ -63,30 +74,51 @@ void TextExporter::init(const char *params)
    }
 
    if (parser.m_to_file) {
-      std::ofstream *file = new std::ofstream(parser.m_file, std::ofstream::out);
-      if (file->fail()) {
+      std::string path = worker_path(parser.m_file);
+      m_fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+      if (m_fd == -1) {
+         m_fd = STDOUT_FILENO;
          throw PluginError("failed to open output file");
       }
-      m_out = file;
    }
    m_hide_mac = parser.m_hide_mac;
+   m_json = parser.m_json;
+   m_buf.reserve(TEXT_FLUSH_SIZE + 4096);
 
+   if (m_json || (m_fd == STDOUT_FILENO && m_worker_id)) {
+      // Header is printed by the first output worker
+      return;
+   }
    if (!m_hide_mac) {
-      *m_out << "mac ";
+      m_buf += "mac ";
    }
-   *m_out << "conversation packets bytes tcp-flags time extensions" << std::endl;
+   m_buf += "conversation packets bytes tcp-flags time extensions\n";
+   write_buffer();
 }
 
 void TextExporter::init(const char *params, Plugins &plugins)
 {
    init(params);
+
+   m_ext_names.resize(get_extension_cnt());
+   for (auto &it : plugins) {
+      RecordExt *ext = it.second->get_ext();
+      if (ext == nullptr) {
+         continue;
+      }
+      if (ext->m_ext_id >= 0 && static_cast<size_t>(ext->m_ext_id) < m_ext_names.size()) {
+         m_ext_names[ext->m_ext_id] = it.first;
+      }
+      delete ext;
+   }
 }
 
 void TextExporter::close()
 {
-   if (m_out != &std::cout) {
-      delete m_out;
-      m_out = &std::cout;
+   write_buffer();
+   if (m_fd != STDOUT_FILENO) {
+      ::close(m_fd);
+      m_fd = STDOUT_FILENO;
    }
 }
 
@@ -95,69 +127,192 @@ int TextExporter::export_flow(const Flow &flow)
    RecordExt *ext = flow.m_exts;
 
    m_flows_seen++;
-   print_basic_flow(flow);
-   while (ext != nullptr) {
-      *m_out << " " << ext->get_text();
-      ext = ext->m_next;
+   if (m_json) {
+      print_json_flow(flow);
+   } else {
+      print_basic_flow(flow);
+      while (ext != nullptr) {
+         m_buf += ' ';
+         ext->append_text(m_buf);
+         ext = ext->m_next;
+      }
+      m_buf += '\n';
+   }
+
+   m_buf_flows++;
+   if (m_buf.size() >= TEXT_FLUSH_SIZE) {
+      write_buffer();
    }
-   *m_out << std::endl;
 
    return 0;
 }
 
-void TextExporter::print_basic_flow(const Flow &flow)
+void TextExporter::flush()
+{
+   write_buffer();
+}
+
+/**
+ * \brief Write formatted lines to output
+ */
+void TextExporter::write_buffer()
 {
-   time_t sec;
-   char time_begin[100];
-   char time_end[100];
-   char src_mac[18];
-   char dst_mac[18];
-   char tmp[50];
-   char src_ip[INET6_ADDRSTRLEN];
-   char dst_ip[INET6_ADDRSTRLEN];
-   std::string lb = "";
-   std::string rb = "";
-
-   sec = flow.time_first.tv_sec;
-   strftime(tmp, sizeof(tmp), "%FT%T", localtime(&sec));
-   snprintf(time_begin, sizeof(time_begin), "%s.%06ld", tmp, flow.time_first.tv_usec);
-   sec = flow.time_last.tv_sec;
-   strftime(tmp, sizeof(tmp), "%FT%T", localtime(&sec));
-   snprintf(time_end, sizeof(time_end), "%s.%06ld", tmp, flow.time_last.tv_usec);
-
-   const uint8_t *p = const_cast<uint8_t *>(flow.src_mac);
-   snprintf(src_mac, sizeof(src_mac), "%02x:%02x:%02x:%02x:%02x:%02x", p[0], p[1], p[2], p[3], p[4], p[5]);
-   p = const_cast<uint8_t *>(flow.dst_mac);
-   snprintf(dst_mac, sizeof(dst_mac), "%02x:%02x:%02x:%02x:%02x:%02x", p[0], p[1], p[2], p[3], p[4], p[5]);
+   size_t done = 0;
+
+   if (m_buf.empty()) {
+      return;
+   }
+
+   // Lines of output workers sharing stdout do not interleave
+   std::unique_lock<std::mutex> lock(stdout_mutex, std::defer_lock);
+   if (m_fd == STDOUT_FILENO) {
+      lock.lock();
+   }
+   while (done < m_buf.size()) {
+      ssize_t ret = write(m_fd, m_buf.data() + done, m_buf.size() - done);
+      if (ret == -1) {
+         if (errno == EINTR) {
+            continue;
+         }
+         m_flows_dropped += m_buf_flows;
+         break;
+      }
+      done += ret;
+   }
+
+   m_buf.clear();
+   m_buf_flows = 0;
+}
+
+void TextExporter::append_ip(const Flow &flow, const ipaddr_t &addr)
+{
+   char buf[INET6_ADDRSTRLEN];
 
    if (flow.ip_version == IP::v4) {
-      inet_ntop(AF_INET, (const void *) &flow.src_ip.v4, src_ip, INET6_ADDRSTRLEN);
-      inet_ntop(AF_INET, (const void *) &flow.dst_ip.v4, dst_ip, INET6_ADDRSTRLEN);
+      append_ipv4(m_buf, addr.v4);
    } else if (flow.ip_version == IP::v6) {
-      inet_ntop(AF_INET6, (const void *) &flow.src_ip.v6, src_ip, INET6_ADDRSTRLEN);
-      inet_ntop(AF_INET6, (const void *) &flow.dst_ip.v6, dst_ip, INET6_ADDRSTRLEN);
-      lb = "[";
-      rb = "]";
+      inet_ntop(AF_INET6, (const void *) &addr.v6, buf, INET6_ADDRSTRLEN);
+      m_buf += buf;
+   }
+}
+
+/**
+ * \brief Append time in %FT%T.usec format, formatting of the second is cached
+ */
+void TextExporter::append_time(timestamp_t ts, TimeCache &cache)
+{
+   time_t sec = ts_sec(ts);
+   if (sec != cache.sec) {
+      struct tm tm;
+      strftime(cache.str, sizeof(cache.str), "%FT%T", localtime_r(&sec, &tm));
+      cache.sec = sec;
    }
+   m_buf += cache.str;
+   m_buf += '.';
+   append_uint_padded(m_buf, ts_usec(ts), 6);
+}
+
+void TextExporter::print_basic_flow(const Flow &flow)
+{
+   const char *lb = flow.ip_version == IP::v6 ? "[" : "";
+   const char *rb = flow.ip_version == IP::v6 ? "]" : "";
 
    if (!m_hide_mac) {
-      *m_out << src_mac << "->" << dst_mac << " ";
-   }
-   *m_out <<
-      std::setw(2) << static_cast<unsigned>(flow.ip_proto) <<
-      "@" <<
-      lb << src_ip << rb << ":" << flow.src_port <<
-      "->" <<
-      lb << dst_ip << rb << ":" << flow.dst_port <<
-      " " <<
-      flow.src_packets << "->" << flow.dst_packets <<
-      " " <<
-      flow.src_bytes << "->" << flow.dst_bytes <<
-      " " <<
-      static_cast<unsigned>(flow.src_tcp_flags) << "->" << static_cast<unsigned>(flow.dst_tcp_flags) <<
-      " " <<
-      time_begin << "->" << time_end;
+      append_mac(m_buf, flow.src_mac);
+      m_buf += "->";
+      append_mac(m_buf, flow.dst_mac);
+      m_buf += ' ';
+   }
+   if (flow.ip_proto < 10) {
+      m_buf += ' ';
+   }
+   append_uint(m_buf, flow.ip_proto);
+   m_buf += '@';
+   m_buf += lb;
+   append_ip(flow, flow.src_ip);
+   m_buf += rb;
+   m_buf += ':';
+   append_uint(m_buf, flow.src_port);
+   m_buf += "->";
+   m_buf += lb;
+   append_ip(flow, flow.dst_ip);
+   m_buf += rb;
+   m_buf += ':';
+   append_uint(m_buf, flow.dst_port);
+   m_buf += ' ';
+   append_uint(m_buf, flow.src_packets);
+   m_buf += "->";
+   append_uint(m_buf, flow.dst_packets);
+   m_buf += ' ';
+   append_uint(m_buf, flow.src_bytes);
+   m_buf += "->";
+   append_uint(m_buf, flow.dst_bytes);
+   m_buf += ' ';
+   append_uint(m_buf, flow.src_tcp_flags);
+   m_buf += "->";
+   append_uint(m_buf, flow.dst_tcp_flags);
+   m_buf += ' ';
+   append_time(flow.time_first, m_time[0]);
+   m_buf += "->";
+   append_time(flow.time_last, m_time[1]);
+}
 
+void TextExporter::print_json_flow(const Flow &flow)
+{
+   m_buf += '{';
+   if (!m_hide_mac) {
+      m_buf += "\"src_mac\":\"";
+      append_mac(m_buf, flow.src_mac);
+      m_buf += "\",\"dst_mac\":\"";
+      append_mac(m_buf, flow.dst_mac);
+      m_buf += "\",";
+   }
+   m_buf += "\"proto\":";
+   append_uint(m_buf, flow.ip_proto);
+   m_buf += ",\"src_ip\":\"";
+   append_ip(flow, flow.src_ip);
+   m_buf += "\",\"dst_ip\":\"";
+   append_ip(flow, flow.dst_ip);
+   m_buf += "\",\"src_port\":";
+   append_uint(m_buf, flow.src_port);
+   m_buf += ",\"dst_port\":";
+   append_uint(m_buf, flow.dst_port);
+   m_buf += ",\"packets\":";
+   append_uint(m_buf, flow.src_packets);
+   m_buf += ",\"packets_rev\":";
+   append_uint(m_buf, flow.dst_packets);
+   m_buf += ",\"bytes\":";
+   append_uint(m_buf, flow.src_bytes);
+   m_buf += ",\"bytes_rev\":";
+   append_uint(m_buf, flow.dst_bytes);
+   m_buf += ",\"tcp_flags\":";
+   append_uint(m_buf, flow.src_tcp_flags);
+   m_buf += ",\"tcp_flags_rev\":";
+   append_uint(m_buf, flow.dst_tcp_flags);
+   m_buf += ",\"time_first\":\"";
+   append_time(flow.time_first, m_time[0]);
+   m_buf += "\",\"time_last\":\"";
+   append_time(flow.time_last, m_time[1]);
+   m_buf += '"';
+
+   // Extension text is formatted in place and escaped afterwards
+   for (RecordExt *ext = flow.m_exts; ext != nullptr; ext = ext->m_next) {
+      const std::string &name = static_cast<size_t>(ext->m_ext_id) < m_ext_names.size() ?
+         m_ext_names[ext->m_ext_id] : "";
+      m_buf += ",\"";
+      m_buf += name.empty() ? "ext" + std::to_string(ext->m_ext_id) : name;
+      m_buf += "\":\"";
+      size_t start = m_buf.size();
+      ext->append_text(m_buf);
+      if (m_buf.find_first_of("\"\\", start) != std::string::npos ||
+            std::find_if(m_buf.begin() + start, m_buf.end(), [](char c){return (unsigned char) c < 0x20;}) != m_buf.end()) {
+         std::string text = m_buf.substr(start);
+         m_buf.resize(start);
+         append_json_escaped(m_buf, text.data(), text.size());
+      }
+      m_buf += '"';
+   }
+   m_buf += "}\n";
 }
 
 }
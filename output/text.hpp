@@ -32,6 +32,8 @@
 #include <config.h>
 
 #include <string>
+#include <vector>
+#include <ctime>
 
 #include <ipfixprobe/output.hpp>
 #include <ipfixprobe/process.hpp>
@@ -41,20 +43,25 @@
 
 namespace ipxp {
 
+#define TEXT_FLUSH_SIZE (256 * 1024) /**< Size of formatted output written at once */
+
 class TextOptParser : public OptionsParser
 {
 public:
    std::string m_file;
    bool m_to_file;
    bool m_hide_mac;
+   bool m_json;
 
    TextOptParser() : OptionsParser("text", "Output plugin for text export"),
-      m_file(""), m_to_file(false), m_hide_mac(false)
+      m_file(""), m_to_file(false), m_hide_mac(false), m_json(false)
    {
-      register_option("f", "file", "PATH", "Print output to file",
+      register_option("f", "file", "PATH", "Print output to file, output worker N other than the first one inserts -wN before extension of PATH",
          [this](const char *arg){m_file = arg; m_to_file = true; return true;}, OptionFlags::RequiredArgument);
       register_option("m", "mac", "", "Hide mac addresses",
          [this](const char *arg){m_hide_mac = true; return true;}, OptionFlags::NoArgument);
+      register_option("j", "json", "", "Print flows as JSON lines",
+         [this](const char *arg){m_json = true; return true;}, OptionFlags::NoArgument);
    }
 };
 
@@ -69,12 +76,27 @@ public:
    OptionsParser *get_parser() const { return new TextOptParser(); }
    std::string get_name() const { return "text"; }
    int export_flow(const Flow &flow);
+   void flush();
 
 private:
-   std::ostream *m_out;
+   struct TimeCache {
+      time_t sec; /**< Second formatted in str */
+      char str[32]; /**< Second formatted as %FT%T */
+   };
+
+   int m_fd;
+   std::string m_buf; /**< Formatted lines waiting to be written */
+   uint64_t m_buf_flows; /**< Number of flows in m_buf */
    bool m_hide_mac;
+   bool m_json;
+   std::vector<std::string> m_ext_names; /**< Names of process plugins indexed by extension ID */
+   TimeCache m_time[2]; /**< Last formatted flow start and end time */
 
    void print_basic_flow(const Flow &flow);
+   void print_json_flow(const Flow &flow);
+   void append_ip(const Flow &flow, const ipaddr_t &addr);
+   void append_time(timestamp_t ts, TimeCache &cache);
+   void write_buffer();
 };
 
 }
@@ -300,6 +300,7 @@ void UnirecExporter::close()
    m_basic_idx = -1;
    m_ifc_cnt = 0;
    delete [] m_ext_id_flgs;
+   m_ext_id_flgs = nullptr;
 }
 
 /**
@@ -405,10 +406,10 @@ void UnirecExporter::fill_basic_flow(const Flow &flow, ur_template_t *tmplt_ptr,
       ur_set(tmplt_ptr, record_ptr, F_DST_IP, ip_from_16_bytes_be((char *) flow.dst_ip.v6));
    }
 
-   tmp_time = ur_time_from_sec_usec(flow.time_first.tv_sec, flow.time_first.tv_usec);
+   tmp_time = ur_time_from_sec_usec(ts_sec(flow.time_first), ts_usec(flow.time_first));
    ur_set(tmplt_ptr, record_ptr, F_TIME_FIRST, tmp_time);
 
-   tmp_time = ur_time_from_sec_usec(flow.time_last.tv_sec, flow.time_last.tv_usec);
+   tmp_time = ur_time_from_sec_usec(ts_sec(flow.time_last), ts_usec(flow.time_last));
    ur_set(tmplt_ptr, record_ptr, F_TIME_LAST, tmp_time);
 
    if (m_odid) {
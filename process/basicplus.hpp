@@ -40,6 +40,7 @@
 #include <ipfixprobe/flowifc.hpp>
 #include <ipfixprobe/packet.hpp>
 #include <ipfixprobe/byte-utils.hpp>
+#include <ipfixprobe/text-format.hpp>
 #include <ipfixprobe/ipfix-elements.hpp>
 
 namespace ipxp {
@@ -147,14 +148,35 @@ struct RecordExtBASICPLUS : public RecordExt {
 
    std::string get_text() const
    {
-      std::ostringstream out;
-      out << "sttl=" << (uint16_t) ip_ttl[0] << ",dttl=" << (uint16_t) ip_ttl[1]
-         << ",sflg=" << (uint16_t) ip_flg[0] << ",dflg=" << (uint16_t) ip_flg[1]
-         << ",stcpw=" << tcp_win[0] << ",dtcpw=" << tcp_win[1]
-         << ",stcpo=" << tcp_opt[0] << ",dtcpo=" << tcp_opt[1]
-         << ",stcpm=" << tcp_mss[0] << ",dtcpm=" << tcp_mss[1]
-         << ",tcpsynsize=" << tcp_syn_size;
-      return out.str();
+      std::string out;
+      append_text(out);
+      return out;
+   }
+
+   void append_text(std::string &out) const
+   {
+      out += "sttl=";
+      append_uint(out, ip_ttl[0]);
+      out += ",dttl=";
+      append_uint(out, ip_ttl[1]);
+      out += ",sflg=";
+      append_uint(out, ip_flg[0]);
+      out += ",dflg=";
+      append_uint(out, ip_flg[1]);
+      out += ",stcpw=";
+      append_uint(out, tcp_win[0]);
+      out += ",dtcpw=";
+      append_uint(out, tcp_win[1]);
+      out += ",stcpo=";
+      append_uint(out, tcp_opt[0]);
+      out += ",dtcpo=";
+      append_uint(out, tcp_opt[1]);
+      out += ",stcpm=";
+      append_uint(out, tcp_mss[0]);
+      out += ",dtcpm=";
+      append_uint(out, tcp_mss[1]);
+      out += ",tcpsynsize=";
+      append_uint(out, tcp_syn_size);
    }
 };
 
@@ -171,6 +193,7 @@ public:
    OptionsParser *get_parser() const { return new OptionsParser("basicplus", "Extend basic fields with TTL, TCP window, options, MSS and SYN size"); }
    std::string get_name() const { return "basicplus"; }
    RecordExt *get_ext() const { return new RecordExtBASICPLUS(); }
+   uint32_t get_payload_len() const { return 0; }
    ProcessPlugin *copy();
 
    int post_create(Flow &rec, const Packet &pkt);
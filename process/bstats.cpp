@@ -41,8 +41,7 @@ __attribute__((constructor)) static void register_this_plugin()
    RecordExtBSTATS::REGISTERED_ID = register_extension();
 }
 
-const struct timeval BSTATSPlugin::min_packet_in_burst =
-{MAXIMAL_INTERPKT_TIME / 1000, (MAXIMAL_INTERPKT_TIME % 1000) * 1000};
+const timestamp_t BSTATSPlugin::min_packet_in_burst = MAXIMAL_INTERPKT_TIME * NSEC_IN_MSEC;
 
 
 BSTATSPlugin::BSTATSPlugin()
@@ -83,10 +82,9 @@ void BSTATSPlugin::initialize_new_burst(RecordExtBSTATS *bstats_record, uint8_t
 
 bool BSTATSPlugin::belogsToLastRecord(RecordExtBSTATS *bstats_record, uint8_t direction, const Packet &pkt)
 {
-   struct timeval timediff;
+   int64_t timediff = pkt.ts - bstats_record->brst_end[direction][bstats_record->BCOUNT];
 
-   timersub(&pkt.ts, &bstats_record->brst_end[direction][bstats_record->BCOUNT], &timediff);
-   if (timercmp(&timediff, &min_packet_in_burst, <)){
+   if (timediff < static_cast<int64_t>(min_packet_in_burst)){
       return true;
    }
    return false;
@@ -91,8 +91,8 @@ struct RecordExtBSTATS : public RecordExt {
 
    uint32_t       brst_pkts[2][BSTATS_MAXELENCOUNT];
    uint32_t       brst_bytes[2][BSTATS_MAXELENCOUNT];
-   struct timeval brst_start[2][BSTATS_MAXELENCOUNT];
-   struct timeval brst_end[2][BSTATS_MAXELENCOUNT];
+   timestamp_t    brst_start[2][BSTATS_MAXELENCOUNT];
+   timestamp_t    brst_end[2][BSTATS_MAXELENCOUNT];
 
    RecordExtBSTATS() : RecordExt(REGISTERED_ID)
    {
@@ -118,16 +118,16 @@ struct RecordExtBSTATS : public RecordExt {
       ur_array_allocate(tmplt, record, F_DBI_BRST_TIME_STOP, burst_count[BSTATS_DEST]);
 
       for (int i = 0; i < burst_count[BSTATS_SOURCE]; i++){
-         ts_start = ur_time_from_sec_usec(brst_start[BSTATS_SOURCE][i].tv_sec, brst_start[BSTATS_SOURCE][i].tv_usec);
-         ts_stop  = ur_time_from_sec_usec(brst_end[BSTATS_SOURCE][i].tv_sec, brst_end[BSTATS_SOURCE][i].tv_usec);
+         ts_start = ur_time_from_sec_usec(ts_sec(brst_start[BSTATS_SOURCE][i]), ts_usec(brst_start[BSTATS_SOURCE][i]));
+         ts_stop  = ur_time_from_sec_usec(ts_sec(brst_end[BSTATS_SOURCE][i]), ts_usec(brst_end[BSTATS_SOURCE][i]));
          ur_array_set(tmplt, record, F_SBI_BRST_PACKETS, i, brst_pkts[BSTATS_SOURCE][i]);
          ur_array_set(tmplt, record, F_SBI_BRST_BYTES, i, brst_bytes[BSTATS_SOURCE][i]);
          ur_array_set(tmplt, record, F_SBI_BRST_TIME_START, i, ts_start);
          ur_array_set(tmplt, record, F_SBI_BRST_TIME_STOP, i, ts_stop);
       }
       for (int i = 0; i < burst_count[BSTATS_DEST]; i++){
-         ts_start = ur_time_from_sec_usec(brst_start[BSTATS_DEST][i].tv_sec, brst_start[BSTATS_DEST][i].tv_usec);
-         ts_stop  = ur_time_from_sec_usec(brst_end[BSTATS_DEST][i].tv_sec, brst_end[BSTATS_DEST][i].tv_usec);
+         ts_start = ur_time_from_sec_usec(ts_sec(brst_start[BSTATS_DEST][i]), ts_usec(brst_start[BSTATS_DEST][i]));
+         ts_stop  = ur_time_from_sec_usec(ts_sec(brst_end[BSTATS_DEST][i]), ts_usec(brst_end[BSTATS_DEST][i]));
          ur_array_set(tmplt, record, F_DBI_BRST_PACKETS, i, brst_pkts[BSTATS_DEST][i]);
          ur_array_set(tmplt, record, F_DBI_BRST_BYTES, i, brst_bytes[BSTATS_DEST][i]);
          ur_array_set(tmplt, record, F_DBI_BRST_TIME_START, i, ts_start);
@@ -163,18 +163,18 @@ struct RecordExtBSTATS : public RecordExt {
         basiclist.FillBuffer(buffer + bufferPtr, brst_bytes[BSTATS_SOURCE], burst_count[BSTATS_SOURCE],
           (uint16_t) SBytes);
       bufferPtr +=
-        basiclist.FillBuffer(buffer + bufferPtr, brst_start[BSTATS_SOURCE], burst_count[BSTATS_SOURCE],
+        basiclist.FillBufferTs(buffer + bufferPtr, brst_start[BSTATS_SOURCE], burst_count[BSTATS_SOURCE],
           (uint16_t) SStart);
       bufferPtr +=
-        basiclist.FillBuffer(buffer + bufferPtr, brst_end[BSTATS_SOURCE], burst_count[BSTATS_SOURCE], (uint16_t) SStop);
+        basiclist.FillBufferTs(buffer + bufferPtr, brst_end[BSTATS_SOURCE], burst_count[BSTATS_SOURCE], (uint16_t) SStop);
 
       bufferPtr += basiclist.FillBuffer(buffer + bufferPtr, brst_pkts[BSTATS_DEST], burst_count[BSTATS_DEST],
           (uint16_t) DPkts);
       bufferPtr += basiclist.FillBuffer(buffer + bufferPtr, brst_bytes[BSTATS_DEST], burst_count[BSTATS_DEST],
           (uint16_t) DBytes);
-      bufferPtr += basiclist.FillBuffer(buffer + bufferPtr, brst_start[BSTATS_DEST], burst_count[BSTATS_DEST],
+      bufferPtr += basiclist.FillBufferTs(buffer + bufferPtr, brst_start[BSTATS_DEST], burst_count[BSTATS_DEST],
           (uint16_t) DStart);
-      bufferPtr += basiclist.FillBuffer(buffer + bufferPtr, brst_end[BSTATS_DEST], burst_count[BSTATS_DEST],
+      bufferPtr += basiclist.FillBufferTs(buffer + bufferPtr, brst_end[BSTATS_DEST], burst_count[BSTATS_DEST],
           (uint16_t) DStop);
 
       return bufferPtr;
@@ -213,9 +213,9 @@ struct RecordExtBSTATS : public RecordExt {
          }
          out << ")," << dirs_c[j] << "bursttime=(";
          for (int i = 0; i < burst_count[dir]; i++) {
-            struct timeval start = brst_start[dir][i];
-            struct timeval end = brst_end[dir][i];
-            out << start.tv_sec << "." << start.tv_usec << "-" << end.tv_sec << "." << end.tv_usec;
+            timestamp_t start = brst_start[dir][i];
+            timestamp_t end = brst_end[dir][i];
+            out << ts_sec(start) << "." << ts_usec(start) << "-" << ts_sec(end) << "." << ts_usec(end);
             if (i != burst_count[dir] - 1) {
                out << ",";
             }
@@ -240,6 +240,7 @@ public:
    OptionsParser *get_parser() const { return new OptionsParser("bstats", "Compute packet bursts stats"); }
    std::string get_name() const { return "bstats"; }
    RecordExt *get_ext() const { return new RecordExtBSTATS(); }
+   uint32_t get_payload_len() const { return 0; }
    ProcessPlugin *copy();
 
    int pre_create(Packet &pkt);
@@ -248,7 +249,7 @@ public:
    int post_update(Flow &rec, const Packet &pkt);
    void pre_export(Flow &rec);
 
-   static const struct timeval min_packet_in_burst;
+   static const timestamp_t min_packet_in_burst;
 
 private:
    void initialize_new_burst(RecordExtBSTATS *bstats_record, uint8_t direction, const Packet &pkt);
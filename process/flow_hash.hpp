@@ -123,6 +123,7 @@ public:
     OptionsParser *get_parser() const { return new OptionsParser("flow_hash", "Export flow hash as flow id"); }
     std::string get_name() const { return "flow_hash"; }
     RecordExt *get_ext() const { return new RecordExtFLOW_HASH(); }
+    uint32_t get_payload_len() const { return 0; }
     ProcessPlugin *copy();
 
     int post_create(Flow &rec, const Packet &pkt);
@@ -136,6 +136,7 @@ public:
    OptionsParser *get_parser() const { return new OptionsParser("icmp", "Parse ICMP traffic"); }
    std::string get_name() const { return "icmp"; }
    RecordExt *get_ext() const { return new RecordExtICMP(); }
+   uint32_t get_payload_len() const { return sizeof(RecordExtICMP::type_code); }
    ProcessPlugin *copy();
 
    int post_create(Flow &rec, const Packet &pkt);
@@ -145,6 +145,7 @@ public:
    OptionsParser *get_parser() const { return new OptionsParser("idpcontent", "Parse first bytes of flow payload"); }
    std::string get_name() const { return "idpcontent"; }
    RecordExt *get_ext() const { return new RecordExtIDPCONTENT(); }
+   uint32_t get_payload_len() const { return IDPCONTENT_SIZE; }
    ProcessPlugin *copy();
 
    int post_create(Flow &rec, const Packet &pkt);
@@ -121,6 +121,7 @@ public:
    OptionsParser *get_parser() const { return new OptionsParser("mpls", "Parse MPLS traffic"); }
    std::string get_name() const { return "mpls"; }
    RecordExt *get_ext() const { return new RecordExtMPLS(); }
+   uint32_t get_payload_len() const { return 0; }
    ProcessPlugin *copy();
 
    int post_create(Flow &rec, const Packet &pkt);
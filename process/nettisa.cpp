@@ -34,8 +34,8 @@ void NETTISAPlugin::update_record(
 {
     float variation_from_mean = pkt.payload_len_wire - nettisa_data->mean;
     uint32_t n = rec.dst_packets + rec.src_packets;
-    uint64_t packet_time = timeval2usec(pkt.ts);
-    uint64_t record_time = timeval2usec(rec.time_first);
+    uint64_t packet_time = ts_to_usec(pkt.ts);
+    uint64_t record_time = ts_to_usec(rec.time_first);
     float diff_time = fmax(packet_time - nettisa_data->prev_time, 0);
     nettisa_data->sum_payload += pkt.payload_len_wire;
     nettisa_data->prev_time = packet_time;
@@ -74,7 +74,7 @@ int NETTISAPlugin::post_create(Flow& rec, const Packet& pkt)
     RecordExtNETTISA* nettisa_data = new RecordExtNETTISA();
     rec.add_extension(nettisa_data);
 
-    nettisa_data->prev_time = timeval2usec(pkt.ts);
+    nettisa_data->prev_time = ts_to_usec(pkt.ts);
 
     update_record(nettisa_data, pkt, rec);
     return 0;
@@ -176,6 +176,7 @@ public:
     OptionsParser* get_parser() const { return new OptionsParser("nettisa", "Parse NetTiSA flow"); }
     std::string get_name() const { return "nettisa"; }
     RecordExt* get_ext() const { return new RecordExtNETTISA(); }
+    uint32_t get_payload_len() const { return 0; }
     ProcessPlugin* copy();
 
     int post_create(Flow& rec, const Packet& pkt);
@@ -112,9 +112,9 @@ void PHISTSPlugin::update_hist(RecordExtPHISTS *phists_data, uint32_t value, uin
    return;
 }
 
-uint64_t PHISTSPlugin::calculate_ipt(RecordExtPHISTS *phists_data, const struct timeval tv, uint8_t direction)
+uint64_t PHISTSPlugin::calculate_ipt(RecordExtPHISTS *phists_data, timestamp_t tv, uint8_t direction)
 {
-   int64_t ts = IpfixBasicList::Tv2Ts(tv);
+   int64_t ts = ts_to_msec(tv);
 
    if (phists_data->last_ts[direction] == 0) {
       phists_data->last_ts[direction] = ts;
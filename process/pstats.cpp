@@ -107,7 +107,7 @@ void PSTATSPlugin::update_record(RecordExtPSTATS *pstats_data, const Packet &pkt
       bool ack_susp = (pkt.tcp_ack <= pstats_data->tcp_ack[dir] && !seq_overflowed(pkt.tcp_ack, pstats_data->tcp_ack[dir])) ||
                       (pkt.tcp_ack > pstats_data->tcp_ack[dir] && seq_overflowed(pkt.tcp_ack, pstats_data->tcp_ack[dir]));
       if (seq_susp && ack_susp &&
-            pkt.payload_len == pstats_data->tcp_len[dir] &&
+            pkt.payload_len_wire == pstats_data->tcp_len[dir] &&
             pkt.tcp_flags == pstats_data->tcp_flg[dir] &&
             pstats_data->pkt_count != 0) {
          return;
@@ -115,7 +115,7 @@ void PSTATSPlugin::update_record(RecordExtPSTATS *pstats_data, const Packet &pkt
    }
    pstats_data->tcp_seq[dir] = pkt.tcp_seq;
    pstats_data->tcp_ack[dir] = pkt.tcp_ack;
-   pstats_data->tcp_len[dir] = pkt.payload_len;
+   pstats_data->tcp_len[dir] = pkt.payload_len_wire;
    pstats_data->tcp_flg[dir] = pkt.tcp_flags;
 
    if (pkt.payload_len_wire == 0 && use_zeros == false) {
@@ -134,10 +134,10 @@ void PSTATSPlugin::update_record(RecordExtPSTATS *pstats_data, const Packet &pkt
 
       pstats_data->pkt_timestamps[pkt_cnt] = pkt.ts;
 
-      DEBUG_MSG("PSTATS processed packet %d: Size: %d Timestamp: %ld.%ld\n", pkt_cnt,
+      DEBUG_MSG("PSTATS processed packet %d: Size: %d Timestamp: %ld.%u\n", pkt_cnt,
             pstats_data->pkt_sizes[pkt_cnt],
-            pstats_data->pkt_timestamps[pkt_cnt].tv_sec,
-            pstats_data->pkt_timestamps[pkt_cnt].tv_usec);
+            ts_sec(pstats_data->pkt_timestamps[pkt_cnt]),
+            ts_usec(pstats_data->pkt_timestamps[pkt_cnt]));
 
       pstats_data->pkt_dirs[pkt_cnt] = dir;
       pstats_data->pkt_count++;
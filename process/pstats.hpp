@@ -44,6 +44,7 @@
 #include <ipfixprobe/options.hpp>
 
 #include <ipfixprobe/byte-utils.hpp>
+#include <ipfixprobe/text-format.hpp>
 #include <ipfixprobe/ipfix-basiclist.hpp>
 #include <ipfixprobe/ipfix-elements.hpp>
 
@@ -87,7 +88,7 @@ struct RecordExtPSTATS : public RecordExt {
 
    uint16_t       pkt_sizes[PSTATS_MAXELEMCOUNT];
    uint8_t        pkt_tcp_flgs[PSTATS_MAXELEMCOUNT];
-   struct timeval pkt_timestamps[PSTATS_MAXELEMCOUNT];
+   timestamp_t pkt_timestamps[PSTATS_MAXELEMCOUNT];
    int8_t         pkt_dirs[PSTATS_MAXELEMCOUNT];
    uint16_t       pkt_count;
    uint32_t       tcp_seq[2];
@@ -119,7 +120,7 @@ struct RecordExtPSTATS : public RecordExt {
       ur_array_allocate(tmplt, record, F_PPI_PKT_DIRECTIONS, pkt_count);
 
       for (int i = 0; i < pkt_count; i++) {
-         ur_time_t ts = ur_time_from_sec_usec(pkt_timestamps[i].tv_sec, pkt_timestamps[i].tv_usec);
+         ur_time_t ts = ur_time_from_sec_usec(ts_sec(pkt_timestamps[i]), ts_usec(pkt_timestamps[i]));
          ur_array_set(tmplt, record, F_PPI_PKT_TIMES, i, ts);
          ur_array_set(tmplt, record, F_PPI_PKT_LENGTHS, i, pkt_sizes[i]);
          ur_array_set(tmplt, record, F_PPI_PKT_FLAGS, i, pkt_tcp_flgs[i]);
@@ -151,7 +152,7 @@ struct RecordExtPSTATS : public RecordExt {
       // Fill packet sizes
       bufferPtr = basiclist.FillBuffer(buffer, pkt_sizes, pkt_count, (uint16_t) PktSize);
       // Fill timestamps
-      bufferPtr += basiclist.FillBuffer(buffer + bufferPtr, pkt_timestamps, pkt_count,(uint16_t) PktTmstp);
+      bufferPtr += basiclist.FillBufferTs(buffer + bufferPtr, pkt_timestamps, pkt_count,(uint16_t) PktTmstp);
       // Fill tcp flags
       bufferPtr += basiclist.FillBuffer(buffer + bufferPtr, pkt_tcp_flgs, pkt_count, (uint16_t) PktFlags);
       // Fill directions
@@ -170,37 +171,44 @@ struct RecordExtPSTATS : public RecordExt {
    }
    std::string get_text() const
    {
-      std::ostringstream out;
-      out << "ppisizes=(";
+      std::string out;
+      append_text(out);
+      return out;
+   }
+
+   void append_text(std::string &out) const
+   {
+      out += "ppisizes=(";
       for (int i = 0; i < pkt_count; i++) {
-         out << pkt_sizes[i];
-         if (i != pkt_count - 1) {
-            out << ",";
+         if (i) {
+            out += ',';
          }
+         append_uint(out, pkt_sizes[i]);
       }
-      out << "),ppitimes=(";
+      out += "),ppitimes=(";
       for (int i = 0; i < pkt_count; i++) {
-         out << pkt_timestamps[i].tv_sec << "." << pkt_timestamps[i].tv_usec;
-         if (i != pkt_count - 1) {
-            out << ",";
+         if (i) {
+            out += ',';
          }
+         append_int(out, ts_sec(pkt_timestamps[i]));
+         out += '.';
+         append_uint(out, ts_usec(pkt_timestamps[i]));
       }
-      out << "),ppiflags=(";
+      out += "),ppiflags=(";
       for (int i = 0; i < pkt_count; i++) {
-         out << (uint16_t) pkt_tcp_flgs[i];
-         if (i != pkt_count - 1) {
-            out << ",";
+         if (i) {
+            out += ',';
          }
+         append_uint(out, pkt_tcp_flgs[i]);
       }
-      out << "),ppidirs=(";
+      out += "),ppidirs=(";
       for (int i = 0; i < pkt_count; i++) {
-         out << (int16_t) pkt_dirs[i];
-         if (i != pkt_count - 1) {
-            out << ",";
+         if (i) {
+            out += ',';
          }
+         append_int(out, pkt_dirs[i]);
       }
-      out << ")";
-      return out.str();
+      out += ')';
    }
 };
 
@@ -217,6 +225,7 @@ public:
    OptionsParser *get_parser() const { return new PSTATSOptParser(); }
    std::string get_name() const { return "pstats"; }
    RecordExt *get_ext() const { return new RecordExtPSTATS(); }
+   uint32_t get_payload_len() const { return 0; }
    ProcessPlugin *copy();
    int post_create(Flow &rec, const Packet &pkt);
    int post_update(Flow &rec, const Packet &pkt);
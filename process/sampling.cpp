@@ -0,0 +1,63 @@
+/**
+ * \file sampling.cpp
+ * \brief Plugin exporting flow sampling interval.
+ * \date 2026
+ */
+/*
+ * Copyright (C) 2026 CESNET
+ *
+ * LICENSE TERMS
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name of the Company nor the names of its contributors
+ *    may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ *
+ *
+ */
+
+#include <algorithm>
+
+#include "sampling.hpp"
+
+namespace ipxp {
+
+int RecordExtSAMPLING::REGISTERED_ID = -1;
+
+__attribute__((constructor)) static void register_this_plugin()
+{
+   static PluginRecord rec = PluginRecord("sampling", [](){return new SAMPLINGPlugin();});
+   register_plugin(&rec);
+   RecordExtSAMPLING::REGISTERED_ID = register_extension();
+}
+
+ProcessPlugin *SAMPLINGPlugin::copy()
+{
+   return new SAMPLINGPlugin(*this);
+}
+
+int SAMPLINGPlugin::post_create(Flow &rec, const Packet &pkt)
+{
+   auto ext = new RecordExtSAMPLING();
+   ext->interval = pkt.sampling;
+   rec.add_extension(ext);
+   return 0;
+}
+
+int SAMPLINGPlugin::post_update(Flow &rec, const Packet &pkt)
+{
+   auto ext = static_cast<RecordExtSAMPLING *>(rec.get_extension(RecordExtSAMPLING::REGISTERED_ID));
+   ext->interval = std::max(ext->interval, pkt.sampling);
+   return 0;
+}
+
+}
@@ -0,0 +1,127 @@
+/**
+ * \file sampling.hpp
+ * \brief Plugin exporting flow sampling interval.
+ * \date 2026
+ */
+/*
+ * Copyright (C) 2026 CESNET
+ *
+ * LICENSE TERMS
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name of the Company nor the names of its contributors
+ *    may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ *
+ *
+ */
+
+#ifndef IPXP_PROCESS_SAMPLING_HPP
+#define IPXP_PROCESS_SAMPLING_HPP
+
+#include <cstring>
+
+#ifdef WITH_NEMEA
+  #include "fields.h"
+#endif
+
+#include <ipfixprobe/process.hpp>
+#include <ipfixprobe/flowifc.hpp>
+#include <ipfixprobe/packet.hpp>
+#include <ipfixprobe/ipfix-elements.hpp>
+
+#include <cstdint>
+#include <string>
+#include <sstream>
+
+namespace ipxp {
+
+#define SAMPLING_UNIREC_TEMPLATE "SAMPLING_INTERVAL"
+
+UR_FIELDS (
+   uint32 SAMPLING_INTERVAL
+)
+
+/**
+ * \brief Flow record extension header for storing sampling interval of the flow.
+ */
+struct RecordExtSAMPLING : public RecordExt {
+   static int REGISTERED_ID;
+
+   uint32_t interval;
+
+   RecordExtSAMPLING() : RecordExt(REGISTERED_ID), interval(1)
+   {
+   }
+
+#ifdef WITH_NEMEA
+   virtual void fill_unirec(ur_template_t *tmplt, void *record)
+   {
+      ur_set(tmplt, record, F_SAMPLING_INTERVAL, interval);
+   }
+
+   const char *get_unirec_tmplt() const
+   {
+      return SAMPLING_UNIREC_TEMPLATE;
+   }
+#endif
+
+   virtual int fill_ipfix(uint8_t *buffer, int size)
+   {
+      const int LEN = sizeof(interval);
+
+      if (size < LEN) {
+         return -1;
+      }
+
+      *reinterpret_cast<uint32_t *>(buffer) = htonl(interval);
+      return LEN;
+   }
+
+   const char **get_ipfix_tmplt() const
+   {
+      static const char *ipfix_template[] = {
+         IPFIX_SAMPLING_TEMPLATE(IPFIX_FIELD_NAMES)
+         NULL
+      };
+      return ipfix_template;
+   }
+
+   std::string get_text() const
+   {
+      std::ostringstream out;
+      out << "samplinginterval=" << interval;
+      return out.str();
+   }
+};
+
+/**
+ * \brief Process plugin exporting interval of flow sampling done by input workers (-S).
+ *
+ * The largest interval seen by the flow is exported, packets of the flow were
+ * not dropped by sampling while it was in use.
+ */
+class SAMPLINGPlugin : public ProcessPlugin
+{
+public:
+   OptionsParser *get_parser() const { return new OptionsParser("sampling", "Export flow sampling interval, added automatically with -S"); }
+   std::string get_name() const { return "sampling"; }
+   RecordExt *get_ext() const { return new RecordExtSAMPLING(); }
+   uint32_t get_payload_len() const { return 0; }
+   ProcessPlugin *copy();
+
+   int post_create(Flow &rec, const Packet &pkt);
+   int post_update(Flow &rec, const Packet &pkt);
+};
+
+}
+#endif /* IPXP_PROCESS_SAMPLING_HPP */
@@ -61,7 +61,7 @@ ProcessPlugin* SSADetectorPlugin::copy()
 inline void SSADetectorPlugin::transition_from_init(
     RecordExtSSADetector* record,
     uint16_t len,
-    const timeval& ts,
+    timestamp_t ts,
     uint8_t dir)
 {
    record->syn_table.update_entry(len, dir, ts);
@@ -70,7 +70,7 @@ inline void SSADetectorPlugin::transition_from_init(
 inline void SSADetectorPlugin::transition_from_syn(
     RecordExtSSADetector* record,
     uint16_t len,
-    const timeval& ts,
+    timestamp_t ts,
     uint8_t dir)
 {
    bool can_transit = record->syn_table.check_range_for_presence(len, SYN_LOOKUP_WINDOW, !dir, ts);
@@ -82,7 +82,7 @@ inline void SSADetectorPlugin::transition_from_syn(
 inline bool SSADetectorPlugin::transition_from_syn_ack(
     RecordExtSSADetector* record,
     uint16_t len,
-    const timeval& ts,
+    timestamp_t ts,
     uint8_t dir)
 {
    return record->syn_table.check_range_for_presence(len, SYN_ACK_LOOKUP_WINDOW, !dir, ts);
@@ -96,7 +96,7 @@ void SSADetectorPlugin::update_record(RecordExtSSADetector* record, const Packet
     */
    uint8_t dir = pkt.source_pkt ? 0 : 1;
    uint16_t len = pkt.payload_len;
-   timeval ts = pkt.ts;
+   timestamp_t ts = pkt.ts;
 
    if (!(MIN_PKT_SIZE <= len && len <= MAX_PKT_SIZE)) {
       return;
@@ -200,13 +200,11 @@ void SSADetectorPlugin::pre_export(Flow& rec)
 //--------------------RecordExtSSADetector::pkt_entry-------------------------------
 void RecordExtSSADetector::pkt_entry::reset()
 {
-   ts_dir1.tv_sec = 0;
-   ts_dir1.tv_usec = 0;
-   ts_dir2.tv_sec = 0;
-   ts_dir2.tv_usec = 0;
+   ts_dir1 = 0;
+   ts_dir2 = 0;
 }
 
-timeval& RecordExtSSADetector::pkt_entry::get_time(dir_t dir)
+timestamp_t& RecordExtSSADetector::pkt_entry::get_time(dir_t dir)
 {
    return (dir == 1) ? ts_dir1 : ts_dir2;
 }
@@ -228,7 +226,7 @@ bool RecordExtSSADetector::pkt_table::check_range_for_presence(
     uint16_t len,
     uint8_t down_by,
     dir_t dir,
-    const timeval& ts_to_compare)
+    timestamp_t ts_to_compare)
 {
    int8_t idx = get_idx_from_len(len);
    for (int8_t i = std::max(idx - down_by, 0); i <= idx; ++i) {
@@ -239,7 +237,7 @@ bool RecordExtSSADetector::pkt_table::check_range_for_presence(
    return false;
 }
 
-void RecordExtSSADetector::pkt_table::update_entry(uint16_t len, dir_t dir, timeval ts)
+void RecordExtSSADetector::pkt_table::update_entry(uint16_t len, dir_t dir, timestamp_t ts)
 {
    int8_t idx = get_idx_from_len(len);
    if (dir == 1) {
@@ -249,12 +247,10 @@ void RecordExtSSADetector::pkt_table::update_entry(uint16_t len, dir_t dir, time
    }
 }
 
-bool RecordExtSSADetector::pkt_table::time_in_window(const timeval& ts_now, const timeval& ts_old)
+bool RecordExtSSADetector::pkt_table::time_in_window(timestamp_t ts_now, timestamp_t ts_old)
 {
-   long diff_secs = ts_now.tv_sec - ts_old.tv_sec;
-   long diff_micro_secs = ts_now.tv_usec - ts_old.tv_usec;
+   int64_t diff_micro_secs = ts_to_usec(ts_now) - ts_to_usec(ts_old);
 
-   diff_micro_secs += diff_secs * 1000000;
    if (diff_micro_secs > MAX_TIME_WINDOW) {
       return false;
    }
@@ -264,9 +260,9 @@ bool RecordExtSSADetector::pkt_table::time_in_window(const timeval& ts_now, cons
 bool RecordExtSSADetector::pkt_table::entry_is_present(
     int8_t idx,
     dir_t dir,
-    const timeval& ts_to_compare)
+    timestamp_t ts_to_compare)
 {
-   timeval& ts = table_[idx].get_time(dir);
+   timestamp_t& ts = table_[idx].get_time(dir);
    if (time_in_window(ts_to_compare, ts)) {
       return true;
    }
@@ -79,10 +79,10 @@ struct RecordExtSSADetector : public RecordExt {
    struct pkt_entry {
       pkt_entry();
       void reset();
-      timeval& get_time(dir_t dir);
+      timestamp_t& get_time(dir_t dir);
 
-      timeval ts_dir1;
-      timeval ts_dir2;
+      timestamp_t ts_dir1;
+      timestamp_t ts_dir2;
    };
 
    struct pkt_table {
@@ -95,13 +95,13 @@ struct RecordExtSSADetector : public RecordExt {
           uint16_t len,
           uint8_t down_by,
           dir_t dir,
-          const timeval& ts_to_compare);
-      void update_entry(uint16_t len, dir_t dir, timeval ts);
+          timestamp_t ts_to_compare);
+      void update_entry(uint16_t len, dir_t dir, timestamp_t ts);
 
   private:
       static inline int8_t get_idx_from_len(uint16_t len);
-      static inline bool time_in_window(const timeval& ts_now, const timeval& ts_old);
-      inline bool entry_is_present(int8_t idx, dir_t dir, const timeval& ts_to_compare);
+      static inline bool time_in_window(timestamp_t ts_now, timestamp_t ts_old);
+      inline bool entry_is_present(int8_t idx, dir_t dir, timestamp_t ts_to_compare);
    };
 
    uint8_t possible_vpn {0}; // fidelity of this flow being vpn
@@ -178,13 +178,13 @@ class SSADetectorPlugin : public ProcessPlugin {
    void pre_export(Flow& rec);
    void update_record(RecordExtSSADetector* record, const Packet& pkt);
    static inline void
-   transition_from_init(RecordExtSSADetector* record, uint16_t len, const timeval& ts, uint8_t dir);
+   transition_from_init(RecordExtSSADetector* record, uint16_t len, timestamp_t ts, uint8_t dir);
    static inline void
-   transition_from_syn(RecordExtSSADetector* record, uint16_t len, const timeval& ts, uint8_t dir);
+   transition_from_syn(RecordExtSSADetector* record, uint16_t len, timestamp_t ts, uint8_t dir);
    static inline bool transition_from_syn_ack(
        RecordExtSSADetector* record,
        uint16_t len,
-       const timeval& ts,
+       timestamp_t ts,
        uint8_t dir);
 };
 
@@ -69,6 +69,7 @@ public:
    void close();
    OptionsParser *get_parser() const { return new StatsOptParser(); }
    std::string get_name() const { return "stats"; }
+   uint32_t get_payload_len() const { return 0; }
    ProcessPlugin *copy();
 
    int post_create(Flow &rec, const Packet &pkt);
@@ -83,13 +84,13 @@ private:
    uint64_t m_flows_in_cache;
 
    bool m_init_ts;
-   struct timeval m_interval;
-   struct timeval m_last_ts;
+   timestamp_t m_interval;
+   timestamp_t m_last_ts;
    std::ostream *m_out;
 
    void check_timestamp(const Packet &pkt);
    void print_header() const;
-   void print_line(const struct timeval &ts) const;
+   void print_line(timestamp_t ts) const;
 };
 
 }
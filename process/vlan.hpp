@@ -115,6 +115,7 @@ public:
    OptionsParser *get_parser() const { return new OptionsParser("vlan", "Parse VLAN traffic"); }
    std::string get_name() const { return "vlan"; }
    RecordExt *get_ext() const { return new RecordExtVLAN(); }
+   uint32_t get_payload_len() const { return 0; }
    ProcessPlugin *copy();
 
    int post_create(Flow &rec, const Packet &pkt);
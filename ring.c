@@ -26,6 +26,7 @@
 
 #define _ISOC11_SOURCE
 #include <stdlib.h> // aligned_malloc
+#include <string.h>
 //#include <unistd.h>
 #include <pthread.h>
 #include <time.h>
@@ -91,7 +92,7 @@ struct ring_reader {
      */
     uint32_t div_block;
 
-    /** Previously read messages - only 0 or 1 */
+    /** Number of messages returned by the last pop, released by the next one (up to the bulk size) */
     uint32_t last;
 };
 
@@ -339,12 +340,13 @@ ipx_ring_begin(ipx_ring_t *ring)
 /**
  * \brief Commit modifications of memory
  * \param[in] ring Ring buffer
+ * \param[in] cnt  Number of written pointers (must not cross the end of the buffer)
  */
 static inline void
-ipx_ring_commit(ipx_ring_t *ring)
+ipx_ring_commit(ipx_ring_t *ring, uint32_t cnt)
 {
-    register uint32_t new_idx = 1;
-    ring->writer.data_idx++;
+    register uint32_t new_idx = cnt;
+    ring->writer.data_idx += cnt;
 
     if (ring->writer.size == ring->writer.data_idx) {
         // End of the ring buffer has been reached -> skip to the beginning
@@ -376,16 +378,92 @@ ipx_ring_push(ipx_ring_t *ring, ipx_msg_t *msg)
 
     msg_space = ipx_ring_begin(ring);
     *msg_space = msg;
-    ipx_ring_commit(ring);
+    ipx_ring_commit(ring, 1);
 
     if (ring->mw_mode) {
         pthread_spin_unlock(&ring->writer_lock);
     }
 }
 
+void
+ipx_ring_push_bulk(ipx_ring_t *ring, ipx_msg_t **msgs, uint32_t cnt)
+{
+    if (ring->mw_mode) {
+        pthread_spin_lock(&ring->writer_lock);
+    }
 
-ipx_msg_t *
-ipx_ring_pop(ipx_ring_t *ring)
+    while (cnt > 0) {
+        // Fill all empty space up to the end of the buffer at once
+        ipx_msg_t **msg_space = ipx_ring_begin(ring);
+        uint32_t space = ring->writer.exchange_idx - ring->writer.write_idx;
+        uint32_t to_end = ring->writer.size - ring->writer.data_idx;
+        uint32_t n = cnt;
+        if (n > space) {
+            n = space;
+        }
+        if (n > to_end) {
+            n = to_end;
+        }
+
+        memcpy(msg_space, msgs, n * sizeof(*msgs));
+        ipx_ring_commit(ring, n);
+        msgs += n;
+        cnt -= n;
+    }
+
+    if (ring->mw_mode) {
+        pthread_spin_unlock(&ring->writer_lock);
+    }
+}
+
+uint32_t
+ipx_ring_try_push_bulk(ipx_ring_t *ring, ipx_msg_t **msgs, uint32_t cnt)
+{
+    uint32_t pushed = 0;
+
+    if (ring->mw_mode) {
+        pthread_spin_lock(&ring->writer_lock);
+    }
+
+    if (ring->writer.exchange_idx - ring->writer.write_idx < cnt) {
+        // Get space released by the reader, but do not wait for more
+        pthread_mutex_lock(&ring->sync.mutex);
+        ring->writer.exchange_idx = ring->sync.write_idx;
+        pthread_cond_signal(&ring->sync.cond_reader);
+        pthread_mutex_unlock(&ring->sync.mutex);
+    }
+    uint32_t space = ring->writer.exchange_idx - ring->writer.write_idx;
+    if (cnt > space) {
+        cnt = space;
+    }
+
+    while (pushed < cnt) {
+        uint32_t to_end = ring->writer.size - ring->writer.data_idx;
+        uint32_t n = cnt - pushed;
+        if (n > to_end) {
+            n = to_end;
+        }
+
+        memcpy(&ring->data[ring->writer.data_idx], msgs + pushed, n * sizeof(*msgs));
+        ipx_ring_commit(ring, n);
+        pushed += n;
+    }
+
+    if (ring->mw_mode) {
+        pthread_spin_unlock(&ring->writer_lock);
+    }
+    return pushed;
+}
+
+/**
+ * \brief Release previously read messages and get number of messages ready for the reader
+ *
+ * \note If the buffer is empty, the function waits for a writer for a short time.
+ * \param[in] ring Ring buffer
+ * \return Number of messages starting at the reader head (0 if the buffer is empty)
+ */
+static inline uint32_t
+ipx_ring_ready(ipx_ring_t *ring)
 {
     // Consider previous memory block as processed
     ring->reader.data_idx += ring->reader.last;
@@ -397,9 +475,6 @@ ipx_ring_pop(ipx_ring_t *ring)
         ring->reader.data_idx = 0;
     }
 
-    // Prepare the next pointer to read
-    ipx_msg_t **msg = &ring->data[ring->reader.data_idx];
-
     // Sync positions with writers, if necessary
     if (ring->reader.read_idx - ring->reader.read_commit_idx >= ring->reader.div_block) {
         pthread_mutex_lock(&ring->sync.mutex);
@@ -412,39 +487,58 @@ ipx_ring_pop(ipx_ring_t *ring)
 
     if (ring->reader.exchange_idx - ring->reader.read_idx > 0) {
         // Ok, the reader owns this part of the buffer
-        // TODO: prefetch
-        ring->reader.last = 1;
-        return *msg; // Now, we can dereference the pointer
+        return ring->reader.exchange_idx - ring->reader.read_idx;
     }
 
-    while (1) {
-        // The reader has reached the end of the filled memory -> try to sync
-        pthread_mutex_lock(&ring->sync.mutex);
-        pthread_cond_signal(&ring->sync.cond_writer);
-        // Wait until a writer sends a signal or a timeout expires
-        ring_cond_timedwait(&ring->sync.cond_reader, &ring->sync.mutex, 10);
-        ring->reader.exchange_idx = ring->sync.read_idx;
-        pthread_mutex_unlock(&ring->sync.mutex);
+    // The reader has reached the end of the filled memory -> try to sync
+    pthread_mutex_lock(&ring->sync.mutex);
+    pthread_cond_signal(&ring->sync.cond_writer);
+    // Wait until a writer sends a signal or a timeout expires
+    ring_cond_timedwait(&ring->sync.cond_reader, &ring->sync.mutex, 10);
+    ring->reader.exchange_idx = ring->sync.read_idx;
+    pthread_mutex_unlock(&ring->sync.mutex);
 
-        if (ring->reader.exchange_idx - ring->reader.read_idx > 0) {
-            // TODO: prefetch
-            ring->reader.last = 1;
-            return *msg; // Now, we can dereference the pointer
-        }
+    if (ring->reader.exchange_idx - ring->reader.read_idx > 0) {
+        return ring->reader.exchange_idx - ring->reader.read_idx;
+    }
 
-        // Writer still didn't perform sync -> try to steal all committed messages from writer
-        pthread_mutex_lock(&ring->sync.mutex);
-        ring->sync.read_idx = ring->reader.exchange_idx = __sync_fetch_and_add(&ring->writer.write_idx, 0);
-        pthread_mutex_unlock(&ring->sync.mutex);
+    // Writer still didn't perform sync -> try to steal all committed messages from writer
+    pthread_mutex_lock(&ring->sync.mutex);
+    ring->sync.read_idx = ring->reader.exchange_idx = __sync_fetch_and_add(&ring->writer.write_idx, 0);
+    pthread_mutex_unlock(&ring->sync.mutex);
 
-        if (ring->reader.exchange_idx - ring->reader.read_idx > 0) {
-            // TODO: prefetch
-            ring->reader.last = 1;
-            return *msg; // Now, we can dereference the pointer
-        }
-        break;
+    return ring->reader.exchange_idx - ring->reader.read_idx;
+}
+
+ipx_msg_t *
+ipx_ring_pop(ipx_ring_t *ring)
+{
+    if (ipx_ring_ready(ring) == 0) {
+        return NULL;
     }
-    return NULL;
+
+    // TODO: prefetch
+    ring->reader.last = 1;
+    return ring->data[ring->reader.data_idx]; // Now, we can dereference the pointer
+}
+
+uint32_t
+ipx_ring_pop_bulk(ipx_ring_t *ring, ipx_msg_t **msgs, uint32_t max)
+{
+    uint32_t cnt = ipx_ring_ready(ring);
+    uint32_t to_end = ring->reader.size - ring->reader.data_idx;
+
+    // Messages behind the end of the buffer are returned by the next call
+    if (cnt > to_end) {
+        cnt = to_end;
+    }
+    if (cnt > max) {
+        cnt = max;
+    }
+
+    memcpy(msgs, &ring->data[ring->reader.data_idx], cnt * sizeof(*msgs));
+    ring->reader.last = cnt;
+    return cnt;
 }
 
 void
@@ -0,0 +1,183 @@
+/**
+ * \file sampler.cpp
+ * \brief Hash based flow sampling of input packets
+ * \date 2026
+ */
+/*
+ * Copyright (C) 2026 CESNET
+ *
+ * LICENSE TERMS
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name of the Company nor the names of its contributors
+ *    may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ *
+ *
+ */
+
+#include <algorithm>
+#include <cstring>
+#include <ctime>
+
+#include <ipfixprobe/utils.hpp>
+
+#include "sampler.hpp"
+#include "storage/xxhash.h"
+
+namespace ipxp {
+
+static uint64_t monotonic_ms()
+{
+   struct timespec now;
+#ifdef __linux__
+   clock_gettime(CLOCK_MONOTONIC_COARSE, &now);
+#else
+   clock_gettime(CLOCK_MONOTONIC, &now);
+#endif
+   return now.tv_sec * 1000ULL + now.tv_nsec / 1000000;
+}
+
+FlowSampler::FlowSampler(uint32_t interval, uint32_t max_interval) :
+   m_interval(1), m_min_interval(interval), m_max_interval(std::max(interval, max_interval)), m_threshold(UINT64_MAX),
+   m_overload(0), m_next_adapt(0), m_calm(0),
+   m_fragmentation_cache(SAMPLING_FRAG_CACHE_SIZE, SAMPLING_FRAG_CACHE_TIMEOUT)
+{
+   set_interval(interval);
+}
+
+/**
+ * \brief Parse sampling interval given as N (fixed) or N:MAX (adaptive).
+ */
+bool FlowSampler::parse_interval(const std::string &str, uint32_t &interval, uint32_t &max_interval)
+{
+   std::string from = str;
+   std::string to = str;
+
+   try {
+      if (str.find(':') != std::string::npos) {
+         parse_range(str, from, to, ":");
+      }
+      interval = str2num<uint32_t>(from);
+      max_interval = str2num<uint32_t>(to);
+   } catch (std::invalid_argument &e) {
+      return false;
+   }
+   return interval > 0 && max_interval >= interval;
+}
+
+void FlowSampler::set_interval(uint32_t interval)
+{
+   m_interval = interval;
+   m_threshold = UINT64_MAX / interval;
+}
+
+bool FlowSampler::selected(Packet &pkt)
+{
+   struct {
+      uint8_t ip[2][16];
+      uint16_t port[2];
+      uint8_t ip_version;
+      uint8_t proto;
+   } key;
+   size_t ip_len = pkt.ip_version == IP::v6 ? 16 : 4;
+   const uint8_t *src = reinterpret_cast<const uint8_t *>(&pkt.src_ip);
+   const uint8_t *dst = reinterpret_cast<const uint8_t *>(&pkt.dst_ip);
+   uint16_t src_port;
+   uint16_t dst_port;
+
+   if (m_max_interval == 1) {
+      return true;
+   }
+   // First fragments are recorded even when everything is kept, the interval may grow before the next ones
+   m_fragmentation_cache.process_packet(pkt);
+   if (m_interval == 1) {
+      return true;
+   }
+   src_port = pkt.src_port;
+   dst_port = pkt.dst_port;
+
+   memset(&key, 0, sizeof(key));
+   int cmp = memcmp(src, dst, ip_len);
+   if (cmp > 0 || (cmp == 0 && src_port > dst_port)) {
+      std::swap(src, dst);
+      std::swap(src_port, dst_port);
+   }
+   memcpy(key.ip[0], src, ip_len);
+   memcpy(key.ip[1], dst, ip_len);
+   key.port[0] = src_port;
+   key.port[1] = dst_port;
+   key.ip_version = pkt.ip_version;
+   key.proto = pkt.ip_proto;
+
+   return XXH64(&key, sizeof(key), 0) <= m_threshold;
+}
+
+/**
+ * \brief Remove packets of flows that are not sampled, order of remaining packets is kept.
+ * \return Number of removed packets.
+ */
+size_t FlowSampler::filter(PacketBlock &block)
+{
+   size_t kept = 0;
+
+   for (size_t i = 0; i < block.cnt; i++) {
+      Packet &pkt = block.pkts[i];
+      if (!selected(pkt)) {
+         block.bytes -= pkt.packet_len_wire;
+         continue;
+      }
+      pkt.sampling = m_interval;
+      if (kept != i) {
+         std::swap(block.pkts[kept], pkt);
+      }
+      kept++;
+   }
+
+   size_t removed = block.cnt - kept;
+   block.cnt = kept;
+   return removed;
+}
+
+/**
+ * \brief Double the sampling interval when overload was seen, halve it after a calm period.
+ * \param [in] overload Monotonic counter of overload events, e.g. packets dropped by the input.
+ */
+void FlowSampler::adapt(uint64_t overload)
+{
+   if (m_max_interval == m_min_interval) {
+      return;
+   }
+   uint64_t now = monotonic_ms();
+   if (m_next_adapt == 0) {
+      m_overload = overload;
+      m_next_adapt = now + SAMPLING_ADAPT_INTERVAL;
+      return;
+   }
+   if (now < m_next_adapt) {
+      return;
+   }
+   m_next_adapt = now + SAMPLING_ADAPT_INTERVAL;
+
+   if (overload > m_overload) {
+      m_calm = 0;
+      if (m_interval < m_max_interval) {
+         set_interval(std::min<uint64_t>(2ULL * m_interval, m_max_interval));
+      }
+   } else if (++m_calm >= SAMPLING_RELAX_INTERVALS) {
+      m_calm = 0;
+      set_interval(std::max(m_interval / 2, m_min_interval));
+   }
+   m_overload = overload;
+}
+
+}
@@ -0,0 +1,80 @@
+/**
+ * \file sampler.hpp
+ * \brief Hash based flow sampling of input packets
+ * \date 2026
+ */
+/*
+ * Copyright (C) 2026 CESNET
+ *
+ * LICENSE TERMS
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name of the Company nor the names of its contributors
+ *    may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ *
+ *
+ */
+
+#ifndef IPXP_SAMPLER_HPP
+#define IPXP_SAMPLER_HPP
+
+#include <cstdint>
+#include <string>
+
+#include <ipfixprobe/packet.hpp>
+
+#include "storage/fragmentationCache/fragmentationCache.hpp"
+
+namespace ipxp {
+
+#define SAMPLING_ADAPT_INTERVAL 1000 /**< Period of sampling rate adaptation in milliseconds */
+#define SAMPLING_RELAX_INTERVALS 10 /**< Adaptation periods without overload before the sampling rate is halved */
+#define SAMPLING_FRAG_CACHE_SIZE 10007 /**< Fragmentation cache size, same default as the flow cache uses */
+#define SAMPLING_FRAG_CACHE_TIMEOUT 3 /**< Fragmentation cache timeout in seconds */
+
+/**
+ * \brief Keeps packets of flows whose symmetric hash is below a threshold.
+ *
+ * Flows kept at a sampling interval are also kept at every lower interval, so a flow
+ * is not cut when the adaptive interval grows, as long as it is still selected.
+ * The hash covers addresses, ports, IP version and protocol. Ports of fragments following
+ * the first one are looked up in a fragmentation cache before the decision, so all fragments
+ * share the decision of their flow. Fragments whose first fragment was not seen keep zero ports.
+ */
+class FlowSampler
+{
+public:
+   FlowSampler(uint32_t interval, uint32_t max_interval);
+
+   size_t filter(PacketBlock &block);
+   void adapt(uint64_t overload);
+   uint32_t interval() const { return m_interval; }
+
+   static bool parse_interval(const std::string &str, uint32_t &interval, uint32_t &max_interval);
+
+private:
+   uint32_t m_interval; /**< Current sampling interval, one of N flows is kept */
+   uint32_t m_min_interval;
+   uint32_t m_max_interval; /**< Interval is adapted up to this value when it is larger than minimum */
+   uint64_t m_threshold;
+   uint64_t m_overload; /**< Overload counter value seen in the last adaptation */
+   uint64_t m_next_adapt;
+   uint32_t m_calm; /**< Number of adaptation periods without overload */
+   FragmentationCache m_fragmentation_cache; /**< Fills ports of non-first fragments */
+
+   void set_interval(uint32_t interval);
+   bool selected(Packet &pkt);
+};
+
+}
+#endif /* IPXP_SAMPLER_HPP */
@@ -46,6 +46,11 @@ struct InputStats {
    uint64_t bytes;
    uint64_t qtime;
    uint64_t dropped;
+   uint64_t idle; /**< Time in nanoseconds the input had no packets */
+   uint64_t idle_cpu; /**< CPU time in nanoseconds consumed while idle */
+   uint64_t duplicates; /**< Packets dropped as duplicates */
+   uint64_t unsampled; /**< Packets of flows not selected by flow sampling */
+   uint64_t sampling; /**< Current flow sampling interval */
 };
 
 struct OutputStats {
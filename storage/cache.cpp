@@ -33,6 +33,7 @@
 #include <cstdlib>
 #include <iostream>
 #include <cstring>
+#include <thread>
 #include <sys/time.h>
 
 #include <ipfixprobe/ring.h>
@@ -49,6 +50,7 @@ __attribute__((constructor)) static void register_this_plugin()
 
 FlowRecord::FlowRecord()
 {
+   m_flow.refs = 0;
    erase();
 };
 
@@ -62,8 +64,8 @@ void FlowRecord::erase()
    m_flow.remove_extensions();
    m_hash = 0;
 
-   memset(&m_flow.time_first, 0, sizeof(m_flow.time_first));
-   memset(&m_flow.time_last, 0, sizeof(m_flow.time_last));
+   m_flow.time_first = 0;
+   m_flow.time_last = 0;
    m_flow.ip_version = 0;
    m_flow.ip_proto = 0;
    memset(&m_flow.src_ip, 0, sizeof(m_flow.src_ip));
@@ -163,7 +165,7 @@ void FlowRecord::update(const Packet &pkt, bool src)
 
 NHTFlowCache::NHTFlowCache() :
    m_cache_size(0), m_line_size(0), m_line_mask(0), m_line_new_idx(0),
-   m_qsize(0), m_qidx(0), m_timeout_idx(0), m_active(0), m_inactive(0),
+   m_qsize(0), m_qidx(0), m_exports(), m_exports_cnt(0), m_timeout_idx(0), m_active(0), m_inactive(0),
    m_split_biflow(false), m_enable_fragmentation_cache(true), m_keylen(0),
    m_key(), m_key_inv(), m_flow_table(nullptr), m_flow_records(nullptr),
    m_fragmentation_cache(0, 0)
@@ -189,6 +191,7 @@ void NHTFlowCache::init(const char *params)
    m_active = parser.m_active;
    m_inactive = parser.m_inactive;
    m_qidx = 0;
+   m_exports_cnt = 0;
    m_timeout_idx = 0;
    m_line_mask = (m_cache_size - 1) & ~(m_line_size - 1);
    m_line_new_idx = m_line_size / 2;
@@ -248,18 +251,52 @@ void NHTFlowCache::close()
    }
 }
 
-void NHTFlowCache::set_queue(ipx_ring_t *queue)
+void NHTFlowCache::set_queue(ipx_ring_t *queue, uint32_t held)
 {
    m_export_queue = queue;
-   m_qsize = ipx_ring_size(queue);
+   // Records of flows waiting in m_exports or held by outputs cannot be reused as well
+   m_qsize = ipx_ring_size(queue) + EXPORT_BULK + held;
+}
+
+void NHTFlowCache::push_exports()
+{
+   if (m_exports_cnt) {
+      ipx_ring_push_bulk(m_export_queue, reinterpret_cast<ipx_msg_t **>(m_exports), m_exports_cnt);
+      m_exports_cnt = 0;
+   }
+}
+
+/**
+ * \brief Get index of exported record released by all outputs, wait when there is none.
+ */
+uint32_t NHTFlowCache::free_record()
+{
+   uint32_t checked = 0;
+
+   while (__atomic_load_n(&m_flow_table[m_cache_size + m_qidx]->m_flow.refs, __ATOMIC_ACQUIRE)) {
+      m_qidx = (m_qidx + 1) % m_qsize;
+      if (++checked == m_qsize) {
+         // Outputs cannot release flows they have not received yet
+         push_exports();
+         std::this_thread::yield();
+         checked = 0;
+      }
+   }
+
+   uint32_t idx = m_qidx;
+   m_qidx = (m_qidx + 1) % m_qsize;
+   return idx;
 }
 
 void NHTFlowCache::export_flow(size_t index)
 {
-   ipx_ring_push(m_export_queue, &m_flow_table[index]->m_flow);
-   std::swap(m_flow_table[index], m_flow_table[m_cache_size + m_qidx]);
+   if (m_exports_cnt == EXPORT_BULK) {
+      push_exports();
+   }
+   m_flow_table[index]->m_flow.refs = 1;
+   m_exports[m_exports_cnt++] = &m_flow_table[index]->m_flow;
+   std::swap(m_flow_table[index], m_flow_table[m_cache_size + free_record()]);
    m_flow_table[index]->erase();
-   m_qidx = (m_qidx + 1) % m_qsize;
 }
 
 void NHTFlowCache::finish()
@@ -274,6 +311,7 @@ void NHTFlowCache::finish()
 #endif /* FLOW_CACHE_STATS */
       }
    }
+   push_exports();
 }
 
 void NHTFlowCache::flush(Packet &pkt, size_t flow_index, int ret, bool source_flow)
@@ -285,16 +323,21 @@ void NHTFlowCache::flush(Packet &pkt, size_t flow_index, int ret, bool source_fl
    if (ret == FLOW_FLUSH_WITH_REINSERT) {
       FlowRecord *flow = m_flow_table[flow_index];
       flow->m_flow.end_reason = FLOW_END_FORCED;
-      ipx_ring_push(m_export_queue, &flow->m_flow);
+      if (m_exports_cnt == EXPORT_BULK) {
+         push_exports();
+      }
+      flow->m_flow.refs = 1;
+      m_exports[m_exports_cnt++] = &flow->m_flow;
 
-      std::swap(m_flow_table[flow_index], m_flow_table[m_cache_size + m_qidx]);
+      uint32_t qidx = free_record();
+      std::swap(m_flow_table[flow_index], m_flow_table[m_cache_size + qidx]);
 
       flow = m_flow_table[flow_index];
       flow->m_flow.remove_extensions();
-      *flow = *m_flow_table[m_cache_size + m_qidx];
-      m_qidx = (m_qidx + 1) % m_qsize;
+      *flow = *m_flow_table[m_cache_size + qidx];
 
       flow->m_flow.m_exts = nullptr;
+      flow->m_flow.refs = 0;
       flow->reuse(); // Clean counters, set time first to last
       flow->update(pkt, source_flow); // Set new counters from packet
 
@@ -430,7 +473,7 @@ int NHTFlowCache::put_pkt(Packet &pkt)
       }
    } else {
       /* Check if flow record is expired (inactive timeout). */
-      if (pkt.ts.tv_sec - flow->m_flow.time_last.tv_sec >= m_inactive) {
+      if (ts_sec(pkt.ts) - ts_sec(flow->m_flow.time_last) >= m_inactive) {
          m_flow_table[flow_index]->m_flow.end_reason = get_export_reason(flow->m_flow);
          plugins_pre_export(flow->m_flow);
          export_flow(flow_index);
@@ -441,7 +484,7 @@ int NHTFlowCache::put_pkt(Packet &pkt)
       }
 
       /* Check if flow record is expired (active timeout). */
-      if (pkt.ts.tv_sec - flow->m_flow.time_first.tv_sec >= m_active) {
+      if (ts_sec(pkt.ts) - ts_sec(flow->m_flow.time_first) >= m_active) {
          m_flow_table[flow_index]->m_flow.end_reason = FLOW_END_ACTIVE;
          plugins_pre_export(flow->m_flow);
          export_flow(flow_index);
@@ -466,7 +509,7 @@ int NHTFlowCache::put_pkt(Packet &pkt)
       }
    }
 
-   export_expired(pkt.ts.tv_sec);
+   export_expired(ts_sec(pkt.ts));
    return 0;
 }
 
@@ -488,7 +531,7 @@ uint8_t NHTFlowCache::get_export_reason(Flow &flow)
 void NHTFlowCache::export_expired(time_t ts)
 {
    for (decltype(m_timeout_idx) i = m_timeout_idx; i < m_timeout_idx + m_line_new_idx; i++) {
-      if (!m_flow_table[i]->is_empty() && ts - m_flow_table[i]->m_flow.time_last.tv_sec >= m_inactive) {
+      if (!m_flow_table[i]->is_empty() && ts - ts_sec(m_flow_table[i]->m_flow.time_last) >= m_inactive) {
          m_flow_table[i]->m_flow.end_reason = get_export_reason(m_flow_table[i]->m_flow);
          plugins_pre_export(m_flow_table[i]->m_flow);
          export_flow(i);
@@ -499,6 +542,7 @@ void NHTFlowCache::export_expired(time_t ts)
    }
 
    m_timeout_idx = (m_timeout_idx + m_line_new_idx) & (m_cache_size - 1);
+   push_exports();
 }
 
 bool NHTFlowCache::create_hash_key(Packet &pkt)
@@ -64,6 +64,7 @@ struct __attribute__((packed)) flow_key_v6_t {
 };
 
 #define MAX_KEY_LENGTH (max<size_t>(sizeof(flow_key_v4_t), sizeof(flow_key_v6_t)))
+#define EXPORT_BULK 64 /**< Maximal number of exported flows pushed to output queue at once */
 
 #ifdef IPXP_FLOW_CACHE_SIZE
 static const uint32_t DEFAULT_FLOW_CACHE_SIZE = IPXP_FLOW_CACHE_SIZE;
@@ -184,7 +185,7 @@ public:
    ~NHTFlowCache();
    void init(const char *params);
    void close();
-   void set_queue(ipx_ring_t *queue);
+   void set_queue(ipx_ring_t *queue, uint32_t held = 0);
    OptionsParser *get_parser() const { return new CacheOptParser(); }
    std::string get_name() const { return "cache"; }
 
@@ -198,6 +199,8 @@ private:
    uint32_t m_line_new_idx;
    uint32_t m_qsize;
    uint32_t m_qidx;
+   Flow *m_exports[EXPORT_BULK]; /**< Exported flows not yet pushed to output queue */
+   uint32_t m_exports_cnt;
    uint32_t m_timeout_idx;
 #ifdef FLOW_CACHE_STATS
    uint64_t m_empty;
@@ -224,6 +227,8 @@ private:
    void flush(Packet &pkt, size_t flow_index, int ret, bool source_flow);
    bool create_hash_key(Packet &pkt);
    void export_flow(size_t index);
+   uint32_t free_record();
+   void push_exports();
    static uint8_t get_export_reason(Flow &flow);
    void finish();
 
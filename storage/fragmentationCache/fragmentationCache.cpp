@@ -30,14 +30,13 @@
 
 #include "../xxhash.h"
 #include "fragmentationCache.hpp"
-#include "timevalUtils.hpp"
 
 #include <cstring>
 
 namespace ipxp {
 
 FragmentationCache::FragmentationCache(std::size_t table_size, time_t timeout_in_seconds)
-    : m_timeout({timeout_in_seconds, 0})
+    : m_timeout(timeout_in_seconds * NSEC_IN_SEC)
     , m_fragmentation_table(table_size)
 {
 }
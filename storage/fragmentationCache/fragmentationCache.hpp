@@ -34,7 +34,7 @@
 
 #include <cstdint>
 #include <ipfixprobe/packet.hpp>
-#include <sys/time.h>
+#include <ipfixprobe/timestamp.hpp>
 
 namespace ipxp {
 
@@ -100,7 +100,7 @@ private:
         return !packet.frag_off && packet.more_fragments;
     }
 
-    struct timeval m_timeout;
+    timestamp_t m_timeout;
     FragmentationTable m_fragmentation_table;
 };
 
@@ -97,7 +97,7 @@ struct FragmentationData {
 
     uint16_t source_port; ///< Source port of the packet.
     uint16_t destination_port; ///< Destination port of the packet.
-    timeval timestamp; ///< Timestamp of the packet.
+    timestamp_t timestamp; ///< Timestamp of the packet.
 };
 
 /**
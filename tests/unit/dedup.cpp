@@ -0,0 +1,166 @@
+#include <netinet/in.h>
+#include "gtest/gtest.h"
+
+#include "../../dedup.hpp"
+
+namespace ipxp_test {
+
+using namespace ipxp;
+
+#define WINDOW 50 // Microseconds
+
+static Packet make_packet(timestamp_t ts)
+{
+   Packet pkt;
+   pkt.ts = ts;
+   pkt.ip_version = IP::v4;
+   pkt.ip_proto = IPPROTO_TCP;
+   pkt.src_ip.v4 = 0x0100000a;
+   pkt.dst_ip.v4 = 0x0200000a;
+   pkt.src_port = 40000;
+   pkt.dst_port = 443;
+   pkt.frag_id = 1234;
+   pkt.tcp_seq = 1000;
+   pkt.tcp_ack = 2000;
+   pkt.l4_checksum = 0xabcd;
+   pkt.ip_len = 100;
+   pkt.packet_len_wire = 114;
+   return pkt;
+}
+
+/*
+ * Pass single packet through the filter, return true when it was dropped.
+ */
+static bool dropped(PacketDedup &dedup, const Packet &pkt)
+{
+   PacketBlock block(1);
+   block.pkts[0] = pkt;
+   block.cnt = 1;
+   block.bytes = pkt.packet_len_wire;
+   size_t removed = dedup.filter(block);
+   EXPECT_EQ(block.cnt, 1 - removed);
+   EXPECT_EQ(block.bytes, removed ? 0 : pkt.packet_len_wire);
+   return removed;
+}
+
+static const timestamp_t start = ts_from_sec_usec(1600000000, 0);
+
+TEST(PacketDedup, windowBoundary)
+{
+   PacketDedup dedup(WINDOW, DEDUP_ALL);
+   Packet pkt = make_packet(start);
+
+   EXPECT_FALSE(dropped(dedup, pkt));
+   pkt.ts = start + WINDOW * NSEC_IN_USEC;
+   EXPECT_TRUE(dropped(dedup, pkt));
+   // Dropped copy does not extend the window
+   pkt.ts = start + WINDOW * NSEC_IN_USEC + 1;
+   EXPECT_FALSE(dropped(dedup, pkt));
+   pkt.ts = start + 2 * WINDOW * NSEC_IN_USEC + 1;
+   EXPECT_TRUE(dropped(dedup, pkt));
+}
+
+TEST(PacketDedup, outOfOrderTimestamps)
+{
+   PacketDedup dedup(WINDOW, DEDUP_ALL);
+   Packet pkt = make_packet(start + 10 * NSEC_IN_USEC);
+
+   EXPECT_FALSE(dropped(dedup, pkt));
+   pkt.ts = start;
+   EXPECT_TRUE(dropped(dedup, pkt));
+   pkt.ts = start + 10 * NSEC_IN_USEC - WINDOW * NSEC_IN_USEC - 1;
+   EXPECT_FALSE(dropped(dedup, pkt));
+}
+
+TEST(PacketDedup, bucketEviction)
+{
+   PacketDedup dedup(1000000, DEDUP_ALL);
+   Packet first = make_packet(start);
+   EXPECT_FALSE(dropped(dedup, first));
+
+   // Fill every bucket several times over with newer digests
+   Packet pkt = make_packet(start);
+   for (uint32_t i = 0; i < 4 * DEDUP_TABLE_SIZE; i++) {
+      pkt.ts++;
+      pkt.tcp_seq = 1000 + i + 1;
+      EXPECT_FALSE(dropped(dedup, pkt));
+   }
+   // The oldest digest was replaced, its copy is not recognized any more
+   first.ts = pkt.ts;
+   EXPECT_FALSE(dropped(dedup, first));
+   // Recent digests are kept
+   EXPECT_TRUE(dropped(dedup, pkt));
+}
+
+TEST(PacketDedup, filterKeepsOrder)
+{
+   PacketDedup dedup(WINDOW, DEDUP_ALL);
+   PacketBlock block(5);
+   for (unsigned i = 0; i < 5; i++) {
+      block.pkts[i] = make_packet(start + i);
+      block.pkts[i].tcp_seq = i % 2 ? 1001 : 1000 + 10 * i;
+      block.bytes += block.pkts[i].packet_len_wire;
+   }
+   block.cnt = 5;
+
+   // Packets 1 and 3 are copies of each other
+   EXPECT_EQ(dedup.filter(block), 1);
+   ASSERT_EQ(block.cnt, 4);
+   EXPECT_EQ(block.bytes, 4 * 114);
+   EXPECT_EQ(block.pkts[0].tcp_seq, 1000);
+   EXPECT_EQ(block.pkts[1].tcp_seq, 1001);
+   EXPECT_EQ(block.pkts[2].tcp_seq, 1020);
+   EXPECT_EQ(block.pkts[3].tcp_seq, 1040);
+}
+
+TEST(PacketDedup, digestFields)
+{
+   struct {
+      uint32_t field;
+      void (*change)(Packet &pkt);
+   } fields[] = {
+      {DEDUP_IPID, [](Packet &pkt) { pkt.frag_id++; }},
+      {DEDUP_ADDR, [](Packet &pkt) { pkt.src_ip.v4++; }},
+      {DEDUP_PORTS, [](Packet &pkt) { pkt.dst_port++; }},
+      {DEDUP_SEQ, [](Packet &pkt) { pkt.tcp_seq++; }},
+      {DEDUP_SEQ, [](Packet &pkt) { pkt.tcp_ack++; }},
+      {DEDUP_CSUM, [](Packet &pkt) { pkt.l4_checksum++; }},
+      {DEDUP_LEN, [](Packet &pkt) { pkt.ip_len++; }},
+   };
+
+   for (auto &it : fields) {
+      Packet pkt = make_packet(start);
+      Packet copy = make_packet(start + 1);
+      it.change(copy);
+
+      // Packets differing in the field are different only when the field is compared
+      PacketDedup with(WINDOW, it.field);
+      EXPECT_FALSE(dropped(with, pkt));
+      EXPECT_FALSE(dropped(with, copy)) << "field " << it.field;
+
+      PacketDedup without(WINDOW, DEDUP_ALL & ~it.field);
+      EXPECT_FALSE(dropped(without, pkt));
+      EXPECT_TRUE(dropped(without, copy)) << "field " << it.field;
+   }
+}
+
+TEST(PacketDedup, parseFields)
+{
+   uint32_t fields;
+
+   EXPECT_TRUE(PacketDedup::parse_fields("all", fields));
+   EXPECT_EQ(fields, DEDUP_ALL);
+   EXPECT_TRUE(PacketDedup::parse_fields("ipid, ports,len", fields));
+   EXPECT_EQ(fields, DEDUP_IPID | DEDUP_PORTS | DEDUP_LEN);
+   EXPECT_FALSE(PacketDedup::parse_fields("addr,ttl", fields));
+   EXPECT_FALSE(PacketDedup::parse_fields("", fields));
+}
+
+}
+
+int main(int argc, char **argv)
+{
+   // invoking the tests
+   ::testing::InitGoogleTest(&argc, argv);
+   return RUN_ALL_TESTS();
+}
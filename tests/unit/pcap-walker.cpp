@@ -0,0 +1,248 @@
+#include <config.h>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <unistd.h>
+#ifdef WITH_ZLIB
+#include <zlib.h>
+#endif
+#include "gtest/gtest.h"
+
+#include <ipfixprobe/plugin.hpp>
+#include "../../input/pcap-walker.hpp"
+
+namespace ipxp_test {
+
+using namespace ipxp;
+
+struct TestRecord {
+   uint64_t sec;
+   uint64_t frac; // Microseconds or nanoseconds depending on file
+   std::vector<uint8_t> data;
+};
+
+static void put16(std::vector<uint8_t> &buf, uint16_t val, bool swap)
+{
+   if (swap) {
+      val = __builtin_bswap16(val);
+   }
+   buf.insert(buf.end(), reinterpret_cast<uint8_t *>(&val), reinterpret_cast<uint8_t *>(&val) + sizeof(val));
+}
+
+static void put32(std::vector<uint8_t> &buf, uint32_t val, bool swap)
+{
+   if (swap) {
+      val = __builtin_bswap32(val);
+   }
+   buf.insert(buf.end(), reinterpret_cast<uint8_t *>(&val), reinterpret_cast<uint8_t *>(&val) + sizeof(val));
+}
+
+static std::vector<TestRecord> gen_records(size_t cnt, size_t len)
+{
+   std::vector<TestRecord> recs;
+   for (size_t i = 0; i < cnt; i++) {
+      TestRecord rec = {1600000000 + i, 123456 + i, std::vector<uint8_t>(len + i % 7)};
+      for (size_t j = 0; j < rec.data.size(); j++) {
+         rec.data[j] = static_cast<uint8_t>(i + j);
+      }
+      recs.push_back(rec);
+   }
+   return recs;
+}
+
+static std::vector<uint8_t> gen_pcap(const std::vector<TestRecord> &recs, bool swap, bool nsec)
+{
+   std::vector<uint8_t> buf;
+   put32(buf, nsec ? 0xa1b23c4d : 0xa1b2c3d4, swap);
+   put16(buf, 2, swap);
+   put16(buf, 4, swap);
+   put32(buf, 0, swap);
+   put32(buf, 0, swap);
+   put32(buf, 262144, swap);
+   put32(buf, DLT_EN10MB, swap);
+   for (auto &it : recs) {
+      put32(buf, it.sec, swap);
+      put32(buf, it.frac, swap);
+      put32(buf, it.data.size(), swap);
+      put32(buf, it.data.size() + 4, swap);
+      buf.insert(buf.end(), it.data.begin(), it.data.end());
+   }
+   return buf;
+}
+
+/*
+ * tsresol is the if_tsresol option value, 0 for the default resolution of microseconds.
+ */
+static std::vector<uint8_t> gen_pcapng(const std::vector<TestRecord> &recs, bool swap, uint8_t tsresol)
+{
+   std::vector<uint8_t> buf;
+   put32(buf, 0x0a0d0d0a, swap);
+   put32(buf, 28, swap);
+   put32(buf, 0x1a2b3c4d, swap);
+   put16(buf, 1, swap);
+   put16(buf, 0, swap);
+   put32(buf, 0xffffffff, swap);
+   put32(buf, 0xffffffff, swap);
+   put32(buf, 28, swap);
+
+   uint32_t idb_len = tsresol ? 32 : 20;
+   put32(buf, 1, swap);
+   put32(buf, idb_len, swap);
+   put16(buf, DLT_EN10MB, swap);
+   put16(buf, 0, swap);
+   put32(buf, 0, swap);
+   if (tsresol) {
+      put16(buf, 9, swap);
+      put16(buf, 1, swap);
+      buf.insert(buf.end(), {tsresol, 0, 0, 0});
+      put32(buf, 0, swap);
+   }
+   put32(buf, idb_len, swap);
+
+   uint64_t units = tsresol ? 1000000000 : 1000000;
+   for (auto &it : recs) {
+      uint32_t pad = (4 - it.data.size() % 4) % 4;
+      uint32_t len = 32 + it.data.size() + pad;
+      uint64_t ts = it.sec * units + it.frac;
+      put32(buf, 6, swap);
+      put32(buf, len, swap);
+      put32(buf, 0, swap);
+      put32(buf, ts >> 32, swap);
+      put32(buf, ts & 0xffffffff, swap);
+      put32(buf, it.data.size(), swap);
+      put32(buf, it.data.size() + 4, swap);
+      buf.insert(buf.end(), it.data.begin(), it.data.end());
+      buf.insert(buf.end(), pad, 0);
+      put32(buf, len, swap);
+   }
+   return buf;
+}
+
+#ifdef WITH_ZLIB
+/*
+ * Write data to a temporary file compressed as the given number of gzip members.
+ */
+static std::string write_gzip(const std::vector<uint8_t> &data, size_t members = 1)
+{
+   char path[] = "/tmp/ipxp-walker-XXXXXX";
+   int fd = mkstemp(path);
+   EXPECT_NE(fd, -1);
+   FILE *fp = fdopen(fd, "wb");
+
+   size_t part = data.size() / members + 1;
+   for (size_t off = 0; off < data.size(); off += part) {
+      size_t len = std::min(part, data.size() - off);
+      z_stream zs;
+      memset(&zs, 0, sizeof(zs));
+      EXPECT_EQ(deflateInit2(&zs, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY), Z_OK);
+      std::vector<uint8_t> out(deflateBound(&zs, len));
+      zs.next_in = const_cast<uint8_t *>(data.data() + off);
+      zs.avail_in = len;
+      zs.next_out = out.data();
+      zs.avail_out = out.size();
+      EXPECT_EQ(deflate(&zs, Z_FINISH), Z_STREAM_END);
+      fwrite(out.data(), 1, out.size() - zs.avail_out, fp);
+      deflateEnd(&zs);
+   }
+   fclose(fp);
+   return path;
+}
+
+static void check_records(const std::string &file, const std::vector<TestRecord> &recs, bool nsec, bool threaded = true)
+{
+   PcapWalker walker(file, "", threaded);
+   EXPECT_EQ(walker.datalink(), DLT_EN10MB);
+
+   PcapRecord rec;
+   for (auto &it : recs) {
+      ASSERT_TRUE(walker.next(rec));
+      EXPECT_EQ(rec.ts, nsec ? ts_from_sec_nsec(it.sec, it.frac) : ts_from_sec_usec(it.sec, it.frac));
+      EXPECT_EQ(rec.caplen, it.data.size());
+      EXPECT_EQ(rec.len, it.data.size() + 4);
+      EXPECT_EQ(memcmp(rec.data, it.data.data(), it.data.size()), 0);
+      if (walker.must_release()) {
+         walker.release();
+      }
+   }
+   EXPECT_FALSE(walker.next(rec));
+}
+
+TEST(PcapWalker, pcapByteOrderAndPrecision)
+{
+   auto recs = gen_records(100, 60);
+   for (bool swap : {false, true}) {
+      for (bool nsec : {false, true}) {
+         std::string file = write_gzip(gen_pcap(recs, swap, nsec));
+         check_records(file, recs, nsec);
+         unlink(file.c_str());
+      }
+   }
+}
+
+TEST(PcapWalker, pcapngByteOrderAndResolution)
+{
+   auto recs = gen_records(100, 60);
+   for (bool swap : {false, true}) {
+      for (uint8_t tsresol : {0, 9}) {
+         std::string file = write_gzip(gen_pcapng(recs, swap, tsresol));
+         check_records(file, recs, tsresol != 0);
+         unlink(file.c_str());
+      }
+   }
+}
+
+TEST(PcapWalker, recordsCrossBuffers)
+{
+   // Records cross boundaries of decompressed buffers and gzip members
+   auto recs = gen_records(300, 40000);
+   std::string file = write_gzip(gen_pcap(recs, false, true), 7);
+   check_records(file, recs, true);
+   check_records(file, recs, true, false);
+   unlink(file.c_str());
+
+   file = write_gzip(gen_pcapng(recs, true, 0), 5);
+   check_records(file, recs, false);
+   check_records(file, recs, false, false);
+   unlink(file.c_str());
+}
+
+TEST(PcapWalker, truncatedFile)
+{
+   auto recs = gen_records(10, 100);
+   std::vector<uint8_t> data = gen_pcap(recs, false, false);
+   data.resize(data.size() - 50);
+   std::string file = write_gzip(data);
+
+   PcapWalker walker(file, "");
+   PcapRecord rec;
+   for (size_t i = 0; i + 1 < recs.size(); i++) {
+      EXPECT_TRUE(walker.next(rec));
+   }
+   EXPECT_THROW(walker.next(rec), PluginError);
+   unlink(file.c_str());
+}
+#endif
+
+TEST(PcapWalker, uncompressedFile)
+{
+   char path[] = "/tmp/ipxp-walker-XXXXXX";
+   int fd = mkstemp(path);
+   ASSERT_NE(fd, -1);
+   std::vector<uint8_t> data = gen_pcap(gen_records(1, 100), false, false);
+   EXPECT_EQ(write(fd, data.data(), data.size()), static_cast<ssize_t>(data.size()));
+   close(fd);
+
+   EXPECT_FALSE(PcapWalker::is_compressed(path));
+   EXPECT_THROW(PcapWalker(path, ""), PluginError);
+   unlink(path);
+}
+
+}
+
+int main(int argc, char **argv)
+{
+   // invoking the tests
+   ::testing::InitGoogleTest(&argc, argv);
+   return RUN_ALL_TESTS();
+}
@@ -0,0 +1,174 @@
+#include <algorithm>
+#include <cstdint>
+#include <thread>
+#include <vector>
+#include "gtest/gtest.h"
+
+#include <ipfixprobe/ring.h>
+
+namespace ipxp_test {
+
+static ipx_msg_t *to_msg(uint64_t val)
+{
+   return reinterpret_cast<ipx_msg_t *>(static_cast<uintptr_t>(val));
+}
+
+static uint64_t from_msg(ipx_msg_t *msg)
+{
+   return reinterpret_cast<uintptr_t>(msg);
+}
+
+/*
+ * Push cnt messages with consecutive values starting at next.
+ */
+static void push_seq(ipx_ring_t *ring, uint64_t &next, uint32_t cnt)
+{
+   std::vector<ipx_msg_t *> msgs;
+   for (uint32_t i = 0; i < cnt; i++) {
+      msgs.push_back(to_msg(next++));
+   }
+   ipx_ring_push_bulk(ring, msgs.data(), cnt);
+}
+
+/*
+ * Pop cnt messages by bulks of at most max messages, check they continue the sequence at expected.
+ */
+static void pop_seq(ipx_ring_t *ring, uint64_t &expected, uint32_t cnt, uint32_t max)
+{
+   std::vector<ipx_msg_t *> msgs(max);
+   while (cnt) {
+      uint32_t n = ipx_ring_pop_bulk(ring, msgs.data(), std::min(cnt, max));
+      ASSERT_LE(n, std::min(cnt, max));
+      for (uint32_t i = 0; i < n; i++) {
+         ASSERT_EQ(from_msg(msgs[i]), expected++);
+      }
+      cnt -= n;
+   }
+}
+
+TEST(Ring, bulkAcrossWrap)
+{
+   // Ring is 32 messages long, so the bulks start at every offset and cross its end
+   ipx_ring_t *ring = ipx_ring_init(32, false);
+   ASSERT_NE(ring, nullptr);
+   uint64_t next = 1;
+   uint64_t expected = 1;
+
+   // Single thread must not wait for space: bulk, last popped bulk and unsynchronized reads fit together
+   for (uint32_t cnt = 1; cnt <= 13; cnt++) {
+      for (unsigned round = 0; round < 3; round++) {
+         push_seq(ring, next, cnt);
+         pop_seq(ring, expected, cnt, cnt);
+      }
+   }
+   EXPECT_EQ(expected, next);
+   ipx_ring_destroy(ring);
+}
+
+TEST(Ring, mixedSingleAndBulk)
+{
+   ipx_ring_t *ring = ipx_ring_init(16, false);
+   ASSERT_NE(ring, nullptr);
+   uint64_t next = 1;
+   uint64_t expected = 1;
+
+   for (unsigned round = 0; round < 20; round++) {
+      ipx_ring_push(ring, to_msg(next++));
+      push_seq(ring, next, round % 5 + 1);
+      ipx_ring_push(ring, to_msg(next++));
+
+      ipx_msg_t *msg = ipx_ring_pop(ring);
+      ASSERT_NE(msg, nullptr);
+      EXPECT_EQ(from_msg(msg), expected++);
+      pop_seq(ring, expected, round % 5 + 1, 3);
+      msg = ipx_ring_pop(ring);
+      ASSERT_NE(msg, nullptr);
+      EXPECT_EQ(from_msg(msg), expected++);
+   }
+   EXPECT_EQ(expected, next);
+   EXPECT_EQ(ipx_ring_pop(ring), nullptr);
+   ipx_ring_destroy(ring);
+}
+
+TEST(Ring, tryPushBulk)
+{
+   ipx_ring_t *ring = ipx_ring_init(16, false);
+   ASSERT_NE(ring, nullptr);
+   std::vector<ipx_msg_t *> msgs;
+   for (uint64_t i = 1; i <= 20; i++) {
+      msgs.push_back(to_msg(i));
+   }
+
+   // Only messages that fit are added
+   EXPECT_EQ(ipx_ring_try_push_bulk(ring, msgs.data(), 20), 16);
+   EXPECT_EQ(ipx_ring_try_push_bulk(ring, msgs.data() + 16, 4), 0);
+
+   uint64_t expected = 1;
+   pop_seq(ring, expected, 16, 16);
+   // Empty pop releases the last bulk
+   std::vector<ipx_msg_t *> out(16);
+   EXPECT_EQ(ipx_ring_pop_bulk(ring, out.data(), 16), 0);
+   EXPECT_EQ(ipx_ring_cnt(ring), 0);
+
+   EXPECT_EQ(ipx_ring_try_push_bulk(ring, msgs.data() + 16, 4), 4);
+   pop_seq(ring, expected, 4, 16);
+   EXPECT_EQ(expected, 21);
+   ipx_ring_destroy(ring);
+}
+
+TEST(Ring, producerConsumer)
+{
+   const uint64_t total = 200000;
+   ipx_ring_t *ring = ipx_ring_init(64, false);
+   ASSERT_NE(ring, nullptr);
+
+   // Producer bulks are up to twice the ring size, so they wait for the consumer
+   std::thread producer([ring, total]() {
+      uint64_t next = 1;
+      uint32_t cnt = 0;
+      while (next <= total) {
+         cnt = cnt % 128 + 1;
+         if (cnt % 3 == 0) {
+            ipx_ring_push(ring, to_msg(next++));
+            continue;
+         }
+         push_seq(ring, next, std::min<uint64_t>(cnt, total - next + 1));
+      }
+   });
+
+   // Consumer keeps reading after a mismatch, so that the producer is never left waiting
+   uint64_t received = 0;
+   uint64_t mismatches = 0;
+   uint32_t max = 0;
+   std::vector<ipx_msg_t *> msgs(100);
+   while (received < total) {
+      max = max % 100 + 1;
+      if (max % 7 == 0) {
+         ipx_msg_t *msg = ipx_ring_pop(ring);
+         if (msg != nullptr) {
+            mismatches += from_msg(msg) != ++received;
+         }
+         continue;
+      }
+      uint32_t n = ipx_ring_pop_bulk(ring, msgs.data(), max);
+      EXPECT_LE(n, max);
+      for (uint32_t i = 0; i < n; i++) {
+         mismatches += from_msg(msgs[i]) != ++received;
+      }
+   }
+   producer.join();
+   EXPECT_EQ(received, total);
+   EXPECT_EQ(mismatches, 0);
+   EXPECT_EQ(ipx_ring_pop_bulk(ring, msgs.data(), 100), 0);
+   EXPECT_EQ(ipx_ring_cnt(ring), 0);
+   ipx_ring_destroy(ring);
+}
+
+}
+
+int main(int argc, char **argv)
+{
+   // invoking the tests
+   ::testing::InitGoogleTest(&argc, argv);
+   return RUN_ALL_TESTS();
+}
@@ -0,0 +1,130 @@
+#include <algorithm>
+#include <netinet/in.h>
+#include "gtest/gtest.h"
+
+#include "../../sampler.hpp"
+
+namespace ipxp_test {
+
+using namespace ipxp;
+
+#define FLOWS 4096
+
+/*
+ * Packets of one UDP flow: unfragmented packets in both directions, first fragment
+ * with ports and following fragments without them. With same_hosts, flows differ only in ports.
+ */
+static void make_flow(Packet *pkts, uint32_t flow, bool same_hosts = false)
+{
+   for (unsigned i = 0; i < 5; i++) {
+      Packet &pkt = pkts[i];
+      pkt = Packet();
+      pkt.ip_version = IP::v4;
+      pkt.ip_proto = IPPROTO_UDP;
+      pkt.src_ip.v4 = same_hosts ? 0x0a000001 : 0x0a000000 + flow;
+      pkt.dst_ip.v4 = 0xc0a80001;
+      pkt.src_port = 1024 + flow % 60000;
+      pkt.dst_port = 53;
+      pkt.packet_len_wire = 100;
+   }
+   std::swap(pkts[1].src_ip, pkts[1].dst_ip);
+   std::swap(pkts[1].src_port, pkts[1].dst_port);
+   pkts[2].frag_id = pkts[3].frag_id = pkts[4].frag_id = flow;
+   pkts[2].more_fragments = true;
+   pkts[3].more_fragments = true;
+   pkts[3].frag_off = 185;
+   pkts[3].src_port = pkts[3].dst_port = 0;
+   pkts[4].frag_off = 370;
+   pkts[4].src_port = pkts[4].dst_port = 0;
+}
+
+/*
+ * Filter packets of all flows one flow per block, return kept flows.
+ */
+static std::vector<bool> sample(FlowSampler &sampler, bool same_hosts = false)
+{
+   std::vector<bool> kept(FLOWS);
+   PacketBlock block(5);
+
+   for (uint32_t flow = 0; flow < FLOWS; flow++) {
+      make_flow(block.pkts, flow, same_hosts);
+      block.cnt = 5;
+      block.bytes = 500;
+      size_t removed = sampler.filter(block);
+      // Fragmented and unfragmented packets of a flow share the decision
+      EXPECT_TRUE(removed == 0 || removed == 5) << "flow " << flow;
+      EXPECT_EQ(block.bytes, block.cnt * 100);
+      for (size_t i = 0; i < block.cnt; i++) {
+         EXPECT_EQ(block.pkts[i].sampling, sampler.interval());
+      }
+      kept[flow] = removed == 0;
+   }
+   return kept;
+}
+
+TEST(FlowSampler, fragmentsShareDecision)
+{
+   FlowSampler sampler(8, 8);
+   std::vector<bool> kept = sample(sampler);
+
+   size_t cnt = std::count(kept.begin(), kept.end(), true);
+   EXPECT_GT(cnt, FLOWS / 8 / 2);
+   EXPECT_LT(cnt, FLOWS / 8 * 2);
+}
+
+TEST(FlowSampler, flowsOfHostPair)
+{
+   // Flows differ only in ports, fragments get theirs from the fragmentation cache
+   FlowSampler sampler(8, 8);
+   std::vector<bool> kept = sample(sampler, true);
+
+   size_t cnt = std::count(kept.begin(), kept.end(), true);
+   EXPECT_GT(cnt, FLOWS / 8 / 2);
+   EXPECT_LT(cnt, FLOWS / 8 * 2);
+}
+
+TEST(FlowSampler, nestedIntervals)
+{
+   FlowSampler fine(4, 4);
+   FlowSampler coarse(16, 16);
+   std::vector<bool> kept_fine = sample(fine);
+   std::vector<bool> kept_coarse = sample(coarse);
+
+   for (uint32_t flow = 0; flow < FLOWS; flow++) {
+      if (kept_coarse[flow]) {
+         EXPECT_TRUE(kept_fine[flow]) << "flow " << flow;
+      }
+   }
+}
+
+TEST(FlowSampler, noSampling)
+{
+   FlowSampler sampler(1, 1);
+   std::vector<bool> kept = sample(sampler);
+   EXPECT_EQ(std::count(kept.begin(), kept.end(), true), FLOWS);
+}
+
+TEST(FlowSampler, parseInterval)
+{
+   uint32_t interval;
+   uint32_t max_interval;
+
+   EXPECT_TRUE(FlowSampler::parse_interval("4", interval, max_interval));
+   EXPECT_EQ(interval, 4);
+   EXPECT_EQ(max_interval, 4);
+   EXPECT_TRUE(FlowSampler::parse_interval("4:64", interval, max_interval));
+   EXPECT_EQ(interval, 4);
+   EXPECT_EQ(max_interval, 64);
+   EXPECT_FALSE(FlowSampler::parse_interval("0", interval, max_interval));
+   EXPECT_FALSE(FlowSampler::parse_interval("8:4", interval, max_interval));
+   EXPECT_FALSE(FlowSampler::parse_interval("x", interval, max_interval));
+}
+
+}
+
+int main(int argc, char **argv)
+{
+   // invoking the tests
+   ::testing::InitGoogleTest(&argc, argv);
+   return RUN_ALL_TESTS();
+}
@@ -0,0 +1,119 @@
+#include "gtest/gtest.h"
+
+#include <ipfixprobe/text-format.hpp>
+
+namespace ipxp_test {
+
+using namespace ipxp;
+
+static std::string uint_str(uint64_t value)
+{
+   std::string out;
+   append_uint(out, value);
+   return out;
+}
+
+static std::string padded_str(uint64_t value, unsigned width)
+{
+   std::string out;
+   append_uint_padded(out, value, width);
+   return out;
+}
+
+static std::string json_str(const std::string &str)
+{
+   std::string out;
+   append_json_escaped(out, str.data(), str.size());
+   return out;
+}
+
+TEST(TextFormat, appendUint)
+{
+   EXPECT_EQ(uint_str(0), "0");
+   EXPECT_EQ(uint_str(7), "7");
+   EXPECT_EQ(uint_str(1000), "1000");
+   EXPECT_EQ(uint_str(UINT64_MAX), "18446744073709551615");
+
+   std::string out = "x=";
+   append_int(out, INT64_MIN);
+   EXPECT_EQ(out, "x=-9223372036854775808");
+}
+
+TEST(TextFormat, appendUintPadded)
+{
+   EXPECT_EQ(padded_str(0, 0), "0");
+   EXPECT_EQ(padded_str(0, 3), "000");
+   EXPECT_EQ(padded_str(5, 2), "05");
+   EXPECT_EQ(padded_str(123456, 6), "123456");
+   EXPECT_EQ(padded_str(123456, 3), "123456");
+   EXPECT_EQ(padded_str(42, 9), "000000042");
+   EXPECT_EQ(padded_str(UINT64_MAX, 20), "18446744073709551615");
+   // Padding is limited to the width of the largest number
+   EXPECT_EQ(padded_str(1, 30), "00000000000000000001");
+}
+
+TEST(TextFormat, appendIpv4)
+{
+   uint8_t addrs[][4] = {{0, 0, 0, 0}, {127, 0, 0, 1}, {10, 200, 3, 45}, {255, 255, 255, 255}};
+   const char *expected[] = {"0.0.0.0", "127.0.0.1", "10.200.3.45", "255.255.255.255"};
+
+   for (size_t i = 0; i < 4; i++) {
+      uint32_t addr;
+      memcpy(&addr, addrs[i], sizeof(addr));
+      std::string out;
+      append_ipv4(out, addr);
+      EXPECT_EQ(out, expected[i]);
+   }
+}
+
+TEST(TextFormat, appendMac)
+{
+   uint8_t zero[6] = {0, 0, 0, 0, 0, 0};
+   uint8_t mac[6] = {0x02, 0xab, 0x0c, 0xde, 0xf0, 0xff};
+   std::string out;
+
+   append_mac(out, zero);
+   EXPECT_EQ(out, "00:00:00:00:00:00");
+   out.clear();
+   append_mac(out, mac);
+   EXPECT_EQ(out, "02:ab:0c:de:f0:ff");
+}
+
+TEST(TextFormat, appendJsonEscaped)
+{
+   EXPECT_EQ(json_str(""), "");
+   EXPECT_EQ(json_str("GET /index.html"), "GET /index.html");
+   EXPECT_EQ(json_str("a\"b\\c"), "a\\\"b\\\\c");
+   EXPECT_EQ(json_str("\r\n\t\x1f\x7f"), "\\u000d\\u000a\\u0009\\u001f\x7f");
+   EXPECT_EQ(json_str(std::string("a\0b", 3)), "a\\u0000b");
+}
+
+TEST(TextFormat, appendJsonEscapedNonAscii)
+{
+   // Valid UTF-8 is kept
+   EXPECT_EQ(json_str("caf\xc3\xa9"), "caf\xc3\xa9");
+   EXPECT_EQ(json_str("\xe2\x82\xac 5"), "\xe2\x82\xac 5");
+   EXPECT_EQ(json_str("\xf0\x9f\x98\x80"), "\xf0\x9f\x98\x80");
+   EXPECT_EQ(json_str("\xf4\x8f\xbf\xbf"), "\xf4\x8f\xbf\xbf");
+
+   // Other bytes are escaped one by one
+   EXPECT_EQ(json_str("caf\xe9"), "caf\\u00e9");
+   EXPECT_EQ(json_str("\xff\xfe"), "\\u00ff\\u00fe");
+   EXPECT_EQ(json_str("\xe2\x82"), "\\u00e2\\u0082");
+   EXPECT_EQ(json_str("\xe2\x82x"), "\\u00e2\\u0082x");
+   EXPECT_EQ(json_str("\x80"), "\\u0080");
+   EXPECT_EQ(json_str("\xc0\xaf"), "\\u00c0\\u00af");
+   EXPECT_EQ(json_str("\xe0\x80\xaf"), "\\u00e0\\u0080\\u00af");
+   EXPECT_EQ(json_str("\xed\xa0\x80"), "\\u00ed\\u00a0\\u0080");
+   EXPECT_EQ(json_str("\xf4\x90\x80\x80"), "\\u00f4\\u0090\\u0080\\u0080");
+   EXPECT_EQ(json_str("\xc3\xa9\xc3"), "\xc3\xa9\\u00c3");
+}
+
+}
+
+int main(int argc, char **argv)
+{
+   // invoking the tests
+   ::testing::InitGoogleTest(&argc, argv);
+   return RUN_ALL_TESTS();
+}
@@ -27,27 +27,114 @@
  */
 
 #include <unistd.h>
+#include <sched.h>
+#include <cstring>
+#include <cassert>
+#include <algorithm>
 #include <sys/time.h>
 
 #include "workers.hpp"
 #include "ipfixprobe.hpp"
+#include "storage/xxhash.h"
 
 namespace ipxp {
 
 #define MICRO_SEC 1000000L
 
-void input_storage_worker(InputPlugin *plugin, StoragePlugin *cache, size_t queue_size, uint64_t pkt_limit,
-                  std::promise<WorkerResult> *out, std::atomic<InputStats> *out_stats)
+static uint64_t timespec_diff(const struct timespec &begin, const struct timespec &end)
+{
+   return (end.tv_sec - begin.tv_sec) * 1000000000L + end.tv_nsec - begin.tv_nsec;
+}
+
+IdleWait::IdleWait(IdlePolicy policy, InputPlugin *plugin) :
+   m_policy(policy), m_plugin(plugin), m_rounds(0), m_sleep(1), m_idle(false), m_wall({0, 0}), m_cpu({0, 0})
+{
+}
+
+void IdleWait::wait()
+{
+   if (!m_idle) {
+      m_idle = true;
+      clock_gettime(CLOCK_MONOTONIC, &m_wall);
+      clock_gettime(CLOCK_THREAD_CPUTIME_ID, &m_cpu);
+   }
+
+   if (m_policy == IdlePolicy::BUSY) {
+      return;
+   } else if (m_policy == IdlePolicy::BLOCK) {
+      if (m_plugin != nullptr && m_plugin->wait(IDLE_TICK)) {
+         return;
+      }
+   } else if (m_rounds < IDLE_YIELD_ROUNDS) {
+      if (m_rounds++ >= IDLE_SPIN_ROUNDS) {
+         sched_yield();
+      }
+      return;
+   }
+
+   usleep(m_sleep);
+   m_sleep = std::min<uint32_t>(2 * m_sleep, IDLE_MAX_SLEEP);
+}
+
+void IdleWait::update(InputStats &stats)
+{
+   if (!m_idle) {
+      return;
+   }
+   struct timespec wall;
+   struct timespec cpu;
+   clock_gettime(CLOCK_MONOTONIC, &wall);
+   clock_gettime(CLOCK_THREAD_CPUTIME_ID, &cpu);
+   stats.idle += timespec_diff(m_wall, wall);
+   stats.idle_cpu += timespec_diff(m_cpu, cpu);
+   m_wall = wall;
+   m_cpu = cpu;
+}
+
+void IdleWait::reset(InputStats &stats)
+{
+   update(stats);
+   m_idle = false;
+   m_rounds = 0;
+   m_sleep = 1;
+}
+
+/**
+ * \brief Get time used to expire flows while input is idle.
+ * \param [in] plugin Input plugin, its own time is used when it replays packets at its own pace.
+ * \param [in] ts Timestamp of the last packet.
+ * \param [in] begin Wall clock time when input became idle.
+ * \param [in] end Current wall clock time.
+ * \return Time in seconds.
+ */
+static time_t idle_time(const InputPlugin *plugin, timestamp_t ts, const struct timespec &begin, const struct timespec &end)
+{
+   timestamp_t now;
+   if (plugin->now(now)) {
+      return ts_sec(now);
+   }
+   struct timespec diff = {end.tv_sec - begin.tv_sec, end.tv_nsec - begin.tv_nsec};
+   if (diff.tv_nsec < 0) {
+      diff.tv_nsec += 1000000000;
+      diff.tv_sec--;
+   }
+   return ts_sec(ts) + diff.tv_sec;
+}
+
+void input_storage_worker(InputPlugin *plugin, StoragePlugin *cache, size_t queue_size, uint64_t pkt_limit, IdlePolicy idle_policy,
+                  PacketDedup *dedup, FlowSampler *sampler, std::promise<WorkerResult> *out, std::atomic<InputStats> *out_stats)
 {
    struct timespec start_cache;
    struct timespec end_cache;
    struct timespec begin = {0, 0};
    struct timespec end = {0, 0};
-   struct timeval ts = {0, 0};
+   timestamp_t ts = 0;
+   uint64_t tick = 0;
    bool timeout = false;
    InputPlugin::Result ret;
-   InputStats stats = {0, 0, 0, 0, 0};
+   InputStats stats = {0, 0, 0, 0, 0, 0, 0, 0, 0, 1};
    WorkerResult res = {false, ""};
+   IdleWait idle(idle_policy, plugin);
 
    PacketBlock block(queue_size);
 
@@ -80,25 +167,43 @@ void input_storage_worker(InputPlugin *plugin, StoragePlugin *cache, size_t queu
             timeout = true;
             begin = end;
          }
-         struct timespec diff = {end.tv_sec - begin.tv_sec, end.tv_nsec - begin.tv_nsec};
-         if (diff.tv_nsec < 0) {
-            diff.tv_nsec += 1000000000;
-            diff.tv_sec--;
+         uint64_t now = end.tv_sec * 1000UL + end.tv_nsec / 1000000;
+         if (now >= tick) {
+            // Expire flows periodically, independently of how often the input is polled
+            time_t idle_ts = idle_time(plugin, ts, begin, end);
+            for (unsigned i = 0; i < IDLE_TICK_EXPORTS; i++) {
+               cache->export_expired(idle_ts);
+            }
+            tick = now + IDLE_TICK;
+            idle.update(stats);
+            out_stats->store(stats);
          }
-         cache->export_expired(ts.tv_sec + diff.tv_sec);
-         usleep(1);
+         idle.wait();
          continue;
       } else if (ret == InputPlugin::Result::PARSED) {
          stats.packets = plugin->m_seen;
          stats.parsed = plugin->m_parsed;
          stats.dropped = plugin->m_dropped;
          stats.bytes += block.bytes;
+         if (timeout) {
+            idle.reset(stats);
+         }
+         if (sampler != nullptr) {
+            sampler->adapt(stats.dropped);
+            stats.unsampled += sampler->filter(block);
+            stats.sampling = sampler->interval();
+         }
+         if (dedup != nullptr) {
+            stats.duplicates += dedup->filter(block);
+         }
          clock_gettime(clk_id, &start_cache);
          try {
             for (unsigned i = 0; i < block.cnt; i++) {
                cache->put_pkt(block.pkts[i]);
             }
-            ts = block.pkts[block.cnt - 1].ts;
+            if (block.cnt) {
+               ts = block.pkts[block.cnt - 1].ts;
+            }
          } catch (PluginError &e) {
             res.error = true;
             res.msg = e.what();
@@ -126,7 +231,384 @@ void input_storage_worker(InputPlugin *plugin, StoragePlugin *cache, size_t queu
    stats.packets = plugin->m_seen;
    stats.parsed = plugin->m_parsed;
    stats.dropped = plugin->m_dropped;
+   idle.reset(stats);
+   out_stats->store(stats);
+   cache->finish();
+   auto outq = cache->get_queue();
+   while (ipx_ring_cnt(outq)) {
+      usleep(1);
+   }
+   out->set_value(res);
+}
+
+DispatchQueue::DispatchQueue(size_t blocks_cnt, size_t pkts_size, size_t data_size) :
+   queue(nullptr), free(nullptr), finished(false), failed(false), idle_ts(0), packets(0), stalls(0), stall_time(0),
+   idle(0), idle_cpu(0)
+{
+   // Reader of the ring keeps last popped item until next pop, make rings larger than number of blocks
+   queue = ipx_ring_init(2 * blocks_cnt, 0);
+   free = ipx_ring_init(2 * blocks_cnt, 0);
+   if (queue == nullptr || free == nullptr) {
+      if (queue) {
+         ipx_ring_destroy(queue);
+      }
+      if (free) {
+         ipx_ring_destroy(free);
+      }
+      throw std::bad_alloc();
+   }
+   for (size_t i = 0; i < blocks_cnt; i++) {
+      blocks.push_back(new DispatchBlock(pkts_size, data_size));
+      ipx_ring_push(free, blocks.back());
+   }
+}
+
+DispatchQueue::~DispatchQueue()
+{
+   for (auto &it : blocks) {
+      delete it;
+   }
+   ipx_ring_destroy(queue);
+   ipx_ring_destroy(free);
+}
+
+/**
+ * \brief Compute index of storage worker for the packet.
+ *
+ * Only addresses are hashed (in canonical order), so both directions of a biflow
+ * and all fragments of a packet end up in the same worker.
+ */
+static size_t dispatch_index(const Packet &pkt, size_t workers)
+{
+   struct {
+      uint8_t ip[2][16];
+      uint32_t vlan_id;
+      uint8_t ip_version;
+      uint8_t proto;
+   } key;
+   size_t ip_len = pkt.ip_version == IP::v6 ? 16 : 4;
+   const uint8_t *src = reinterpret_cast<const uint8_t *>(&pkt.src_ip);
+   const uint8_t *dst = reinterpret_cast<const uint8_t *>(&pkt.dst_ip);
+
+   memset(&key, 0, sizeof(key));
+   if (memcmp(src, dst, ip_len) > 0) {
+      std::swap(src, dst);
+   }
+   memcpy(key.ip[0], src, ip_len);
+   memcpy(key.ip[1], dst, ip_len);
+   key.vlan_id = pkt.vlan_id;
+   key.ip_version = pkt.ip_version;
+   key.proto = pkt.ip_proto;
+
+   return XXH64(&key, sizeof(key), 0) % workers;
+}
+
+static_assert(DISPATCH_BLOCK_MIN_DATA >= 3 * UINT16_MAX, "empty dispatch block must fit packet, payload and custom data");
+
+/**
+ * \brief Copy packet together with its data into the dispatch block.
+ * \return False when the block is full, never for an empty block.
+ */
+static bool dispatch_copy(DispatchBlock *blk, const Packet &pkt)
+{
+   size_t len = pkt.packet_len + pkt.custom_len;
+   bool payload_inside = pkt.packet && pkt.payload >= pkt.packet &&
+      pkt.payload + pkt.payload_len <= pkt.packet + pkt.packet_len;
+   if (pkt.packet && pkt.payload && !payload_inside) {
+      len += pkt.payload_len;
+   }
+   if (blk->block.cnt >= blk->block.size || blk->data_used + len > blk->data_size) {
+      return false;
+   }
+
+   Packet &copy = blk->block.pkts[blk->block.cnt];
+   uint8_t *data = blk->data + blk->data_used;
+   copy = pkt;
+   copy.m_exts = nullptr;
+   if (pkt.packet) {
+      memcpy(data, pkt.packet, pkt.packet_len);
+      copy.packet = data;
+      data += pkt.packet_len;
+      if (payload_inside) {
+         copy.payload = copy.packet + (pkt.payload - pkt.packet);
+      } else if (pkt.payload) {
+         memcpy(data, pkt.payload, pkt.payload_len);
+         copy.payload = data;
+         data += pkt.payload_len;
+      }
+   }
+   if (pkt.custom) {
+      memcpy(data, pkt.custom, pkt.custom_len);
+      copy.custom = data;
+      data += pkt.custom_len;
+   }
+
+   blk->data_used = data - blk->data;
+   blk->block.cnt++;
+   blk->block.bytes += pkt.packet_len_wire;
+   return true;
+}
+
+static void dispatch_push(DispatchQueue *dispatch, DispatchBlock *&blk)
+{
+   if (blk != nullptr && blk->block.cnt) {
+      dispatch->packets += blk->block.cnt;
+      ipx_ring_push(dispatch->queue, blk);
+      blk = nullptr;
+   }
+}
+
+static DispatchBlock *dispatch_get(DispatchQueue *dispatch, IdlePolicy idle_policy)
+{
+   DispatchBlock *blk = static_cast<DispatchBlock *>(ipx_ring_pop(dispatch->free));
+   if (blk == nullptr) {
+      // Worker does not keep up with the input, wait for it by the idle policy
+      IdleWait stall(idle_policy, nullptr);
+      struct timespec start;
+      struct timespec end;
+      clock_gettime(CLOCK_MONOTONIC, &start);
+      while (blk == nullptr && !dispatch->failed) {
+         blk = static_cast<DispatchBlock *>(ipx_ring_pop(dispatch->free));
+         if (blk == nullptr) {
+            stall.wait();
+         }
+      }
+      clock_gettime(CLOCK_MONOTONIC, &end);
+      dispatch->stalls++;
+      dispatch->stall_time += (end.tv_sec - start.tv_sec) * 1000000000L + end.tv_nsec - start.tv_nsec;
+   }
+   if (blk != nullptr) {
+      blk->block.cnt = 0;
+      blk->block.bytes = 0;
+      blk->data_used = 0;
+   }
+   return blk;
+}
+
+void input_dispatch_worker(InputPlugin *plugin, std::vector<StorageWorker> workers, size_t queue_size, uint64_t pkt_limit,
+                  IdlePolicy idle_policy, PacketDedup *dedup, FlowSampler *sampler, std::promise<WorkerResult> *out,
+                  std::atomic<InputStats> *out_stats)
+{
+   struct timespec start_dispatch;
+   struct timespec end_dispatch;
+   struct timespec begin = {0, 0};
+   struct timespec end = {0, 0};
+   timestamp_t ts = 0;
+   uint64_t tick = 0;
+   bool timeout = false;
+   InputPlugin::Result ret;
+   InputStats stats = {0, 0, 0, 0, 0, 0, 0, 0, 0, 1};
+   WorkerResult res = {false, ""};
+   IdleWait idle(idle_policy, plugin);
+   std::vector<std::future<WorkerResult>> results;
+   std::vector<DispatchBlock *> blocks(workers.size(), nullptr);
+
+   PacketBlock block(queue_size);
+
+#ifdef __linux__
+   const clockid_t clk_id = CLOCK_MONOTONIC_COARSE;
+#else
+   const clockid_t clk_id = CLOCK_MONOTONIC;
+#endif
+
+   for (auto &it : workers) {
+      results.push_back(it.promise->get_future());
+   }
+
+   while (!terminate_input && !res.error) {
+      block.cnt = 0;
+      block.bytes = 0;
+
+      if (pkt_limit && plugin->m_parsed + block.size >= pkt_limit) {
+         if (plugin->m_parsed >= pkt_limit) {
+            break;
+         }
+         block.size = pkt_limit - plugin->m_parsed;
+      }
+      try {
+         ret = plugin->get(block);
+      } catch (PluginError &e) {
+         res.error = true;
+         res.msg = e.what();
+         break;
+      }
+      if (ret == InputPlugin::Result::TIMEOUT) {
+         clock_gettime(clk_id, &end);
+         if (!timeout) {
+            timeout = true;
+            begin = end;
+            // Do not hold packets of partially filled blocks while there is no traffic
+            for (size_t i = 0; i < workers.size(); i++) {
+               dispatch_push(workers[i].dispatch, blocks[i]);
+            }
+         }
+         time_t idle_ts = idle_time(plugin, ts, begin, end);
+         for (auto &it : workers) {
+            it.dispatch->idle_ts = idle_ts;
+         }
+         uint64_t now = end.tv_sec * 1000UL + end.tv_nsec / 1000000;
+         if (now >= tick) {
+            tick = now + IDLE_TICK;
+            idle.update(stats);
+            out_stats->store(stats);
+         }
+         idle.wait();
+         continue;
+      } else if (ret == InputPlugin::Result::PARSED) {
+         stats.packets = plugin->m_seen;
+         stats.parsed = plugin->m_parsed;
+         stats.dropped = plugin->m_dropped;
+         stats.bytes += block.bytes;
+         if (timeout) {
+            idle.reset(stats);
+         }
+         if (sampler != nullptr) {
+            uint64_t overload = stats.dropped;
+            for (auto &it : workers) {
+               overload += it.dispatch->stalls;
+            }
+            sampler->adapt(overload);
+            stats.unsampled += sampler->filter(block);
+            stats.sampling = sampler->interval();
+         }
+         if (dedup != nullptr) {
+            stats.duplicates += dedup->filter(block);
+         }
+         clock_gettime(clk_id, &start_dispatch);
+         for (unsigned i = 0; i < block.cnt; i++) {
+            size_t idx = workers.size() > 1 ? dispatch_index(block.pkts[i], workers.size()) : 0;
+            DispatchQueue *dispatch = workers[idx].dispatch;
+            DispatchBlock *&blk = blocks[idx];
+            if (blk != nullptr && dispatch_copy(blk, block.pkts[i])) {
+               continue;
+            }
+            dispatch_push(dispatch, blk);
+            if (blk == nullptr) {
+               blk = dispatch_get(dispatch, idle_policy);
+               if (blk == nullptr) {
+                  // Worker failed, its error is reported below
+                  res.error = true;
+                  break;
+               }
+            }
+            bool copied = dispatch_copy(blk, block.pkts[i]);
+            assert(copied);
+            (void) copied;
+         }
+         if (block.cnt) {
+            ts = block.pkts[block.cnt - 1].ts;
+         }
+         if (timeout) {
+            timeout = false;
+            for (auto &it : workers) {
+               it.dispatch->idle_ts = 0;
+            }
+         }
+         clock_gettime(clk_id, &end_dispatch);
+
+         int64_t time = end_dispatch.tv_nsec - start_dispatch.tv_nsec;
+         if (start_dispatch.tv_sec != end_dispatch.tv_sec) {
+            time += 1000000000;
+         }
+         stats.qtime += time;
+
+         out_stats->store(stats);
+      } else if (ret == InputPlugin::Result::ERROR) {
+         res.error = true;
+         res.msg = "error occured during reading";
+         break;
+      } else if (ret == InputPlugin::Result::END_OF_FILE) {
+         break;
+      }
+   }
+
+   stats.packets = plugin->m_seen;
+   stats.parsed = plugin->m_parsed;
+   stats.dropped = plugin->m_dropped;
+   idle.reset(stats);
    out_stats->store(stats);
+
+   for (size_t i = 0; i < workers.size(); i++) {
+      if (!workers[i].dispatch->failed) {
+         dispatch_push(workers[i].dispatch, blocks[i]);
+      }
+      workers[i].dispatch->finished = true;
+   }
+   for (auto &it : results) {
+      WorkerResult worker_res = it.get();
+      if (worker_res.error && !res.error) {
+         res = worker_res;
+      } else if (worker_res.error && res.msg.empty()) {
+         res.msg = worker_res.msg;
+      }
+   }
+   out->set_value(res);
+}
+
+void storage_worker(StoragePlugin *cache, DispatchQueue *dispatch, IdlePolicy idle_policy, std::promise<WorkerResult> *out)
+{
+   WorkerResult res = {false, ""};
+   struct timespec end;
+   uint64_t tick = 0;
+   bool timeout = false;
+   InputStats stats = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0}; // Only idle time is accounted
+   IdleWait idle(idle_policy, nullptr);
+   auto store_idle = [&]() {
+      dispatch->idle = stats.idle;
+      dispatch->idle_cpu = stats.idle_cpu;
+   };
+
+#ifdef __linux__
+   const clockid_t clk_id = CLOCK_MONOTONIC_COARSE;
+#else
+   const clockid_t clk_id = CLOCK_MONOTONIC;
+#endif
+
+   while (1) {
+      bool finished = dispatch->finished;
+      DispatchBlock *blk = static_cast<DispatchBlock *>(ipx_ring_pop(dispatch->queue));
+      if (blk == nullptr) {
+         if (finished) {
+            break;
+         }
+         time_t idle_ts = dispatch->idle_ts;
+         clock_gettime(clk_id, &end);
+         uint64_t now = end.tv_sec * 1000UL + end.tv_nsec / 1000000;
+         if (now >= tick) {
+            // Expire flows periodically, independently of how often the queue is polled
+            for (unsigned i = 0; idle_ts && !res.error && i < IDLE_TICK_EXPORTS; i++) {
+               cache->export_expired(idle_ts);
+            }
+            tick = now + IDLE_TICK;
+            idle.update(stats);
+            store_idle();
+         }
+         timeout = true;
+         idle.wait();
+         continue;
+      }
+      if (timeout) {
+         timeout = false;
+         idle.reset(stats);
+         store_idle();
+      }
+
+      if (!res.error) {
+         try {
+            for (unsigned i = 0; i < blk->block.cnt; i++) {
+               cache->put_pkt(blk->block.pkts[i]);
+            }
+         } catch (PluginError &e) {
+            res.error = true;
+            res.msg = e.what();
+            dispatch->failed = true;
+         }
+      }
+      ipx_ring_push(dispatch->free, blk);
+   }
+
+   idle.reset(stats);
+   store_idle();
    cache->finish();
    auto outq = cache->get_queue();
    while (ipx_ring_cnt(outq)) {
@@ -141,11 +623,28 @@ static long timeval_diff(const struct timeval *start, const struct timeval *end)
           + (end->tv_usec - start->tv_usec);
 }
 
-void output_worker(OutputPlugin *exp, ipx_ring_t *queue, std::promise<WorkerResult> *out, std::atomic<OutputStats> *out_stats,
-   uint32_t fps)
+OutputQueue::OutputQueue(OutputPlugin *plugin, ipx_ring_t *queue, std::atomic<OutputStats> *stats, bool dispatched) :
+   plugin(plugin), queue(queue), thread(nullptr), stats(stats), finished(!dispatched), failed(false), dropped(0)
 {
-   WorkerResult res = {false, ""};
+}
+
+/**
+ * \brief Return reference of an output to the flow, storage may reuse the record afterwards.
+ */
+static inline void release_flow(Flow *flow)
+{
+   __atomic_fetch_sub(&flow->refs, 1, __ATOMIC_RELEASE);
+}
+
+void output_worker(OutputQueue *output, uint32_t fps)
+{
+   OutputPlugin *exp = output->plugin;
+   ipx_ring_t *queue = output->queue;
    OutputStats stats = {0, 0, 0, 0};
+   auto store_stats = [&]() {
+      stats.dropped = exp->m_flows_dropped + output->dropped.load(std::memory_order_relaxed);
+      output->stats->store(stats);
+   };
    struct timespec sleep_time = {0};
    struct timeval begin;
    struct timeval end;
@@ -163,68 +662,149 @@ void output_worker(OutputPlugin *exp, ipx_ring_t *queue, std::promise<WorkerResu
    while (1) {
       gettimeofday(&end, nullptr);
 
-      Flow *flow = static_cast<Flow *>(ipx_ring_pop(queue));
-      if (!flow) {
-         if (end.tv_sec - last_flush.tv_sec > 1) {
+      ipx_msg_t *flows[OUTPUT_BULK];
+      uint32_t cnt = ipx_ring_pop_bulk(queue, flows, OUTPUT_BULK);
+      if (!cnt) {
+         if (end.tv_sec - last_flush.tv_sec > 1 && !output->failed) {
             last_flush = end;
             exp->flush();
          }
-         if (terminate_export && !ipx_ring_cnt(queue)) {
+         if (terminate_export && output->finished && !ipx_ring_cnt(queue)) {
             break;
          }
          continue;
       }
 
-      stats.biflows++;
-      stats.bytes += flow->src_bytes + flow->dst_bytes;
-      stats.packets += flow->src_packets + flow->dst_packets;
-      stats.dropped = exp->m_flows_dropped;
-      out_stats->store(stats);
-      try {
-         exp->export_flow(*flow);
-      } catch (PluginError &e) {
-         res.error = true;
-         res.msg = e.what();
-         break;
-      }
+      for (uint32_t i = 0; i < cnt; i++) {
+         Flow *flow = static_cast<Flow *>(flows[i]);
+         if (output->failed) {
+            // Queue is drained, so that neither storage nor dispatcher waits for the plugin
+            output->dropped.fetch_add(1, std::memory_order_relaxed);
+            release_flow(flow);
+            continue;
+         }
+         stats.biflows++;
+         stats.bytes += flow->src_bytes + flow->dst_bytes;
+         stats.packets += flow->src_packets + flow->dst_packets;
+         try {
+            exp->export_flow(*flow);
+         } catch (PluginError &e) {
+            output->error = e.what();
+            output->failed = true;
+         }
+         release_flow(flow);
 
-      pkts_from_begin++;
-      if (fps == 0) {
-         // Limit for packets/s is not enabled
-         continue;
-      }
+         pkts_from_begin++;
+         if (fps == 0) {
+            // Limit for packets/s is not enabled
+            continue;
+         }
 
-      // Calculate expected time of sending next packet
-      long elapsed = timeval_diff(&begin, &end);
-      if (elapsed < 0) {
-         // Should be never negative. Just for sure...
-         elapsed = pkts_from_begin * time_per_pkt;
+         // Calculate expected time of sending next packet
+         if (i) {
+            gettimeofday(&end, nullptr);
+         }
+         long elapsed = timeval_diff(&begin, &end);
+         if (elapsed < 0) {
+            // Should be never negative. Just for sure...
+            elapsed = pkts_from_begin * time_per_pkt;
+         }
+
+         long next_start = pkts_from_begin * time_per_pkt;
+         long diff = next_start - elapsed;
+
+         if (diff >= MICRO_SEC) {
+            diff = MICRO_SEC - 1;
+         }
+
+         // Sleep
+         if (diff > 0) {
+            sleep_time.tv_nsec = diff * 1000L;
+            nanosleep(&sleep_time, nullptr);
+         }
+
+         if (pkts_from_begin >= fps) {
+            // Restart counter
+            gettimeofday(&begin, nullptr);
+            pkts_from_begin = 0;
+         }
       }
+      store_stats();
+   }
 
-      long next_start = pkts_from_begin * time_per_pkt;
-      long diff = next_start - elapsed;
+   if (!output->failed) {
+      exp->flush();
+   }
+   store_stats();
+}
+
+/**
+ * \brief Push flows to queue of output plugin, wait for space while the plugin makes progress.
+ * \return Number of pushed flows from the beginning of the array.
+ */
+static uint32_t dispatch_flows(OutputQueue *output, ipx_msg_t **flows, uint32_t cnt, bool &stalled)
+{
+   if (output->failed) {
+      return 0;
+   }
 
-      if (diff >= MICRO_SEC) {
-         diff = MICRO_SEC - 1;
+   uint32_t pushed = ipx_ring_try_push_bulk(output->queue, flows, cnt);
+   if (pushed < cnt && !stalled) {
+      struct timespec progress_ts;
+      struct timespec now;
+      uint64_t progress = output->stats->load().biflows;
+      clock_gettime(CLOCK_MONOTONIC, &progress_ts);
+      while (pushed < cnt && !output->failed) {
+         usleep(100);
+         pushed += ipx_ring_try_push_bulk(output->queue, flows + pushed, cnt - pushed);
+         clock_gettime(CLOCK_MONOTONIC, &now);
+         uint64_t exported = output->stats->load().biflows;
+         if (exported != progress) {
+            progress = exported;
+            progress_ts = now;
+         } else if (timespec_diff(progress_ts, now) > OUTPUT_STALL_TIMEOUT * 1000000UL) {
+            break;
+         }
       }
+   }
+
+   // Flows of stalled plugin are dropped without waiting until its queue accepts whole bulk again
+   stalled = pushed < cnt;
+   return pushed;
+}
 
-      // Sleep
-      if (diff > 0) {
-         sleep_time.tv_nsec = diff * 1000L;
-         nanosleep(&sleep_time, nullptr);
+void output_dispatch_worker(ipx_ring_t *queue, std::vector<OutputQueue *> outputs)
+{
+   std::vector<bool> stalled(outputs.size(), false);
+
+   while (1) {
+      ipx_msg_t *flows[OUTPUT_BULK];
+      uint32_t cnt = ipx_ring_pop_bulk(queue, flows, OUTPUT_BULK);
+      if (!cnt) {
+         if (terminate_export && !ipx_ring_cnt(queue)) {
+            break;
+         }
+         continue;
       }
 
-      if (pkts_from_begin >= fps) {
-         // Restart counter
-         gettimeofday(&begin, nullptr);
-         pkts_from_begin = 0;
+      // Reference of the storage queue is passed to the first output, others take their own
+      for (uint32_t i = 0; i < cnt; i++) {
+         __atomic_fetch_add(&static_cast<Flow *>(flows[i])->refs, outputs.size() - 1, __ATOMIC_RELAXED);
+      }
+      for (size_t j = 0; j < outputs.size(); j++) {
+         bool output_stalled = stalled[j];
+         uint32_t pushed = dispatch_flows(outputs[j], flows, cnt, output_stalled);
+         stalled[j] = output_stalled;
+         for (uint32_t i = pushed; i < cnt; i++) {
+            release_flow(static_cast<Flow *>(flows[i]));
+         }
+         outputs[j]->dropped.fetch_add(cnt - pushed, std::memory_order_relaxed);
       }
    }
 
-   exp->flush();
-   stats.dropped = exp->m_flows_dropped;
-   out_stats->store(stats);
-   out->set_value(res);
+   for (auto output : outputs) {
+      output->finished = true;
+   }
 }
 
 }
@@ -31,6 +31,9 @@
 
 #include <future>
 #include <atomic>
+#include <vector>
+#include <thread>
+#include <ctime>
 
 #include <ipfixprobe/input.hpp>
 #include <ipfixprobe/storage.hpp>
@@ -40,41 +43,170 @@
 #include <ipfixprobe/ring.h>
 
 #include "stats.hpp"
+#include "dedup.hpp"
+#include "sampler.hpp"
 
 namespace ipxp {
 
 #define MICRO_SEC 1000000L
 
+#define DISPATCH_BLOCKS 8 /**< Default number of packet blocks per storage worker */
+#define DISPATCH_BLOCK_MIN_DATA (3 * 65536) /**< Minimal data buffer size of block, fits packet, payload and custom data */
+
+#define OUTPUT_BULK 64 /**< Maximal number of flows an output worker takes from its queue at once */
+#define OUTPUT_STALL_TIMEOUT 100 /**< Time in milliseconds without progress after which output plugin with full queue loses flows */
+
+#define IDLE_SPIN_ROUNDS 64 /**< Empty input polls before idle input worker starts yielding CPU */
+#define IDLE_YIELD_ROUNDS 256 /**< Empty input polls before idle input worker starts sleeping */
+#define IDLE_MAX_SLEEP 1000 /**< Maximal sleep of idle input worker in microseconds */
+#define IDLE_TICK 10 /**< Period of flow expiration while input is idle in milliseconds */
+#define IDLE_TICK_EXPORTS 128 /**< Number of expiration sweeps per idle tick */
+
+/**
+ * \brief What an input or storage worker does while it has no packets.
+ */
+enum class IdlePolicy {
+   BUSY, /**< Poll input without pause */
+   SPIN, /**< Poll input, then yield CPU and finally sleep for growing time */
+   BLOCK /**< Wait for packets in input plugin, sleep when the plugin is not able to wait */
+};
+
+/**
+ * \brief Idle waiting of input or storage worker with accounting of idle time.
+ *
+ * Storage worker has no input plugin to wait in, it sleeps with blocking policy.
+ */
+class IdleWait
+{
+public:
+   IdleWait(IdlePolicy policy, InputPlugin *plugin);
+
+   void wait();
+   void update(InputStats &stats);
+   void reset(InputStats &stats);
+
+private:
+   IdlePolicy m_policy;
+   InputPlugin *m_plugin;
+   uint32_t m_rounds;
+   uint32_t m_sleep;
+   bool m_idle;
+   struct timespec m_wall; /**< Start of idle time not yet accounted */
+   struct timespec m_cpu; /**< Thread CPU time at m_wall */
+};
+
 struct WorkerResult {
    bool error;
    std::string msg;
 };
 
+/**
+ * \brief Block of packets owned by a dispatcher or a storage worker.
+ *
+ * Packet and payload pointers of packets in the block point to the data buffer,
+ * so the block stays valid after the input plugin reads next packets.
+ */
+struct DispatchBlock {
+   PacketBlock block;
+   uint8_t *data;
+   size_t data_size;
+   size_t data_used;
+
+   DispatchBlock(size_t pkts_size, size_t data_size) :
+      block(pkts_size), data(new uint8_t[data_size]), data_size(data_size), data_used(0)
+   {
+   }
+
+   ~DispatchBlock()
+   {
+      delete[] data;
+   }
+};
+
+/**
+ * \brief Queues between a dispatcher and one storage worker.
+ */
+struct DispatchQueue {
+   ipx_ring_t *queue; /**< Filled blocks, dispatcher -> worker */
+   ipx_ring_t *free; /**< Processed blocks, worker -> dispatcher */
+   std::vector<DispatchBlock *> blocks;
+   std::atomic<bool> finished; /**< No more blocks will be pushed */
+   std::atomic<bool> failed; /**< Worker stopped processing packets */
+   std::atomic<time_t> idle_ts; /**< Expiration time forwarded while input is idle, 0 otherwise */
+   uint64_t packets; /**< Packets dispatched to the worker */
+   uint64_t stalls; /**< Number of times the dispatcher waited for a free block of the worker */
+   uint64_t stall_time; /**< Time in nanoseconds the dispatcher waited for free blocks of the worker */
+   uint64_t idle; /**< Time in nanoseconds the worker had no packets */
+   uint64_t idle_cpu; /**< CPU time in nanoseconds the worker consumed while idle */
+
+   DispatchQueue(size_t blocks_cnt, size_t pkts_size, size_t data_size);
+   ~DispatchQueue();
+};
+
+struct StorageWorker {
+   StoragePlugin *plugin;
+   std::vector<ProcessPlugin *> plugins;
+   std::thread *thread;
+   std::promise<WorkerResult> *promise;
+   DispatchQueue *dispatch;
+};
+
 struct WorkPipeline {
    struct {
       InputPlugin *plugin;
       std::thread *thread;
       std::promise<WorkerResult> *promise;
       std::atomic<InputStats> *stats;
+      PacketDedup *dedup; /**< Duplicate packet filter, nullptr when disabled */
+      FlowSampler *sampler; /**< Flow sampling, nullptr when disabled */
    } input;
    struct {
       StoragePlugin *plugin;
       std::vector<ProcessPlugin *> plugins;
    } storage;
+   std::vector<StorageWorker> workers; /**< Storage workers fed by the input thread, storage is unused then */
 };
 
-struct OutputWorker {
+/**
+ * \brief Output plugin with its own thread and queue of flows to export.
+ *
+ * Failed plugin does not stop the others, flows of its queue are released without export.
+ */
+struct OutputQueue {
    OutputPlugin *plugin;
+   ipx_ring_t *queue; /**< Queue of the output worker when the plugin is its only output */
    std::thread *thread;
-   std::promise<WorkerResult> *promise;
    std::atomic<OutputStats> *stats;
+   std::atomic<bool> finished; /**< No more flows will be dispatched to the queue */
+   std::atomic<bool> failed; /**< Plugin stopped exporting, error is set */
+   std::atomic<uint64_t> dropped; /**< Flows not exported because the queue was full or plugin failed */
+   std::string error;
+
+   OutputQueue(OutputPlugin *plugin, ipx_ring_t *queue, std::atomic<OutputStats> *stats, bool dispatched);
+};
+
+/**
+ * \brief Output worker exporting every flow from its queue by all output plugins.
+ *
+ * With several plugins, dispatcher thread pushes each flow to queues of all plugins. Full queue is
+ * waited for while its plugin makes progress, flows are dropped for a plugin stalled for longer than
+ * OUTPUT_STALL_TIMEOUT, so it does not stall the others. Storage reuses the flow record and its
+ * extensions after all plugins released it.
+ */
+struct OutputWorker {
+   std::vector<OutputQueue *> outputs;
+   std::thread *thread; /**< Dispatcher, nullptr with single output plugin */
    ipx_ring_t *queue;
 };
 
-void input_storage_worker(InputPlugin *plugin, StoragePlugin *cache, size_t queue_size, uint64_t pkt_limit, 
-      std::promise<WorkerResult> *out, std::atomic<InputStats> *out_stats);
-void output_worker(OutputPlugin *exp, ipx_ring_t *queue, std::promise<WorkerResult> *out, std::atomic<OutputStats> *out_stats,
-      uint32_t fps);
+void input_storage_worker(InputPlugin *plugin, StoragePlugin *cache, size_t queue_size, uint64_t pkt_limit, IdlePolicy idle_policy,
+      PacketDedup *dedup, FlowSampler *sampler, std::promise<WorkerResult> *out, std::atomic<InputStats> *out_stats);
+void input_dispatch_worker(InputPlugin *plugin, std::vector<StorageWorker> workers, size_t queue_size, uint64_t pkt_limit,
+      IdlePolicy idle_policy, PacketDedup *dedup, FlowSampler *sampler, std::promise<WorkerResult> *out,
+      std::atomic<InputStats> *out_stats);
+void storage_worker(StoragePlugin *cache, DispatchQueue *dispatch, IdlePolicy idle_policy, std::promise<WorkerResult> *out);
+void output_worker(OutputQueue *output, uint32_t fps);
+void output_dispatch_worker(ipx_ring_t *queue, std::vector<OutputQueue *> outputs);
 
 }
 